@@ -1,5 +1,29 @@
+#include "fluxions-base-tests.hpp"
 
+namespace {
+	int failures = 0;
+}
+
+void Check(bool condition, const char* expression, const char* file, int line) {
+	if (condition)
+		return;
+	fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	failures++;
+}
 
 int main() {
-	return 0;
+	TestSimpleMultiDraw();
+	TestSimpleGeometryMesh();
+	TestSymbol();
+	TestCopyOnWriteVector();
+	TestSimpleMeshAdjacency();
+	TestSimpleGeometrySequence();
+	TestSimpleSkinningEngine();
+	TestSimpleFrustumCuller();
+	TestSimpleOcclusionCuller();
+	TestGL1GL2Tools();
+	TestSimpleRenderStats();
+	if (failures)
+		fprintf(stderr, "%d checks failed\n", failures);
+	return failures ? 1 : 0;
 }
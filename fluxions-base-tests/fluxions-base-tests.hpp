@@ -0,0 +1,27 @@
+#ifndef FLUXIONS_BASE_TESTS_HPP
+#define FLUXIONS_BASE_TESTS_HPP
+
+#include <cmath>
+#include <cstdio>
+
+// Counts a failure and prints the expression if x is false
+#define CHECK(x) Check((x), #x, __FILE__, __LINE__)
+
+void Check(bool condition, const char* expression, const char* file, int line);
+
+inline bool NearlyEqual(float a, float b, float epsilon = 1e-5f) { return fabsf(a - b) <= epsilon; }
+
+// Each test file has one entry point that main() calls
+void TestSimpleMultiDraw();
+void TestSimpleGeometryMesh();
+void TestSymbol();
+void TestCopyOnWriteVector();
+void TestSimpleMeshAdjacency();
+void TestSimpleGeometrySequence();
+void TestSimpleSkinningEngine();
+void TestSimpleFrustumCuller();
+void TestSimpleOcclusionCuller();
+void TestGL1GL2Tools();
+void TestSimpleRenderStats();
+
+#endif
@@ -0,0 +1,84 @@
+#include <fluxions_copy_on_write_vector.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	using IntVector = TCopyOnWriteVector<int>;
+
+	void TestSharing() {
+		IntVector a(std::vector<int>{ 1, 2, 3 });
+		CHECK(!a.isShared());
+		IntVector b = a;
+		CHECK(a.isShared() && b.isShared());
+		CHECK(a.vec().data() == b.vec().data());
+
+		// reading through const access or vec() keeps the buffer shared
+		const IntVector& constB = b;
+		CHECK(constB[1] == 2 && constB.size() == 3 && constB.back() == 3);
+		int sum = 0;
+		for (int x : constB) {
+			sum += x;
+		}
+		CHECK(sum == 6);
+		CHECK(b.vec()[0] == 1);
+		CHECK(a == b);
+		CHECK(a.isShared());
+
+		// writing detaches only the container that is written
+		const int* shared = a.vec().data();
+		b[0] = 10;
+		CHECK(!a.isShared() && !b.isShared());
+		CHECK(a.vec().data() == shared);
+		CHECK(b.vec().data() != shared);
+		CHECK(a.vec()[0] == 1 && b.vec()[0] == 10);
+		CHECK(a != b);
+	}
+
+	void TestWritesDetach() {
+		IntVector a(std::vector<int>{ 1, 2, 3 });
+
+		IntVector b = a;
+		b.push_back(4);
+		CHECK(a.size() == 3 && b.size() == 4);
+
+		IntVector c = a;
+		*c.begin() = 7;
+		CHECK(a.vec()[0] == 1 && c.vec()[0] == 7);
+
+		IntVector d = a;
+		d.data()[2] = 9;
+		CHECK(a.vec()[2] == 3 && d.vec()[2] == 9);
+
+		IntVector e = a;
+		e.resize(1);
+		CHECK(a.size() == 3 && e.size() == 1);
+
+		// a container that is not shared keeps its buffer
+		const int* owned = e.vec().data();
+		e[0] = 5;
+		CHECK(e.vec().data() == owned);
+
+		// clearing a shared buffer drops it without changing the other container
+		IntVector f = a;
+		f.clear();
+		CHECK(f.empty() && a.size() == 3 && !a.isShared());
+
+		// swapping with a std::vector gives the other container's elements back
+		IntVector g = a;
+		std::vector<int> other{ 8 };
+		g.swap(other);
+		CHECK(g.size() == 1 && g.vec()[0] == 8);
+		CHECK(other.size() == 3 && a.size() == 3);
+
+		IntVector empty;
+		CHECK(empty.empty() && !empty.isShared());
+		empty.push_back(1);
+		CHECK(empty.size() == 1);
+	}
+}
+
+void TestCopyOnWriteVector() {
+	TestSharing();
+	TestWritesDetach();
+}
@@ -0,0 +1,200 @@
+#include <fluxions_gl1gl2_tools.hpp>
+#include "fluxions-base-tests.hpp"
+
+namespace {
+	// GLEW calls the GL 1.2+ entry points through pointers, so they can be replaced by
+	// recorders and the state cache can be tested without a context. The GL 1.1 calls
+	// go to the GL library, which ignores them without a current context.
+	struct RecordedState {
+		int calls = 0;
+		int activeTextureCalls = 0;
+		GLuint program = 0;
+		GLuint vao = 0;
+		GLuint arrayBuffer = 0;
+		GLuint elementArrayBuffer = 0;
+		GLenum activeTexture = GL_TEXTURE0;
+		GLenum blendFunc[4] = { 0, 0, 0, 0 };
+		GLenum blendEquation[2] = { 0, 0 };
+	} recorded;
+
+	void GLAPIENTRY RecordUseProgram(GLuint program) {
+		recorded.calls++;
+		recorded.program = program;
+	}
+
+	void GLAPIENTRY RecordBindVertexArray(GLuint vao) {
+		recorded.calls++;
+		recorded.vao = vao;
+	}
+
+	void GLAPIENTRY RecordBindBuffer(GLenum target, GLuint buffer) {
+		recorded.calls++;
+		if (target == GL_ARRAY_BUFFER)
+			recorded.arrayBuffer = buffer;
+		else if (target == GL_ELEMENT_ARRAY_BUFFER)
+			recorded.elementArrayBuffer = buffer;
+	}
+
+	void GLAPIENTRY RecordActiveTexture(GLenum texture) {
+		recorded.activeTextureCalls++;
+		recorded.activeTexture = texture;
+	}
+
+	void GLAPIENTRY RecordBindSampler(GLuint, GLuint) {}
+
+	void GLAPIENTRY RecordBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+		recorded.blendFunc[0] = srcRGB;
+		recorded.blendFunc[1] = dstRGB;
+		recorded.blendFunc[2] = srcAlpha;
+		recorded.blendFunc[3] = dstAlpha;
+	}
+
+	void GLAPIENTRY RecordBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+		recorded.blendEquation[0] = modeRGB;
+		recorded.blendEquation[1] = modeAlpha;
+	}
+
+	void RecordGLCalls() {
+		__glewUseProgram = RecordUseProgram;
+		__glewBindVertexArray = RecordBindVertexArray;
+		__glewBindBuffer = RecordBindBuffer;
+		__glewActiveTexture = RecordActiveTexture;
+		__glewBindSampler = RecordBindSampler;
+		__glewBlendFuncSeparate = RecordBlendFuncSeparate;
+		__glewBlendEquationSeparate = RecordBlendEquationSeparate;
+		// known, so FxSetActiveTexture() does not query it
+		g_MaxCombinedTextureUnits = 8;
+		recorded = RecordedState();
+	}
+
+	void TestGraphicsStateCache() {
+		RecordGLCalls();
+		FxEnableGraphicsStateCache(true);
+		FxResetGraphicsStateStats();
+
+		FxUseProgram(3);
+		FxUseProgram(3);
+		CHECK(recorded.calls == 1);
+		FxUseProgram(4);
+		CHECK(recorded.calls == 2 && recorded.program == 4);
+		CHECK(FxGetGraphicsStateStats().issuedCalls == 2);
+		CHECK(FxGetGraphicsStateStats().filteredCalls == 1);
+
+		// the element array buffer belongs to the VAO, the array buffer does not
+		recorded.calls = 0;
+		FxBindVertexArray(1);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+		FxBindBuffer(GL_ARRAY_BUFFER, 8);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+		CHECK(recorded.calls == 3);
+		FxBindVertexArray(1);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+		CHECK(recorded.calls == 3);
+		FxBindVertexArray(2);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+		FxBindBuffer(GL_ARRAY_BUFFER, 8);
+		CHECK(recorded.calls == 5);
+
+		// texture units are tracked as unit numbers or GL_TEXTURE0 + unit
+		CHECK(FxSetActiveTexture(3) == 3);
+		CHECK(FxSetActiveTexture(GL_TEXTURE3) == 3);
+		CHECK(recorded.activeTextureCalls == 1 && recorded.activeTexture == GL_TEXTURE3);
+		CHECK(FxSetActiveTexture(8) == -1);
+
+		// after invalidation or with the cache disabled every call is issued
+		recorded.calls = 0;
+		FxInvalidateGraphicsState();
+		FxUseProgram(4);
+		CHECK(recorded.calls == 1);
+		FxEnableGraphicsStateCache(false);
+		FxUseProgram(4);
+		FxUseProgram(4);
+		CHECK(recorded.calls == 3);
+		FxEnableGraphicsStateCache(true);
+	}
+
+	void SetKnownState() {
+		FxUseProgram(3);
+		FxBindVertexArray(4);
+		FxBindBuffer(GL_ARRAY_BUFFER, 5);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 6);
+		FxBindTexture(0, GL_TEXTURE_2D, 7);
+		FxBlendFuncSeparate(GL_ONE, GL_ZERO, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		FxBlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
+		FxEnable(GL_BLEND);
+		FxDisable(GL_CULL_FACE);
+		FxEnable(GL_DEPTH_TEST);
+		FxDisable(GL_SCISSOR_TEST);
+		FxViewport(0, 0, 640, 480);
+		FxScissor(1, 2, 3, 4);
+		// a unit other than the one FxSaveGraphicsState uses for the texture binding
+		FxSetActiveTexture(2);
+	}
+
+	void TestSaveGraphicsState() {
+		RecordGLCalls();
+		FxEnableGraphicsStateCache(true);
+		SetKnownState();
+
+		// with the state known, saving reads only the shadow copy
+		FxResetGraphicsStateStats();
+		{
+			FxSaveGraphicsState save;
+			CHECK(FxGetGraphicsStateStats().queryCalls == 0);
+			CHECK(recorded.activeTexture == GL_TEXTURE0);
+
+			// change everything behind the shadow copy
+			glUseProgram(9);
+			glBindVertexArray(10);
+			glBindBuffer(GL_ARRAY_BUFFER, 11);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 12);
+			glActiveTexture(GL_TEXTURE5);
+			glBlendFuncSeparate(GL_ZERO, GL_ONE, GL_ZERO, GL_ONE);
+			glBlendEquationSeparate(GL_MIN, GL_MIN);
+		}
+		CHECK(recorded.program == 3 && recorded.vao == 4);
+		CHECK(recorded.arrayBuffer == 5 && recorded.elementArrayBuffer == 6);
+		CHECK(recorded.activeTexture == GL_TEXTURE2);
+		CHECK(recorded.blendFunc[0] == GL_ONE && recorded.blendFunc[1] == GL_ZERO);
+		CHECK(recorded.blendFunc[2] == GL_SRC_ALPHA && recorded.blendFunc[3] == GL_ONE_MINUS_SRC_ALPHA);
+		CHECK(recorded.blendEquation[0] == GL_FUNC_ADD && recorded.blendEquation[1] == GL_MAX);
+
+		// the restore leaves the shadow copy matching the restored state
+		recorded.calls = 0;
+		recorded.activeTextureCalls = 0;
+		FxUseProgram(3);
+		FxBindVertexArray(4);
+		CHECK(FxSetActiveTexture(2) == 2);
+		CHECK(recorded.calls == 0 && recorded.activeTextureCalls == 0);
+		FxResetGraphicsStateStats();
+		{
+			FxSaveGraphicsState save;
+		}
+		CHECK(FxGetGraphicsStateStats().queryCalls == 0);
+
+		// with nothing known every value is queried
+		FxInvalidateGraphicsState();
+		FxResetGraphicsStateStats();
+		{
+			FxSaveGraphicsState save;
+			CHECK(FxGetGraphicsStateStats().queryCalls == 18);
+		}
+
+		// a disabled cache queries every time
+		FxEnableGraphicsStateCache(false);
+		FxResetGraphicsStateStats();
+		{
+			FxSaveGraphicsState save;
+		}
+		{
+			FxSaveGraphicsState save;
+		}
+		CHECK(FxGetGraphicsStateStats().queryCalls == 36);
+		FxEnableGraphicsStateCache(true);
+	}
+}
+
+void TestGL1GL2Tools() {
+	TestGraphicsStateCache();
+	TestSaveGraphicsState();
+}
@@ -0,0 +1,75 @@
+#include <fluxions_simple_frustum_culler.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	BoundingBoxf MakeBox(float x0, float y0, float z0, float x1, float y1, float z1) {
+		BoundingBoxf box;
+		box.minBounds = Vector3f(x0, y0, z0);
+		box.maxBounds = Vector3f(x1, y1, z1);
+		return box;
+	}
+
+	bool PlaneIs(const float* plane, float a, float b, float c, float d) {
+		return NearlyEqual(plane[0], a, 1e-6f) && NearlyEqual(plane[1], b, 1e-6f) &&
+			NearlyEqual(plane[2], c, 1e-6f) && NearlyEqual(plane[3], d, 1e-6f);
+	}
+
+	void TestPlanes() {
+		// with the identity the frustum is the clip cube
+		SimpleFrustumCuller culler;
+		culler.setViewProjection(Matrix4f());
+		CHECK(PlaneIs(culler.plane(0), 1, 0, 0, 1));
+		CHECK(PlaneIs(culler.plane(1), -1, 0, 0, 1));
+		CHECK(PlaneIs(culler.plane(2), 0, 1, 0, 1));
+		CHECK(PlaneIs(culler.plane(3), 0, -1, 0, 1));
+		CHECK(PlaneIs(culler.plane(4), 0, 0, 1, 1));
+		CHECK(PlaneIs(culler.plane(5), 0, 0, -1, 1));
+
+		// plane normals have unit length
+		Matrix4f scaled;
+		scaled.m11 = 2.0f;
+		culler.setViewProjection(scaled);
+		CHECK(PlaneIs(culler.plane(0), 1, 0, 0, 0.5f));
+	}
+
+	void TestVisibility() {
+		// box i is visible when i is a multiple of 3, spanning three words of bits
+		SimpleFrustumCuller culler;
+		const size_t count = 130;
+		for (size_t i = 0; i < count; i++) {
+			float x = i % 3 == 0 ? 0.0f : 5.0f;
+			culler.add(MakeBox(x - 0.1f, -0.1f, -0.1f, x + 0.1f, 0.1f, 0.1f));
+		}
+		culler.setViewProjection(Matrix4f());
+		for (unsigned threads = 1; threads <= 4; threads += 3) {
+			culler.cull(threads);
+			CHECK(culler.visibility().size() == 3);
+			CHECK(culler.visibleCount() == 44);
+			bool matches = true;
+			for (size_t i = 0; i < count; i++) {
+				bool bit = (culler.visibility()[i >> 6] >> (i & 63)) & 1;
+				matches = matches && bit == (i % 3 == 0) && culler.visible(i) == bit;
+			}
+			CHECK(matches);
+		}
+
+		culler.hide(129);
+		CHECK(!culler.visible(129));
+		CHECK(culler.visibleCount() == 43);
+
+		// boxes added since the last cull and empty boxes are visible
+		size_t late = culler.add(MakeBox(9, 9, 9, 10, 10, 10));
+		CHECK(culler.visible(late));
+		size_t empty = culler.add(BoundingBoxf());
+		culler.cull(1);
+		CHECK(!culler.visible(late));
+		CHECK(culler.visible(empty));
+	}
+}
+
+void TestSimpleFrustumCuller() {
+	TestPlanes();
+	TestVisibility();
+}
@@ -0,0 +1,454 @@
+#include <fluxions_simple_geometry_mesh.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	using SurfaceType = SimpleGeometryMesh::SurfaceType;
+
+	// Adds a surface of two triangles covering the unit square at origin
+	int AddQuad(SimpleGeometryMesh& mesh, const std::string& material, const Vector3f& origin) {
+		const float positions[12] = {
+			origin.x, origin.y, origin.z,
+			origin.x + 1, origin.y, origin.z,
+			origin.x + 1, origin.y + 1, origin.z,
+			origin.x, origin.y + 1, origin.z
+		};
+		const unsigned indices[6] = { 0, 1, 2, 0, 2, 3 };
+		mesh.setMaterial(material);
+		mesh.beginSurface(SurfaceType::Triangles);
+		unsigned first = mesh.addVertices(positions, nullptr, nullptr, 4);
+		mesh.addIndices(indices, 6, first);
+		return mesh.commitSurface();
+	}
+
+	// Adds a surface of one triangle at origin
+	int AddTriangle(SimpleGeometryMesh& mesh, const std::string& material, const Vector3f& origin) {
+		const float positions[9] = {
+			origin.x, origin.y, origin.z,
+			origin.x + 2, origin.y, origin.z,
+			origin.x, origin.y, origin.z + 2
+		};
+		const unsigned indices[3] = { 0, 1, 2 };
+		mesh.setMaterial(material);
+		mesh.beginSurface(SurfaceType::Triangles);
+		unsigned first = mesh.addVertices(positions, nullptr, nullptr, 3);
+		mesh.addIndices(indices, 3, first);
+		return mesh.commitSurface();
+	}
+
+	// Adds a surface of size x size quads, each with its own 4 vertices
+	int AddGrid(SimpleGeometryMesh& mesh, const std::string& material, unsigned size, const Vector3f& origin) {
+		std::vector<float> positions;
+		std::vector<unsigned> indices;
+		positions.reserve(size * size * 12);
+		indices.reserve(size * size * 6);
+		for (unsigned y = 0; y < size; y++) {
+			for (unsigned x = 0; x < size; x++) {
+				const unsigned base = (unsigned)positions.size() / 3;
+				const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+				for (auto& corner : corners) {
+					positions.push_back(origin.x + x + corner[0]);
+					positions.push_back(origin.y + y + corner[1]);
+					positions.push_back(origin.z);
+				}
+				for (unsigned i : { 0, 1, 2, 0, 2, 3 }) {
+					indices.push_back(base + i);
+				}
+			}
+		}
+		mesh.setMaterial(material);
+		mesh.beginSurface(SurfaceType::Triangles);
+		unsigned first = mesh.addVertices(positions.data(), nullptr, nullptr, positions.size() / 3);
+		mesh.addIndices(indices.data(), indices.size(), first);
+		return mesh.commitSurface();
+	}
+
+	// Writes a file to the working directory
+	void WriteTextFile(const std::string& filename, const char* text) {
+		std::ofstream fout(filename);
+		fout << text;
+	}
+
+	// Every index of each surface is inside the vertex range of that surface
+	bool SurfaceRangesAreValid(const SimpleGeometryMesh& mesh) {
+		const auto& indices = mesh.Indices.vec();
+		for (const auto& surface : mesh.Surfaces.vec()) {
+			if ((size_t)surface.first + surface.count > indices.size())
+				return false;
+			for (unsigned i = surface.first; i < surface.first + surface.count; i++) {
+				if (indices[i] < surface.baseVertex || indices[i] >= surface.baseVertex + surface.vertexCount)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void TestShareDuplicateSurfaces() {
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(mesh, "a", Vector3f(0, 0, 0));
+		AddQuad(mesh, "b", Vector3f(0, 0, 0));
+		AddTriangle(mesh, "c", Vector3f(5, 0, 0));
+		AddQuad(mesh, "d", Vector3f(10, 0, 0));
+		CHECK(mesh.computeSurfaceHash(mesh.Surfaces.vec()[0]) == mesh.computeSurfaceHash(mesh.Surfaces.vec()[1]));
+		CHECK(mesh.computeSurfaceHash(mesh.Surfaces.vec()[0]) != mesh.computeSurfaceHash(mesh.Surfaces.vec()[3]));
+		CHECK(mesh.computeSurfaceHash(mesh.Surfaces.vec()[0], true) == mesh.computeSurfaceHash(mesh.Surfaces.vec()[3], true));
+
+		// only the exact duplicate is shared, and its vertices and indices are removed
+		CHECK(mesh.shareDuplicateSurfaces() == 1);
+		const auto& surfaces = mesh.Surfaces.vec();
+		CHECK(mesh.getVertexCount() == 11);
+		CHECK(mesh.getIndexCount() == 15);
+		CHECK(surfaces[1].instanceOf == 0);
+		CHECK(surfaces[1].first == surfaces[0].first && surfaces[1].count == 6);
+		CHECK(surfaces[1].materialName == "b");
+		CHECK(surfaces[3].instanceOf < 0);
+
+		// the vertex ranges follow the compacted vertices
+		CHECK(SurfaceRangesAreValid(mesh));
+		CHECK(surfaces[2].baseVertex == 4 && surfaces[2].vertexCount == 3);
+		CHECK(surfaces[3].baseVertex == 7 && surfaces[3].vertexCount == 4);
+
+		// nothing left to share
+		CHECK(mesh.shareDuplicateSurfaces() == 0);
+
+		// translated copies are shared with the offset between them
+		SimpleGeometryMesh translated;
+		translated.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(translated, "a", Vector3f(0, 0, 0));
+		AddTriangle(translated, "c", Vector3f(5, 0, 0));
+		AddQuad(translated, "b", Vector3f(0, 0, 0));
+		AddQuad(translated, "d", Vector3f(10, 0, 0));
+		CHECK(translated.shareDuplicateSurfaces(true) == 2);
+		const auto& translatedSurfaces = translated.Surfaces.vec();
+		CHECK(translated.getVertexCount() == 7);
+		CHECK(translatedSurfaces[2].instanceOf == 0 && NearlyEqual(translatedSurfaces[2].instanceOffset.x, 0));
+		CHECK(translatedSurfaces[3].instanceOf == 0 && NearlyEqual(translatedSurfaces[3].instanceOffset.x, 10));
+		CHECK(translatedSurfaces[1].baseVertex == 4);
+		CHECK(SurfaceRangesAreValid(translated));
+	}
+
+	void TestChunkSurfaces() {
+		// 8 x 8 quads are 128 triangles, split into chunks of at most 16
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddGrid(mesh, "a", 8, Vector3f(0, 0, 0));
+		AddQuad(mesh, "b", Vector3f(0, 0, 5));
+		CHECK(mesh.chunkSurfaces(16) == 9);
+		const auto& surfaces = mesh.Surfaces.vec();
+		unsigned triangles = 0;
+		bool chunksFit = true;
+		for (unsigned s = 0; s < 8; s++) {
+			chunksFit = chunksFit && surfaces[s].count <= 48 && surfaces[s].materialName == "a";
+			triangles += surfaces[s].count / 3;
+		}
+		CHECK(chunksFit);
+		CHECK(triangles == 128);
+		CHECK(surfaces[8].materialName == "b" && surfaces[8].count == 6);
+		CHECK(mesh.getIndexCount() == 128 * 3 + 6);
+		CHECK(SurfaceRangesAreValid(mesh));
+
+		// 180 x 180 quads have 129600 vertices, so the vertex range limits the chunks
+		SimpleGeometryMesh large;
+		large.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddGrid(large, "a", 180, Vector3f(0, 0, 0));
+		AddGrid(large, "a", 180, Vector3f(0, 0, 10));
+		CHECK(large.shareDuplicateSurfaces(true) == 1);
+		unsigned surfaceCount = large.chunkSurfaces(1u << 30);
+		const auto& largeSurfaces = large.Surfaces.vec();
+		CHECK(surfaceCount >= 4 && surfaceCount % 2 == 0);
+		bool rangesFit = true;
+		for (const auto& surface : largeSurfaces) {
+			rangesFit = rangesFit && surface.vertexCount <= SimpleGeometryMesh::MaxChunkVertices;
+		}
+		CHECK(rangesFit);
+		CHECK(SurfaceRangesAreValid(large));
+
+		// the instance was split into one instance of each chunk of its owner
+		const unsigned ownerChunks = surfaceCount / 2;
+		bool instancesMatch = true;
+		for (unsigned k = 0; k < ownerChunks; k++) {
+			const auto& owner = largeSurfaces[k];
+			const auto& instance = largeSurfaces[ownerChunks + k];
+			instancesMatch = instancesMatch && owner.instanceOf < 0 && instance.instanceOf == (int)k &&
+				instance.first == owner.first && instance.count == owner.count &&
+				NearlyEqual(instance.instanceOffset.z, 10);
+		}
+		CHECK(instancesMatch);
+		CHECK(large.getVertexCount() == 180 * 180 * 4);
+
+		// indices past the last whole triangle are dropped
+		SimpleGeometryMesh partial;
+		partial.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		const float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+		const unsigned indices[7] = { 0, 1, 2, 2, 1, 0, 0 };
+		partial.beginSurface(SurfaceType::Triangles);
+		partial.addVertices(positions, nullptr, nullptr, 3);
+		partial.addIndices(indices, 7);
+		partial.commitSurface();
+		CHECK(partial.Surfaces.vec()[0].count == 7);
+		CHECK(partial.chunkSurfaces(16) == 1);
+		CHECK(partial.Surfaces.vec()[0].count == 6 && partial.getIndexCount() == 6);
+	}
+
+	// The indices of every original surface are found where SurfaceRemaps says they went
+	bool RemapsMatch(const SimpleGeometryMesh& mesh, const std::vector<std::vector<unsigned>>& original) {
+		if (mesh.SurfaceRemaps.size() != original.size())
+			return false;
+		const auto& indices = mesh.Indices.vec();
+		const auto& surfaces = mesh.Surfaces.vec();
+		for (size_t s = 0; s < original.size(); s++) {
+			const auto& remap = mesh.SurfaceRemaps[s];
+			const auto& surface = surfaces[remap.surface];
+			if (remap.count != original[s].size() || remap.first < surface.first || remap.first + remap.count > surface.first + surface.count)
+				return false;
+			if (!std::equal(original[s].begin(), original[s].end(), indices.begin() + remap.first))
+				return false;
+		}
+		return true;
+	}
+
+	void TestMergeSurfacesByMaterial() {
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(mesh, "merge-x", Vector3f(0, 0, 0));
+		AddQuad(mesh, "merge-y", Vector3f(2, 0, 0));
+		AddQuad(mesh, "merge-x", Vector3f(4, 0, 0));
+		AddTriangle(mesh, "merge-y", Vector3f(6, 0, 0));
+		std::vector<std::vector<unsigned>> original;
+		for (const auto& surface : mesh.Surfaces.vec()) {
+			auto first = mesh.Indices.vec().begin() + surface.first;
+			original.emplace_back(first, first + surface.count);
+		}
+
+		CHECK(mesh.mergeSurfacesByMaterial() == 2);
+		const auto& surfaces = mesh.Surfaces.vec();
+		CHECK(surfaces.size() == 2);
+		CHECK(surfaces[0].materialName == "merge-x" && surfaces[0].first == 0 && surfaces[0].count == 12);
+		CHECK(surfaces[1].materialName == "merge-y" && surfaces[1].first == 12 && surfaces[1].count == 9);
+		CHECK(mesh.SurfaceRemaps.size() == 4);
+		CHECK(mesh.SurfaceRemaps[2].surface == 0 && mesh.SurfaceRemaps[2].first == 6);
+		CHECK(mesh.SurfaceRemaps[3].surface == 1 && mesh.SurfaceRemaps[3].first == 18 && mesh.SurfaceRemaps[3].count == 3);
+		CHECK(RemapsMatch(mesh, original));
+		CHECK(SurfaceRangesAreValid(mesh));
+
+		// merging again changes nothing and the remaps still point at the original faces
+		CHECK(mesh.mergeSurfacesByMaterial() == 0);
+		CHECK(RemapsMatch(mesh, original));
+
+		// shared surfaces and their owners keep their own ranges
+		SimpleGeometryMesh shared;
+		shared.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(shared, "merge-x", Vector3f(0, 0, 0));
+		AddQuad(shared, "merge-x", Vector3f(0, 0, 0));
+		AddQuad(shared, "merge-x", Vector3f(3, 0, 0));
+		AddQuad(shared, "merge-x", Vector3f(5, 0, 0));
+		CHECK(shared.shareDuplicateSurfaces() == 1);
+		CHECK(shared.mergeSurfacesByMaterial() == 1);
+		const auto& sharedSurfaces = shared.Surfaces.vec();
+		CHECK(sharedSurfaces.size() == 3);
+		CHECK(sharedSurfaces[0].count == 6 && sharedSurfaces[0].instanceOf < 0);
+		CHECK(sharedSurfaces[1].instanceOf == 0 && sharedSurfaces[1].first == sharedSurfaces[0].first);
+		CHECK(sharedSurfaces[2].count == 12);
+		CHECK(SurfaceRangesAreValid(shared));
+	}
+
+	void TestLoadOptionsKey() {
+		using LoadOptions = SimpleGeometryMesh::LoadOptions;
+		LoadOptions options;
+		CHECK(options.key() != 0);
+		CHECK(options.key() == LoadOptions().key());
+
+		// options that only change how the mesh is loaded keep the key
+		LoadOptions quiet;
+		quiet.verbosity = LoadOptions::Verbosity::Quiet;
+		quiet.cachePolicy = LoadOptions::CachePolicy::Ignore;
+		quiet.writeCacheInBackground = !options.writeCacheInBackground;
+		CHECK(quiet.key() == options.key());
+
+		// options that change the loaded data change the key
+		LoadOptions changed[6];
+		changed[0].computeTangents = !options.computeTangents;
+		changed[1].computeBounds = !options.computeBounds;
+		changed[2].optimizeIndexing = !options.optimizeIndexing;
+		changed[3].sanitize = LoadOptions::Sanitize::None;
+		changed[4].scaleToSize = 2.0f;
+		changed[5].trianglesPerChunk = 1000;
+		for (auto& o : changed) {
+			CHECK(o.key() != options.key());
+		}
+	}
+
+	void TestCacheRoundTrip() {
+		const unsigned key = SimpleGeometryMesh::LoadOptions().key();
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(mesh, "cache-x", Vector3f(0, 0, 0));
+		AddTriangle(mesh, "cache-y", Vector3f(3, 0, 0));
+		mesh.Surfaces[1].surfaceName = "cache-triangle";
+		mesh.ensureBounds();
+		CHECK(mesh.optionsKey() == key);
+
+		std::stringstream cache;
+		CHECK(mesh.saveCache(cache));
+		const std::string bytes = cache.str();
+
+		SimpleGeometryMesh loaded;
+		std::istringstream fin(bytes);
+		CHECK(loaded.loadCache(fin, key));
+		CHECK(loaded.optionsKey() == key);
+		CHECK(loaded.Vertices.size() == mesh.Vertices.size());
+		CHECK(loaded.Indices.vec() == mesh.Indices.vec());
+		CHECK(loaded.Surfaces.size() == 2);
+		const auto& surface = loaded.Surfaces.vec()[1];
+		CHECK(surface.materialName == "cache-y" && surface.surfaceName == "cache-triangle");
+		CHECK(surface.first == 6 && surface.count == 3);
+		CHECK(loaded.hasAttributes(SimpleGeometryMesh::BoundsAttribute));
+		bool positionsMatch = true;
+		for (size_t i = 0; i < mesh.Vertices.size(); i++) {
+			const Vector3f& a = loaded.Vertices.vec()[i].position;
+			const Vector3f& b = mesh.Vertices.vec()[i].position;
+			positionsMatch = positionsMatch && a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+		CHECK(positionsMatch);
+
+		// a key of 0 accepts any options, another key is rejected
+		std::istringstream any(bytes);
+		CHECK(loaded.loadCache(any, 0));
+		SimpleGeometryMesh::LoadOptions other;
+		other.optimizeIndexing = true;
+		SimpleGeometryMesh rejected;
+		std::istringstream mismatch(bytes);
+		CHECK(!rejected.loadCache(mismatch, other.key()));
+
+		// so is a cache with another version
+		std::string oldVersion = bytes;
+		oldVersion[4]++;
+		std::istringstream old(oldVersion);
+		CHECK(!rejected.loadCache(old, 0));
+	}
+
+	bool PagesMatch(const SimpleGeometryMesh::SurfacePage& a, const SimpleGeometryMesh::SurfacePage& b) {
+		if (a.indices != b.indices || a.vertices.size() != b.vertices.size())
+			return false;
+		for (size_t i = 0; i < a.vertices.size(); i++) {
+			const Vector3f& p = a.vertices[i].position;
+			const Vector3f& q = b.vertices[i].position;
+			if (p.x != q.x || p.y != q.y || p.z != q.z)
+				return false;
+		}
+		return true;
+	}
+
+	void TestPageSurfaces() {
+		const std::string filename = "fluxions_mesh_tests_paging.obj";
+		WriteTextFile(filename,
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 5 0 0\nv 6 0 0\nv 5 0 1\n"
+			"g quad\nusemtl paging-x\nf 1 2 3\nf 1 3 4\n"
+			"g triangle\nusemtl paging-y\nf 5 6 7\n");
+
+		SimpleGeometryMesh::LoadOptions options;
+		options.cachePolicy = SimpleGeometryMesh::LoadOptions::CachePolicy::WriteOnly;
+		options.writeCacheInBackground = false;
+		options.verbosity = SimpleGeometryMesh::LoadOptions::Verbosity::Quiet;
+		SimpleGeometryMesh mesh;
+		CHECK(mesh.loadOBJ(filename, options));
+		CHECK(SimpleGeometryMesh::isCacheCurrent(filename + ".cache", filename, options.key()));
+		CHECK(!SimpleGeometryMesh::isCacheCurrent(filename + ".cache", filename, options.key() + 1));
+
+		std::vector<std::shared_ptr<const SimpleGeometryMesh::SurfacePage>> resident;
+		for (unsigned s = 0; s < mesh.Surfaces.size(); s++) {
+			resident.push_back(mesh.pageSurface(s));
+			CHECK(resident.back() != nullptr);
+		}
+		CHECK(resident.size() >= 2);
+		const size_t vertexCount = mesh.Vertices.size();
+
+		// cached surfaces page in the same geometry the resident mesh had
+		mesh.cacheToDisk();
+		CHECK(mesh.cached());
+		CHECK(mesh.Vertices.empty() && mesh.Indices.empty());
+		bool matches = true;
+		for (unsigned s = 0; s < resident.size(); s++) {
+			auto page = mesh.pageSurface(s);
+			matches = matches && page && resident[s] && PagesMatch(*page, *resident[s]);
+		}
+		CHECK(matches);
+		CHECK(mesh.pageSurface((unsigned)resident.size()) == nullptr);
+
+		mesh.fetchCache();
+		CHECK(mesh.Vertices.size() == vertexCount);
+		CHECK(SurfaceRangesAreValid(mesh));
+
+		remove(filename.c_str());
+		remove((filename + ".cache").c_str());
+	}
+
+	void TestTopologyRevision() {
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		AddQuad(mesh, "topology-x", Vector3f(0, 0, 0));
+		const unsigned revision = mesh.topologyRevision();
+		CHECK(revision != SimpleGeometryMesh::PendingTopologyRevision);
+		CHECK(mesh.topologyRevision() == revision);
+
+		// copies share the revision until either changes its topology
+		SimpleGeometryMesh copy = mesh;
+		CHECK(copy.topologyRevision() == revision);
+		copy.topologyChanged();
+		CHECK(copy.topologyRevision() != revision && mesh.topologyRevision() == revision);
+
+		// while indices are added one at a time the revision is pending
+		mesh.beginSurface(SurfaceType::Triangles);
+		mesh.position3f(0, 0, 1);
+		mesh.position3f(1, 0, 1);
+		mesh.position3f(0, 1, 1);
+		mesh.addIndex(4);
+		mesh.addIndex(5);
+		mesh.addIndex(6);
+		CHECK(mesh.topologyRevision() == SimpleGeometryMesh::PendingTopologyRevision);
+		CHECK(mesh.topologyRevision() == SimpleGeometryMesh::PendingTopologyRevision);
+		CHECK(mesh.commitSurface() == 1);
+		const unsigned committed = mesh.topologyRevision();
+		CHECK(committed != SimpleGeometryMesh::PendingTopologyRevision && committed != revision);
+		CHECK(mesh.topologyRevision() == committed);
+	}
+
+	void TestLoadedNormals() {
+		const std::string filename = "fluxions_mesh_tests_normals.obj";
+		WriteTextFile(filename,
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 3\nvn 0 2 0\n"
+			"f 1//1 2//1 3//2\n");
+
+		SimpleGeometryMesh::LoadOptions options;
+		options.cachePolicy = SimpleGeometryMesh::LoadOptions::CachePolicy::Ignore;
+		options.verbosity = SimpleGeometryMesh::LoadOptions::Verbosity::Quiet;
+		SimpleGeometryMesh mesh;
+		CHECK(mesh.loadOBJ(filename, options));
+		remove(filename.c_str());
+
+		// normals are normalized even though tangents are left for later
+		CHECK(mesh.hasAttributes(SimpleGeometryMesh::NormalsAttribute | SimpleGeometryMesh::BoundsAttribute));
+		CHECK(!mesh.hasAttributes(SimpleGeometryMesh::TangentsAttribute));
+		CHECK(mesh.Vertices.size() == 3);
+		bool unitLength = mesh.Vertices.size() == 3;
+		for (const auto& vertex : mesh.Vertices.vec()) {
+			unitLength = unitLength && NearlyEqual(vertex.normal.length(), 1.0f);
+		}
+		CHECK(unitLength);
+		CHECK(NearlyEqual(mesh.Vertices.vec()[0].normal.z, 1.0f));
+		CHECK(NearlyEqual(mesh.Vertices.vec()[2].normal.y, 1.0f));
+	}
+}
+
+void TestSimpleGeometryMesh() {
+	TestShareDuplicateSurfaces();
+	TestChunkSurfaces();
+	TestMergeSurfacesByMaterial();
+	TestLoadOptionsKey();
+	TestCacheRoundTrip();
+	TestPageSurfaces();
+	TestTopologyRevision();
+	TestLoadedNormals();
+}
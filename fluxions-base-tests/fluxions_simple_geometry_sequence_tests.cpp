@@ -0,0 +1,115 @@
+#include <fluxions_simple_geometry_sequence.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	const unsigned FrameCount = 5;
+
+	std::string FrameFilename(unsigned frame) {
+		return "fluxions_sequence_tests_" + std::to_string(frame) + ".obj";
+	}
+
+	// A quad whose corners move by different amounts, including through zero and across exponents
+	void WriteFrames() {
+		for (unsigned frame = 0; frame < FrameCount; frame++) {
+			const float t = (float)frame;
+			std::ofstream fout(FrameFilename(frame));
+			fout.precision(9);
+			fout << "v " << -t << " 0 0\n";
+			fout << "v " << 1.0f + t * 0.001f << " " << 1.0e-30f * t << " 0\n";
+			fout << "v " << 12345.678f - t * 1000.0f << " 1 " << (frame % 2 ? -0.0f : 0.0f) << "\n";
+			fout << "v 0 1 " << 0.5f * t * t << "\n";
+			fout << "vn 0 0 1\nvn 0 " << t << " 1\n";
+			fout << "f 1//1 2//1 3//2\nf 1//1 3//2 4//1\n";
+		}
+	}
+
+	void RemoveFrames(const std::string& cacheFilename) {
+		for (unsigned frame = 0; frame < FrameCount; frame++) {
+			remove(FrameFilename(frame).c_str());
+		}
+		remove(cacheFilename.c_str());
+	}
+
+	SimpleGeometryMesh::LoadOptions QuietOptions() {
+		SimpleGeometryMesh::LoadOptions options;
+		options.cachePolicy = SimpleGeometryMesh::LoadOptions::CachePolicy::Ignore;
+		options.verbosity = SimpleGeometryMesh::LoadOptions::Verbosity::Quiet;
+		return options;
+	}
+
+	// The positions and normals of frame are bit for bit those of loading its OBJ alone
+	bool FrameMatchesOBJ(SimpleGeometrySequence& sequence, unsigned frame) {
+		SimpleGeometryMesh mesh;
+		if (!mesh.loadOBJ(FrameFilename(frame), QuietOptions()))
+			return false;
+		auto decoded = sequence.frame(frame);
+		if (!decoded || decoded->index != frame || decoded->positions.size() != mesh.Vertices.size() || decoded->normals.size() != mesh.Vertices.size())
+			return false;
+		for (size_t i = 0; i < mesh.Vertices.size(); i++) {
+			const auto& vertex = mesh.Vertices.vec()[i];
+			if (memcmp(&decoded->positions[i], &vertex.position, sizeof(Vector3f)) != 0 ||
+				memcmp(&decoded->normals[i], &vertex.normal, sizeof(Vector3f)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool AllFramesMatch(SimpleGeometrySequence& sequence, const std::vector<unsigned>& order) {
+		bool matches = true;
+		for (unsigned frame : order) {
+			matches = FrameMatchesOBJ(sequence, frame) && matches;
+		}
+		return matches;
+	}
+
+	void TestRoundTrip() {
+		WriteFrames();
+		std::vector<std::string> filenames;
+		for (unsigned frame = 0; frame < FrameCount; frame++) {
+			filenames.push_back(FrameFilename(frame));
+		}
+		const std::string cacheFilename = "fluxions_sequence_tests.cache";
+		remove(cacheFilename.c_str());
+
+		// keyframes at 0, 2, and 4 with deltas in between
+		SimpleGeometrySequence sequence;
+		sequence.setKeyframeInterval(2);
+		CHECK(sequence.loadOBJSequence(filenames, QuietOptions(), cacheFilename));
+		CHECK(sequence.frameCount() == FrameCount);
+		CHECK(sequence.encodedSizeInBytes() > 0);
+		CHECK(AllFramesMatch(sequence, { 0, 1, 2, 3, 4 }));
+		CHECK(AllFramesMatch(sequence, { 3, 1, 4, 0 }));
+		CHECK(sequence.frame(FrameCount) == nullptr);
+
+		// applyFrame() only replaces positions and normals
+		SimpleGeometryMesh mesh = sequence.baseMesh();
+		CHECK(sequence.applyFrame(3, mesh));
+		auto frame3 = sequence.frame(3);
+		CHECK(memcmp(&mesh.Vertices.vec()[2].position, &frame3->positions[2], sizeof(Vector3f)) == 0);
+		CHECK(mesh.Indices.vec() == sequence.baseMesh().Indices.vec());
+		CHECK(!sequence.applyFrame(FrameCount, mesh));
+
+		// the same frames read back from the cache, decoded without the prefetch thread
+		SimpleGeometrySequence cached;
+		cached.setPrefetchFrames(0);
+		CHECK(cached.loadCache(cacheFilename));
+		CHECK(cached.frameCount() == FrameCount);
+		CHECK(AllFramesMatch(cached, { 4, 0, 1, 2, 3 }));
+
+		// a frame with another topology is rejected
+		{
+			std::ofstream fout(FrameFilename(FrameCount - 1));
+			fout << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+		}
+		SimpleGeometrySequence mismatched;
+		CHECK(!mismatched.loadOBJSequence(filenames, QuietOptions()));
+
+		RemoveFrames(cacheFilename);
+	}
+}
+
+void TestSimpleGeometrySequence() {
+	TestRoundTrip();
+}
@@ -0,0 +1,141 @@
+#include <fluxions_simple_mesh_adjacency.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	// Builds one Triangles surface from xy positions
+	void MakeMesh(SimpleGeometryMesh& mesh, const std::vector<float>& xy, const std::vector<unsigned>& indices) {
+		std::vector<float> positions;
+		for (size_t i = 0; i + 1 < xy.size(); i += 2) {
+			positions.insert(positions.end(), { xy[i], xy[i + 1], 0.0f });
+		}
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		mesh.beginSurface(SimpleGeometryMesh::SurfaceType::Triangles);
+		unsigned first = mesh.addVertices(positions.data(), nullptr, nullptr, positions.size() / 3);
+		mesh.addIndices(indices.data(), indices.size(), first);
+		mesh.commitSurface();
+	}
+
+	void TestQuad() {
+		SimpleGeometryMesh mesh;
+		MakeMesh(mesh, { 0, 0, 1, 0, 1, 1, 0, 1 }, { 0, 1, 2, 0, 2, 3 });
+		SimpleMeshAdjacency adjacency;
+		CHECK(adjacency.build(mesh));
+		CHECK(adjacency.triangleCount() == 2 && adjacency.vertexCount() == 4);
+
+		// the diagonal is the only shared edge
+		CHECK(adjacency.twin(2) == 3 && adjacency.twin(3) == 2);
+		CHECK(adjacency.boundaryEdges().size() == 4);
+		CHECK(adjacency.isBoundaryEdge(0) && !adjacency.isBoundaryEdge(2));
+		CHECK(adjacency.nonManifoldEdges().empty() && adjacency.nonManifoldVertices().empty());
+		bool allBoundary = true;
+		for (unsigned v = 0; v < 4; v++) {
+			allBoundary = allBoundary && adjacency.isBoundaryVertex(v) && !adjacency.isNonManifoldVertex(v);
+		}
+		CHECK(allBoundary);
+
+		auto ring = adjacency.oneRing(0);
+		CHECK(ring.size() == 3 && ring[0] == 1 && ring[1] == 2 && ring[2] == 3);
+		CHECK(adjacency.oneRing(1).size() == 2);
+		CHECK(adjacency.vertexCorners(0).size() == 2);
+		CHECK(adjacency.meshIndex(4) == 4);
+	}
+
+	void TestClosedFan() {
+		// four triangles around an interior vertex
+		SimpleGeometryMesh mesh;
+		MakeMesh(mesh, { 0, 0, 1, 0, 0, 1, -1, 0, 0, -1 }, { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 1 });
+		SimpleMeshAdjacency adjacency;
+		CHECK(adjacency.build(mesh));
+		CHECK(!adjacency.isBoundaryVertex(0) && !adjacency.isNonManifoldVertex(0));
+		CHECK(adjacency.isBoundaryVertex(1));
+		CHECK(adjacency.boundaryEdges().size() == 4);
+		CHECK(adjacency.oneRing(0).size() == 4);
+	}
+
+	void TestNonManifold() {
+		// three triangles on the edge between vertices 0 and 1
+		SimpleGeometryMesh fins;
+		MakeMesh(fins, { 0, 0, 1, 0, 0, 1, 0, -1, 1, 1 }, { 0, 1, 2, 1, 0, 3, 1, 0, 4 });
+		SimpleMeshAdjacency adjacency;
+		CHECK(adjacency.build(fins));
+		CHECK(adjacency.isNonManifoldEdge(0));
+		CHECK(adjacency.isNonManifoldEdge(3) && adjacency.isNonManifoldEdge(6));
+		CHECK(adjacency.nonManifoldEdges().size() == 1);
+		CHECK(adjacency.isNonManifoldVertex(0) && adjacency.isNonManifoldVertex(1));
+		CHECK(!adjacency.isNonManifoldVertex(2));
+
+		// two faces with opposite orientation on one edge
+		SimpleGeometryMesh flipped;
+		MakeMesh(flipped, { 0, 0, 1, 0, 0, 1, 0, -1 }, { 0, 1, 2, 0, 1, 3 });
+		CHECK(adjacency.build(flipped));
+		CHECK(adjacency.isNonManifoldEdge(0) && adjacency.isNonManifoldEdge(3));
+
+		// a bowtie only shares a vertex, so its edges are boundaries but the vertex has two fans
+		SimpleGeometryMesh bowtie;
+		MakeMesh(bowtie, { 0, 0, 1, -1, 1, 1, -1, 1, -1, -1 }, { 0, 1, 2, 0, 3, 4 });
+		CHECK(adjacency.build(bowtie));
+		CHECK(adjacency.nonManifoldEdges().empty());
+		CHECK(adjacency.boundaryEdges().size() == 6);
+		CHECK(adjacency.isNonManifoldVertex(0) && !adjacency.isNonManifoldVertex(1));
+		CHECK(adjacency.nonManifoldVertices().size() == 1);
+	}
+
+	void TestWeldAndDegenerates() {
+		// two triangles with their own vertices on the same positions, plus a degenerate one
+		SimpleGeometryMesh mesh;
+		MakeMesh(mesh, { 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1 }, { 0, 1, 2, 3, 4, 5, 0, 0, 1 });
+		SimpleMeshAdjacency adjacency;
+		CHECK(adjacency.build(mesh));
+		CHECK(adjacency.triangleCount() == 2 && adjacency.degenerateCount() == 1);
+		CHECK(adjacency.boundaryEdges().size() == 6);
+		CHECK(!adjacency.isWelded());
+
+		CHECK(adjacency.build(mesh, true));
+		CHECK(adjacency.isWelded());
+		CHECK(adjacency.canonicalVertex(3) == 0 && adjacency.canonicalVertex(4) == 2);
+		CHECK(adjacency.boundaryEdges().size() == 4);
+		CHECK(adjacency.twin(2) == 3);
+		CHECK(adjacency.oneRing(3).size() == 3);
+	}
+
+	void TestIsCurrent() {
+		SimpleGeometryMesh mesh;
+		MakeMesh(mesh, { 0, 0, 1, 0, 1, 1, 0, 1 }, { 0, 1, 2, 0, 2, 3 });
+		SimpleMeshAdjacency adjacency;
+		CHECK(!adjacency.isCurrent(mesh));
+		CHECK(adjacency.build(mesh));
+		CHECK(adjacency.isCurrent(mesh));
+
+		// a copy shares the topology
+		SimpleGeometryMesh copy = mesh;
+		CHECK(adjacency.isCurrent(copy));
+		copy.topologyChanged();
+		CHECK(!adjacency.isCurrent(copy) && adjacency.isCurrent(mesh));
+
+		// a table built while indices are pending is never current
+		mesh.beginSurface(SimpleGeometryMesh::SurfaceType::Triangles);
+		mesh.addIndex(0);
+		mesh.addIndex(2);
+		mesh.addIndex(3);
+		CHECK(!adjacency.isCurrent(mesh));
+		CHECK(adjacency.build(mesh));
+		CHECK(!adjacency.isCurrent(mesh));
+		mesh.commitSurface();
+		CHECK(!adjacency.isCurrent(mesh));
+		CHECK(adjacency.build(mesh));
+		CHECK(adjacency.isCurrent(mesh));
+
+		adjacency.clear();
+		CHECK(!adjacency.isCurrent(mesh));
+	}
+}
+
+void TestSimpleMeshAdjacency() {
+	TestQuad();
+	TestClosedFan();
+	TestNonManifold();
+	TestWeldAndDegenerates();
+	TestIsCurrent();
+}
@@ -0,0 +1,221 @@
+#include <fluxions_simple_multi_draw.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	// The members JoinDrawCall() and addDraws() use, like a renderer draw call
+	struct Call {
+		GLuint vao;
+		GLenum mode;
+		bool isIndexed;
+		GLsizei count;
+		GLint first;
+		GLsizeiptr offset;
+	};
+
+	Call Indexed(GLuint vao, GLenum mode, GLsizei count, GLsizeiptr offset) { return Call{ vao, mode, true, count, 0, offset }; }
+	Call Arrays(GLuint vao, GLenum mode, GLint first, GLsizei count) { return Call{ vao, mode, false, count, first, 0 }; }
+
+	void TestBatches() {
+		SimpleMultiDrawBatch batch;
+		CHECK(batch.add(1, GL_TRIANGLES, 6, 0, sizeof(GLuint)) == 0);
+		CHECK(batch.add(1, GL_TRIANGLES, 3, 24, sizeof(GLuint)) == 0);
+		CHECK(batch.add(2, GL_TRIANGLES, 3, 36, sizeof(GLuint)) == 1);
+		batch.split();
+		CHECK(batch.add(2, GL_TRIANGLES, 9, 48, sizeof(GLuint)) == 2);
+		CHECK(batch.add(2, GL_LINES, 2, 10, sizeof(GLushort)) == 3);
+
+		const auto& batches = batch.batches();
+		CHECK(batches.size() == 4);
+		CHECK(batches[0].vao == 1 && batches[0].firstCommand == 0 && batches[0].commandCount == 2);
+		CHECK(batches[1].vao == 2 && batches[1].firstCommand == 2 && batches[1].commandCount == 1);
+		CHECK(batches[2].firstCommand == 3 && batches[2].commandCount == 1);
+		CHECK(batches[3].mode == GL_LINES && batches[3].firstCommand == 4);
+
+		// firstIndex counts indices, the offsets stay in bytes
+		const auto& commands = batch.commands();
+		CHECK(commands.size() == 5);
+		CHECK(commands[0].firstIndex == 0 && commands[0].count == 6);
+		CHECK(commands[1].firstIndex == 6 && commands[1].count == 3);
+		CHECK(commands[3].firstIndex == 12);
+		CHECK(commands[4].firstIndex == 5);
+		CHECK(commands[1].instanceCount == 1 && commands[1].baseVertex == 0 && commands[1].baseInstance == 0);
+		CHECK(batch.counts()[3] == 9);
+		CHECK(batch.offsets()[3] == (const GLvoid*)48);
+		CHECK(batch.commandsSizeInBytes() == 5 * sizeof(DrawElementsIndirectCommand));
+
+		batch.clear();
+		CHECK(batch.batches().empty() && batch.commands().empty());
+		CHECK(batch.add(1, GL_TRIANGLES, 3, 0, sizeof(GLuint)) == 0);
+	}
+
+	void TestSortKeys() {
+		uint64_t key = MakeDrawSortKey(5, true, GL_TRIANGLES, true, 0x12345678);
+		CHECK(DrawSortKeyBucket(key) == 5);
+		CHECK((key & 0xffffffff) == 0x12345678);
+		CHECK(((key >> 32) & 1) == 1);
+		CHECK(((key >> 33) & 7) == GL_TRIANGLES);
+		CHECK(((key >> 36) & 1) == 1);
+
+		// the bucket orders first, then slow after fast vertices, then mode, indexed, and first
+		CHECK(MakeDrawSortKey(0, true, GL_TRIANGLES, true, 0xffffffff) < MakeDrawSortKey(1, false, GL_POINTS, false, 0));
+		CHECK(MakeDrawSortKey(1, false, GL_TRIANGLE_FAN, true, 9) < MakeDrawSortKey(1, true, GL_POINTS, false, 0));
+		CHECK(MakeDrawSortKey(1, false, GL_LINES, true, 9) < MakeDrawSortKey(1, false, GL_TRIANGLES, false, 0));
+		CHECK(MakeDrawSortKey(1, false, GL_TRIANGLES, false, 9) < MakeDrawSortKey(1, false, GL_TRIANGLES, true, 0));
+		CHECK(MakeDrawSortKey(1, false, GL_TRIANGLES, true, 8) < MakeDrawSortKey(1, false, GL_TRIANGLES, true, 9));
+
+		// modes past 7 do not spill into the VAO bit
+		CHECK(MakeDrawSortKey(0, false, 0x1000, false, 0) == MakeDrawSortKey(0, false, 7, false, 0));
+	}
+
+	void TestRadixSort() {
+		std::vector<uint64_t> keys = { 5, 0x100000000ull, 3, 5, 0x10000, 0, 0x100000000ull, 3 };
+		std::vector<unsigned> values = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		RadixSort(keys, values);
+		CHECK(std::is_sorted(keys.begin(), keys.end()));
+		const std::vector<unsigned> expected = { 5, 2, 7, 0, 3, 4, 1, 6 };
+		CHECK(values == expected);
+
+		// keys that only differ in the top digit
+		keys = { 3ull << 48, 1ull << 48, 2ull << 48 };
+		values = { 0, 1, 2 };
+		RadixSort(keys, values);
+		CHECK(values[0] == 1 && values[1] == 2 && values[2] == 0);
+
+		// equal keys keep their order
+		keys = { 7, 7, 7 };
+		values = { 2, 0, 1 };
+		RadixSort(keys, values);
+		CHECK(values[0] == 2 && values[1] == 0 && values[2] == 1);
+
+		std::mt19937_64 random(1);
+		keys.resize(1000);
+		values.resize(1000);
+		for (unsigned i = 0; i < 1000; i++) {
+			keys[i] = random();
+			values[i] = i;
+		}
+		std::vector<uint64_t> original = keys;
+		RadixSort(keys, values);
+		bool matches = std::is_sorted(keys.begin(), keys.end());
+		for (unsigned i = 0; i < 1000; i++) {
+			matches = matches && original[values[i]] == keys[i];
+		}
+		CHECK(matches);
+	}
+
+	void TestJoinDrawCall() {
+		// 4 byte indices, so 6 indices at offset 0 end at byte 24
+		Call last = Indexed(1, GL_TRIANGLES, 6, 0);
+		CHECK(JoinDrawCall(last, Indexed(1, GL_TRIANGLES, 3, 24), 4));
+		CHECK(last.count == 9 && last.offset == 0);
+		CHECK(!JoinDrawCall(last, Indexed(1, GL_TRIANGLES, 3, 40), 4));
+		CHECK(!JoinDrawCall(last, Indexed(2, GL_TRIANGLES, 3, 36), 4));
+		CHECK(!JoinDrawCall(last, Indexed(1, GL_LINES, 2, 36), 4));
+		CHECK(!JoinDrawCall(last, Arrays(1, GL_TRIANGLES, 0, 3), 4));
+		CHECK(last.count == 9);
+
+		// with 2 byte indices the same draw ends at byte 18
+		CHECK(JoinDrawCall(last, Indexed(1, GL_TRIANGLES, 3, 18), 2));
+		CHECK(last.count == 12);
+
+		// strips and fans are never joined
+		Call strip = Indexed(1, GL_TRIANGLE_STRIP, 4, 0);
+		CHECK(!JoinDrawCall(strip, Indexed(1, GL_TRIANGLE_STRIP, 4, 16), 4));
+
+		Call points = Arrays(1, GL_POINTS, 10, 5);
+		CHECK(JoinDrawCall(points, Arrays(1, GL_POINTS, 15, 5), 4));
+		CHECK(points.first == 10 && points.count == 10);
+		CHECK(!JoinDrawCall(points, Arrays(1, GL_POINTS, 21, 5), 4));
+	}
+
+	void TestAddDraws() {
+		SimpleMultiDrawBatch batch;
+		const Call bucket1[] = {
+			Indexed(1, GL_TRIANGLES, 6, 0), Indexed(1, GL_TRIANGLES, 3, 48), Arrays(1, GL_TRIANGLES, 0, 3), Indexed(2, GL_TRIANGLES, 3, 96)
+		};
+		const Call bucket2[] = { Indexed(2, GL_TRIANGLES, 12, 108) };
+
+		CHECK(batch.addDraws(bucket1, 4, sizeof(GLuint)) == 1);
+		CHECK(batch.batches().size() == 2);
+		CHECK(batch.batches()[0].vao == 1 && batch.batches()[0].commandCount == 2);
+		CHECK(batch.batches()[1].vao == 2 && batch.batches()[1].commandCount == 1);
+
+		// each bucket starts its own batches even with the same VAO and mode
+		unsigned batchFirst = (unsigned)batch.batches().size();
+		CHECK(batch.addDraws(bucket2, 1, sizeof(GLuint)) == 0);
+		CHECK(batch.batches().size() == batchFirst + 1);
+		CHECK(batch.batches()[batchFirst].firstCommand == 3);
+		CHECK(batch.commands()[3].firstIndex == 27);
+
+		// a bucket of only glDrawArrays() draws adds no batch
+		batchFirst = (unsigned)batch.batches().size();
+		CHECK(batch.addDraws(bucket1 + 2, 1, sizeof(GLuint)) == 1);
+		CHECK(batch.batches().size() == batchFirst);
+	}
+
+	// Sorts, joins, and batches surfaces of two buckets the way SimpleRenderer::CompileDrawLists() does
+	void TestCompiledDrawList() {
+		struct Surface {
+			unsigned bucket;
+			Call call;
+		};
+		const Surface surfaces[] = {
+			{ 1, Indexed(1, GL_TRIANGLES, 3, 36) },
+			{ 0, Indexed(1, GL_TRIANGLES, 3, 12) },
+			{ 1, Indexed(1, GL_TRIANGLES, 3, 24) },
+			{ 0, Indexed(2, GL_TRIANGLES, 3, 60) },
+			{ 0, Indexed(1, GL_TRIANGLES, 3, 0) },
+			{ 1, Arrays(1, GL_TRIANGLES, 6, 3) },
+			{ 1, Arrays(1, GL_TRIANGLES, 3, 3) },
+		};
+		const unsigned count = sizeof(surfaces) / sizeof(surfaces[0]);
+
+		std::vector<uint64_t> keys;
+		std::vector<unsigned> order;
+		for (unsigned i = 0; i < count; i++) {
+			const Call& call = surfaces[i].call;
+			uint32_t first = (uint32_t)(call.isIndexed ? call.offset / 4 : call.first);
+			keys.push_back(MakeDrawSortKey(surfaces[i].bucket, call.vao == 2, call.mode, call.isIndexed, first));
+			order.push_back(i);
+		}
+		RadixSort(keys, order);
+		const std::vector<unsigned> expected = { 4, 1, 3, 6, 5, 2, 0 };
+		CHECK(order == expected);
+
+		std::vector<Call> calls;
+		std::vector<unsigned> bucketFirst(2, 0);
+		for (size_t i = 0; i < order.size(); i++) {
+			unsigned bucket = DrawSortKeyBucket(keys[i]);
+			if (i == 0 || DrawSortKeyBucket(keys[i - 1]) != bucket)
+				bucketFirst[bucket] = (unsigned)calls.size();
+			if (calls.size() > bucketFirst[bucket] && JoinDrawCall(calls.back(), surfaces[order[i]].call, 4))
+				continue;
+			calls.push_back(surfaces[order[i]].call);
+		}
+
+		// bucket 0 joins the first two draws, bucket 1 joins its arrays and its indexed draws
+		CHECK(calls.size() == 4);
+		CHECK(calls[0].vao == 1 && calls[0].offset == 0 && calls[0].count == 6);
+		CHECK(calls[1].vao == 2 && calls[1].count == 3);
+		CHECK(!calls[2].isIndexed && calls[2].first == 3 && calls[2].count == 6);
+		CHECK(calls[3].isIndexed && calls[3].offset == 24 && calls[3].count == 6);
+
+		SimpleMultiDrawBatch batch;
+		CHECK(batch.addDraws(calls.data(), 2, sizeof(GLuint)) == 0);
+		CHECK(batch.addDraws(calls.data() + 2, 2, sizeof(GLuint)) == 1);
+		CHECK(batch.batches().size() == 3);
+		CHECK(batch.commands().size() == 3);
+		CHECK(batch.commands()[2].firstIndex == 6 && batch.commands()[2].count == 6);
+	}
+}
+
+void TestSimpleMultiDraw() {
+	TestBatches();
+	TestSortKeys();
+	TestRadixSort();
+	TestJoinDrawCall();
+	TestAddDraws();
+	TestCompiledDrawList();
+}
@@ -0,0 +1,76 @@
+#include <fluxions_simple_occlusion_culler.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	BoundingBoxf MakeBox(float x0, float y0, float z0, float x1, float y1, float z1) {
+		BoundingBoxf box;
+		box.minBounds = Vector3f(x0, y0, z0);
+		box.maxBounds = Vector3f(x1, y1, z1);
+		return box;
+	}
+
+	// A right handed perspective projection with a 90 degree vertical field of view
+	Matrix4f MakePerspective(float zNear, float zFar) {
+		Matrix4f m;
+		m.m11 = 1.0f;
+		m.m22 = 1.0f;
+		m.m33 = (zFar + zNear) / (zNear - zFar);
+		m.m34 = 2.0f * zFar * zNear / (zNear - zFar);
+		m.m43 = -1.0f;
+		m.m44 = 0.0f;
+		return m;
+	}
+
+	void TestWall() {
+		SimpleOcclusionCuller culler;
+		culler.beginFrame(MakePerspective(0.1f, 100.0f));
+
+		// a wall from -3 to 3 at 5 units in front of the eye
+		const SimpleZVertex wall[4] = {
+			SimpleZVertex(-3, -3, -5), SimpleZVertex(3, -3, -5), SimpleZVertex(3, 3, -5), SimpleZVertex(-3, 3, -5)
+		};
+		const unsigned wallIndices[6] = { 0, 1, 2, 0, 2, 3 };
+		culler.addOccluder(wall, 0, 4, wallIndices, 6);
+		CHECK(culler.triangleCount() == 2);
+		culler.rasterize(2);
+
+		CHECK(culler.isOccluded(MakeBox(-0.5f, -0.5f, -10, 0.5f, 0.5f, -9)));
+		CHECK(!culler.isOccluded(MakeBox(-0.5f, -0.5f, -3, 0.5f, 0.5f, -2)));
+		CHECK(!culler.isOccluded(MakeBox(-1, -1, -5.5f, 1, 1, -4.5f)));
+		CHECK(!culler.isOccluded(MakeBox(2.5f, 2.5f, -7, 4.5f, 4.5f, -6)));
+		CHECK(!culler.isOccluded(MakeBox(-0.5f, -0.5f, -1, 0.5f, 0.5f, 1)));
+		CHECK(!culler.isOccluded(BoundingBoxf()));
+
+		// the top of the pyramid keeps the farthest depth, which is the cleared depth
+		CHECK(culler.depth(culler.levelCount() - 1, 0, 0) == 1.0f);
+	}
+
+	void TestRejectedOccluders() {
+		// triangles behind the eye or crossing the near plane never hide anything
+		SimpleOcclusionCuller culler;
+		culler.beginFrame(MakePerspective(0.1f, 100.0f));
+		const SimpleZVertex behind[3] = { SimpleZVertex(-100, -100, 5), SimpleZVertex(100, -100, 5), SimpleZVertex(0, 100, 5) };
+		const SimpleZVertex crossing[3] = { SimpleZVertex(-100, -100, 5), SimpleZVertex(100, -100, -5), SimpleZVertex(0, 100, -5) };
+		const unsigned triangle[3] = { 0, 1, 2 };
+		culler.addOccluder(behind, 0, 3, triangle, 3);
+		culler.addOccluder(crossing, 0, 3, triangle, 3);
+		CHECK(culler.triangleCount() == 0);
+		culler.rasterize(1);
+		CHECK(!culler.isOccluded(MakeBox(-1, -1, -20, 1, 1, -19)));
+
+		// indices outside the vertex range are skipped
+		const SimpleZVertex wall[4] = {
+			SimpleZVertex(-3, -3, -5), SimpleZVertex(3, -3, -5), SimpleZVertex(3, 3, -5), SimpleZVertex(-3, 3, -5)
+		};
+		const unsigned outside[3] = { 0, 1, 7 };
+		culler.addOccluder(wall, 0, 4, outside, 3);
+		CHECK(culler.triangleCount() == 0);
+	}
+}
+
+void TestSimpleOcclusionCuller() {
+	TestWall();
+	TestRejectedOccluders();
+}
@@ -0,0 +1,83 @@
+#include <fluxions_simple_render_stats.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	// Keeps every metric so the names and values can be checked
+	class MapMetricsSink : public SimpleMetricsSink {
+	public:
+		std::map<std::string, double> metrics;
+		void metric(const std::string& name, double value) override { metrics[name] = value; }
+	};
+
+	void TestCounters() {
+		SimpleRenderStats stats;
+		SimpleRenderPassStats* shadow = &stats.pass("shadow");
+		shadow->calls = 1;
+		shadow->drawCalls = 10;
+		shadow->indices = 300;
+		shadow->cpuMilliseconds = 1.5;
+
+		SimpleRenderPassStats& opaque = stats.pass("main");
+		opaque.calls = 2;
+		opaque.drawCalls = 5;
+		opaque.vaoSwitches = 3;
+		opaque.bytesUploaded = 4096;
+		opaque.surfacesDrawn = 7;
+		opaque.surfacesCulled = 9;
+		opaque.gpuMilliseconds = 2.0;
+		opaque.gpuTimerCount = 1;
+
+		// passes are created once and keep their address
+		CHECK(&stats.pass("shadow") == shadow);
+		CHECK(stats.passes().size() == 2);
+
+		SimpleRenderPassStats total = stats.total();
+		CHECK(total.calls == 3 && total.drawCalls == 15 && total.indices == 300);
+		CHECK(total.vaoSwitches == 3 && total.bytesUploaded == 4096);
+		CHECK(total.surfacesDrawn == 7 && total.surfacesCulled == 9);
+		CHECK(total.cpuMilliseconds == 1.5 && total.gpuMilliseconds == 2.0 && total.gpuTimerCount == 1);
+
+		stats.reset();
+		CHECK(stats.passes().size() == 2);
+		CHECK(&stats.pass("shadow") == shadow);
+		CHECK(shadow->drawCalls == 0 && shadow->cpuMilliseconds == 0.0);
+		CHECK(stats.total().calls == 0);
+	}
+
+	void TestExport() {
+		SimpleRenderStats stats;
+		stats.pass("main").drawCalls = 5;
+		stats.pass("main").gpuMilliseconds = 2.0;
+		stats.pass("main").gpuTimerCount = 1;
+		stats.pass("shadow").drawCalls = 10;
+		stats.pass("shadow").cpuMilliseconds = 1.5;
+
+		MapMetricsSink sink;
+		stats.exportTo(sink);
+		CHECK(sink.metrics.size() == 17);
+		CHECK(sink.metrics["renderer.main.drawCalls"] == 5.0);
+		CHECK(sink.metrics["renderer.main.gpuMilliseconds"] == 2.0);
+		CHECK(sink.metrics["renderer.shadow.drawCalls"] == 10.0);
+		CHECK(sink.metrics["renderer.shadow.cpuMilliseconds"] == 1.5);
+
+		// passes without a gpu timer result have no gpu time
+		CHECK(sink.metrics.count("renderer.shadow.gpuMilliseconds") == 0);
+
+		std::ostringstream out;
+		SimpleStreamMetricsSink streamSink(out);
+		SimpleRenderStats one;
+		one.pass("ui").calls = 4;
+		one.exportTo(streamSink, "app.");
+		const std::string text = out.str();
+		CHECK(text.find("app.ui.calls 4\n") == 0);
+		CHECK(text.find("app.ui.cpuMilliseconds 0\n") != std::string::npos);
+		CHECK(std::count(text.begin(), text.end(), '\n') == 8);
+	}
+}
+
+void TestSimpleRenderStats() {
+	TestCounters();
+	TestExport();
+}
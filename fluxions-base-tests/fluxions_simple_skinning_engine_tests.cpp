@@ -0,0 +1,148 @@
+#include <fluxions_simple_skinning_engine.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	using Vertex = SimpleGeometryMesh::Vertex;
+
+	Matrix4f Identity() {
+		Matrix4f m;
+		m.LoadIdentity();
+		return m;
+	}
+
+	Matrix4f Translation(float x, float y, float z) {
+		Matrix4f m = Identity();
+		m.m14 = x;
+		m.m24 = y;
+		m.m34 = z;
+		return m;
+	}
+
+	// A quarter turn about z, so x goes to y
+	Matrix4f RotationZ90() {
+		Matrix4f m = Identity();
+		m.m11 = 0; m.m12 = -1;
+		m.m21 = 1; m.m22 = 0;
+		return m;
+	}
+
+	Vertex MakeVertex(float x, float y, float z, unsigned bone0, float weight0, unsigned bone1 = 0, float weight1 = 0) {
+		Vertex v;
+		v.position.reset(x, y, z);
+		v.normal.reset(1, 0, 0);
+		v.tangent.reset(0, 0, 1);
+		v.boneIndex.x = (uint8_t)bone0;
+		v.boneIndex.y = (uint8_t)bone1;
+		v.boneIndex.z = 0;
+		v.boneIndex.w = 0;
+		v.boneWeights.x = weight0;
+		v.boneWeights.y = weight1;
+		v.boneWeights.z = 0;
+		v.boneWeights.w = 0;
+		return v;
+	}
+
+	bool NearlyEqual3(const Vector3f& v, float x, float y, float z) {
+		return NearlyEqual(v.x, x) && NearlyEqual(v.y, y) && NearlyEqual(v.z, z);
+	}
+
+	void TestIdentity() {
+		SimpleSkinningEngine engine;
+		engine.setPalette({ Identity(), Identity() });
+		CHECK(engine.paletteSize() == 2);
+
+		// more than one block with a short tail
+		std::vector<Vertex> vertices;
+		for (unsigned i = 0; i < 2 * SimpleSkinningEngine::BlockSize + 3; i++) {
+			vertices.push_back(MakeVertex((float)i, 2.0f * i, -1.0f, i % 2, 1.0f));
+		}
+		std::vector<Vector3f> positions(vertices.size());
+		std::vector<Vector3f> normals(vertices.size());
+		engine.skin(vertices.data(), vertices.size(), positions.data(), normals.data(), nullptr);
+		bool unchanged = true;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			unchanged = unchanged && NearlyEqual3(positions[i], (float)i, 2.0f * i, -1.0f) && NearlyEqual3(normals[i], 1, 0, 0);
+		}
+		CHECK(unchanged);
+	}
+
+	void TestTwoBones() {
+		SimpleSkinningEngine engine;
+		engine.setPalette({ Translation(2, 0, 0), RotationZ90() });
+		const Vertex vertices[] = {
+			MakeVertex(1, 0, 0, 0, 1.0f),
+			MakeVertex(1, 0, 0, 1, 1.0f),
+			MakeVertex(1, 0, 0, 0, 0.5f, 1, 0.5f),
+			MakeVertex(1, 0, 0, 0, 0.25f, 1, 0.75f),
+			// bones outside the palette are skipped and the remaining weight is normalized
+			MakeVertex(1, 0, 0, 0, 0.5f, 9, 0.5f),
+			// a vertex without weights is copied
+			MakeVertex(1, 2, 3, 0, 0.0f),
+		};
+		Vector3f positions[6];
+		Vector3f normals[6];
+		Vector3f tangents[6];
+		engine.skin(vertices, 6, positions, normals, tangents);
+
+		CHECK(NearlyEqual3(positions[0], 3, 0, 0) && NearlyEqual3(normals[0], 1, 0, 0));
+		CHECK(NearlyEqual3(positions[1], 0, 1, 0) && NearlyEqual3(normals[1], 0, 1, 0));
+		CHECK(NearlyEqual3(positions[2], 1.5f, 0.5f, 0));
+		const float s = sqrtf(0.5f);
+		CHECK(NearlyEqual3(normals[2], s, s, 0));
+		CHECK(NearlyEqual3(positions[3], 0.75f, 0.75f, 0));
+		CHECK(NearlyEqual3(positions[4], 3, 0, 0) && NearlyEqual3(normals[4], 1, 0, 0));
+		CHECK(NearlyEqual3(positions[5], 1, 2, 3));
+		CHECK(NearlyEqual3(tangents[1], 0, 0, 1));
+
+		// one thread gives the same results
+		Vector3f single[6];
+		engine.setThreadCount(1);
+		engine.skin(vertices, 6, single, nullptr, nullptr);
+		bool same = true;
+		for (unsigned i = 0; i < 6; i++) {
+			same = same && NearlyEqual3(single[i], positions[i].x, positions[i].y, positions[i].z);
+		}
+		CHECK(same);
+	}
+
+	void TestMeshTangents() {
+		SimpleGeometryMesh mesh;
+		mesh.setVerbosity(SimpleGeometryMesh::LoadOptions::Verbosity::Quiet);
+		const float positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+		const float texcoords[6] = { 0, 0, 1, 0, 1, 1 };
+		const unsigned indices[3] = { 0, 1, 2 };
+		mesh.beginSurface(SimpleGeometryMesh::SurfaceType::Triangles);
+		unsigned first = mesh.addVertices(positions, nullptr, texcoords, 3);
+		mesh.addIndices(indices, 3, first);
+		mesh.commitSurface();
+		for (auto& v : mesh.Vertices.mut()) {
+			v.boneIndex.x = 0;
+			v.boneWeights.x = 1.0f;
+		}
+
+		SimpleSkinningEngine engine;
+		engine.setPalette({ RotationZ90() });
+		SimpleSkinningEngine::Output output;
+
+		// tangents are only skinned once they are computed
+		engine.skin(mesh, output);
+		CHECK(output.positions.size() == 3 && output.normals.size() == 3);
+		CHECK(output.tangents.empty());
+		CHECK(NearlyEqual3(output.positions[1], 0, 1, 0));
+
+		mesh.ensureTangents();
+		engine.skin(mesh, output);
+		CHECK(output.tangents.size() == 3);
+		const Vector3f& tangent = mesh.Vertices.vec()[0].tangent;
+		CHECK(NearlyEqual(tangent.length(), 1.0f));
+		CHECK(NearlyEqual3(output.tangents[0], -tangent.y, tangent.x, tangent.z));
+	}
+}
+
+void TestSimpleSkinningEngine() {
+	TestIdentity();
+	TestTwoBones();
+	TestMeshTangents();
+}
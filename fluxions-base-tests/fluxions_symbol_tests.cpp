@@ -0,0 +1,58 @@
+#include <fluxions_symbol.hpp>
+#include "fluxions-base-tests.hpp"
+
+using namespace Fluxions;
+
+namespace {
+	void TestInterning() {
+		Symbol empty;
+		CHECK(empty.empty() && empty.id() == 0);
+		CHECK(Symbol("").id() == 0 && Symbol(std::string()).id() == 0);
+		CHECK(Symbol((const char*)nullptr).id() == 0);
+		CHECK(empty.str().empty());
+
+		unsigned tableSize = Symbol::TableSize();
+		CHECK(Symbol::Find("symbol-test-first").empty());
+		CHECK(Symbol::TableSize() == tableSize);
+
+		Symbol first("symbol-test-first");
+		Symbol again(std::string("symbol-test-first"));
+		Symbol second("symbol-test-second");
+		CHECK(Symbol::TableSize() == tableSize + 2);
+		CHECK(first.id() == again.id() && first.id() != 0);
+		CHECK(first.id() != second.id());
+
+		// ids follow the order of interning
+		CHECK(first < second);
+		CHECK(Symbol::Find("symbol-test-second") == second);
+		CHECK(Symbol::Find("symbol-test-first") == first);
+
+		CHECK(first.str() == "symbol-test-first");
+		CHECK(std::string(second.c_str()) == "symbol-test-second");
+		CHECK(second.size() == 18);
+	}
+
+	void TestEquality() {
+		Symbol a("symbol-test-a");
+		Symbol b("symbol-test-b");
+		CHECK(a == Symbol("symbol-test-a"));
+		CHECK(a != b);
+		CHECK(a == "symbol-test-a" && a != "symbol-test-b");
+		CHECK(a == std::string("symbol-test-a") && a != std::string("symbol-test-b"));
+
+		const std::string& text = a;
+		CHECK(text == "symbol-test-a");
+
+		std::hash<Symbol> hash;
+		CHECK(hash(a) == hash(Symbol("symbol-test-a")));
+
+		std::ostringstream ostr;
+		ostr << a << ' ' << Symbol();
+		CHECK(ostr.str() == "symbol-test-a ");
+	}
+}
+
+void TestSymbol() {
+	TestInterning();
+	TestEquality();
+}
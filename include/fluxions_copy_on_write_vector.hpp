@@ -0,0 +1,129 @@
+#ifndef FLUXIONS_COPY_ON_WRITE_VECTOR_HPP
+#define FLUXIONS_COPY_ON_WRITE_VECTOR_HPP
+
+#include <fluxions_stdcxx.hpp>
+
+namespace Fluxions {
+	/// <summary>TCopyOnWriteVector is a std::vector shared between copies until one is modified</summary>
+	/// Copying is O(1) because the elements are held by a reference counted buffer.
+	/// Any non-const member function first makes a private copy of a shared buffer,
+	/// so a shared buffer is never modified. Const member functions never copy, so
+	/// read through a const reference or vec() to avoid copying a shared buffer.
+	/// A reference returned by a non-const member function must not be kept across a
+	/// copy of the container, because it would then refer to the shared buffer.
+	template <typename T>
+	class TCopyOnWriteVector {
+	public:
+		using vector_type = std::vector<T>;
+		using value_type = typename vector_type::value_type;
+		using size_type = typename vector_type::size_type;
+		using reference = typename vector_type::reference;
+		using const_reference = typename vector_type::const_reference;
+		using iterator = typename vector_type::iterator;
+		using const_iterator = typename vector_type::const_iterator;
+
+		TCopyOnWriteVector() {}
+		TCopyOnWriteVector(const vector_type& v) : ptr_(std::make_shared<vector_type>(v)) {}
+		TCopyOnWriteVector(vector_type&& v) : ptr_(std::make_shared<vector_type>(std::move(v))) {}
+
+		TCopyOnWriteVector& operator=(const vector_type& v) {
+			ptr_ = std::make_shared<vector_type>(v);
+			return *this;
+		}
+
+		TCopyOnWriteVector& operator=(vector_type&& v) {
+			ptr_ = std::make_shared<vector_type>(std::move(v));
+			return *this;
+		}
+
+		// Read only access never copies
+
+		const vector_type& vec() const { return ptr_ ? *ptr_ : EmptyVector(); }
+		operator const vector_type&() const { return vec(); }
+
+		size_type size() const { return vec().size(); }
+		size_type capacity() const { return vec().capacity(); }
+		bool empty() const { return vec().empty(); }
+		const T* data() const { return vec().data(); }
+		const_reference operator[](size_type i) const { return vec()[i]; }
+		const_reference at(size_type i) const { return vec().at(i); }
+		const_reference front() const { return vec().front(); }
+		const_reference back() const { return vec().back(); }
+		const_iterator begin() const { return vec().begin(); }
+		const_iterator end() const { return vec().end(); }
+		const_iterator cbegin() const { return vec().cbegin(); }
+		const_iterator cend() const { return vec().cend(); }
+
+		// Returns true if another container shares this buffer
+		bool isShared() const { return ptr_ && ptr_.use_count() > 1; }
+
+		// Write access copies a shared buffer first
+
+		vector_type& mut() {
+			detach();
+			return *ptr_;
+		}
+
+		T* data() { return mut().data(); }
+		reference operator[](size_type i) { return mut()[i]; }
+		reference at(size_type i) { return mut().at(i); }
+		reference front() { return mut().front(); }
+		reference back() { return mut().back(); }
+		iterator begin() { return mut().begin(); }
+		iterator end() { return mut().end(); }
+
+		void push_back(const T& x) { mut().push_back(x); }
+		void push_back(T&& x) { mut().push_back(std::move(x)); }
+		template <typename... Args>
+		reference emplace_back(Args&&... args) { return mut().emplace_back(std::forward<Args>(args)...); }
+		void pop_back() { mut().pop_back(); }
+		void resize(size_type n) { mut().resize(n); }
+		void resize(size_type n, const T& x) { mut().resize(n, x); }
+		void reserve(size_type n) { mut().reserve(n); }
+		void shrink_to_fit() { mut().shrink_to_fit(); }
+		template <typename InputIt>
+		iterator insert(const_iterator pos, InputIt first, InputIt last) { return mut().insert(pos, first, last); }
+		iterator erase(const_iterator first, const_iterator last) { return mut().erase(first, last); }
+
+		// Clearing a shared buffer does not copy it
+		void clear() {
+			if (isShared())
+				ptr_.reset();
+			else if (ptr_)
+				ptr_->clear();
+		}
+
+		void swap(TCopyOnWriteVector& other) { ptr_.swap(other.ptr_); }
+
+		void swap(vector_type& other) {
+			if (isShared()) {
+				auto shared = ptr_;
+				ptr_ = std::make_shared<vector_type>(std::move(other));
+				other = *shared;
+			}
+			else {
+				mut().swap(other);
+			}
+		}
+
+		bool operator==(const TCopyOnWriteVector& other) const { return ptr_ == other.ptr_ || vec() == other.vec(); }
+		bool operator!=(const TCopyOnWriteVector& other) const { return !(*this == other); }
+
+	private:
+		std::shared_ptr<vector_type> ptr_;
+
+		void detach() {
+			if (!ptr_)
+				ptr_ = std::make_shared<vector_type>();
+			else if (ptr_.use_count() > 1)
+				ptr_ = std::make_shared<vector_type>(*ptr_);
+		}
+
+		static const vector_type& EmptyVector() {
+			static const vector_type empty;
+			return empty;
+		}
+	};
+} // namespace Fluxions
+
+#endif
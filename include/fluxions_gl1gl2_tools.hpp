@@ -23,6 +23,36 @@ bool FxBindTexture(GLint unit, GLenum target, GLuint texture);
 bool FxBindSampler(GLint unit, GLuint sampler);
 bool FxDebugBindTexture(GLenum target, GLuint texture);
 
+// The Fx* functions that bind objects or change render state keep a shadow copy of the
+// state and skip GL calls that would not change it. Code that changes the same state with
+// gl* calls must call FxInvalidateGraphicsState() before the next Fx* call, as must code
+// that switches GL contexts. A disabled cache issues every call.
+struct FxGraphicsStateStats {
+	unsigned long long issuedCalls{ 0 };
+	unsigned long long filteredCalls{ 0 };
+	// glGet* and glIsEnabled() calls reading state, also counted in issuedCalls
+	unsigned long long queryCalls{ 0 };
+};
+
+void FxEnableGraphicsStateCache(bool enabled);
+bool FxIsGraphicsStateCacheEnabled();
+void FxInvalidateGraphicsState();
+const FxGraphicsStateStats& FxGetGraphicsStateStats();
+void FxResetGraphicsStateStats();
+
+void FxUseProgram(GLuint program);
+void FxBindVertexArray(GLuint vao);
+void FxBindBuffer(GLenum target, GLuint buffer);
+void FxEnable(GLenum capability);
+void FxDisable(GLenum capability);
+void FxBlendFunc(GLenum src, GLenum dst);
+void FxBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+void FxBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha);
+void FxDepthFunc(GLenum func);
+void FxDepthMask(GLboolean flag);
+void FxViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void FxScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
 //bool FxCreateBuffer(GLenum target, unsigned& abo, unsigned* p, GLsizeiptr size, const void* data, unsigned usage);
 bool FxCreateBuffer(GLenum target, unsigned* p, GLsizeiptr size, const void* data, unsigned usage);
 void FxDeleteBuffer(GLuint* p);
@@ -57,6 +87,10 @@ void FxClearScreenRgb(GLfloat r, GLfloat g, GLfloat b);
 void FxGlutBitmapString(void* font, const char* str);
 void FxGlutStrokeString(void* font, const char* str);
 
+// Saves the program, bindings, blending, viewport, and scissor state and restores them when
+// destroyed. The state is read from the shadow copy where it is known, so saving right after
+// a restore issues no queries and saving with nothing known issues 18. Every restoring call
+// is issued, so the code in between may change the state with gl* calls.
 class FxSaveGraphicsState {
 public:
 	FxSaveGraphicsState();
@@ -0,0 +1,82 @@
+#ifndef FLUXIONS_PARALLEL_HPP
+#define FLUXIONS_PARALLEL_HPP
+
+#include <fluxions_stdcxx.hpp>
+#include <thread>
+
+namespace Fluxions {
+	// GetParallelThreadCount() returns the number of threads used by ParallelFor
+	inline unsigned GetParallelThreadCount() {
+		unsigned threadCount = std::thread::hardware_concurrency();
+		return threadCount ? threadCount : 1;
+	}
+
+	// ParallelFor() splits [0, count) into contiguous ranges of at least minRangeSize
+	// elements and calls fn(first, last) for each range. The calling thread handles
+	// the first range. A threadCount of 0 uses GetParallelThreadCount().
+	template <typename RangeFunction>
+	void ParallelFor(size_t count, size_t minRangeSize, RangeFunction fn, unsigned threadCount = 0) {
+		if (count == 0)
+			return;
+		if (threadCount == 0)
+			threadCount = GetParallelThreadCount();
+		if (minRangeSize == 0)
+			minRangeSize = 1;
+
+		size_t rangeCount = std::min<size_t>(threadCount, (count + minRangeSize - 1) / minRangeSize);
+		if (rangeCount <= 1) {
+			fn((size_t)0, count);
+			return;
+		}
+
+		size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		std::vector<std::future<void>> futures;
+		futures.reserve(rangeCount - 1);
+		for (size_t first = rangeSize; first < count; first += rangeSize) {
+			size_t last = std::min(count, first + rangeSize);
+			futures.push_back(std::async(std::launch::async, [&fn, first, last]() { fn(first, last); }));
+		}
+		fn((size_t)0, std::min(count, rangeSize));
+		for (auto& f : futures) {
+			f.get();
+		}
+	}
+
+	// ParallelSort() sorts [first, last) by sorting contiguous ranges of at least
+	// minRangeSize elements on separate threads, then merging neighbouring ranges in
+	// rounds until one range is left. Equal elements may be reordered.
+	template <typename RandomIt, typename Compare>
+	void ParallelSort(RandomIt first, RandomIt last, Compare comp, size_t minRangeSize = 16384, unsigned threadCount = 0) {
+		size_t count = (size_t)(last - first);
+		if (threadCount == 0)
+			threadCount = GetParallelThreadCount();
+		if (minRangeSize == 0)
+			minRangeSize = 1;
+
+		size_t rangeCount = std::min<size_t>(threadCount, (count + minRangeSize - 1) / minRangeSize);
+		if (rangeCount <= 1) {
+			std::sort(first, last, comp);
+			return;
+		}
+
+		// the ranges match the ones ParallelFor() uses for the same count and threads
+		size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		ParallelFor(count, rangeSize, [&](size_t a, size_t b) {
+			std::sort(first + a, first + b, comp);
+		}, threadCount);
+
+		for (size_t width = rangeSize; width < count; width *= 2) {
+			size_t mergeCount = (count + 2 * width - 1) / (2 * width);
+			ParallelFor(mergeCount, 1, [&](size_t a, size_t b) {
+				for (size_t m = a; m < b; m++) {
+					size_t lo = m * 2 * width;
+					size_t mid = std::min(count, lo + width);
+					size_t hi = std::min(count, lo + 2 * width);
+					std::inplace_merge(first + lo, first + mid, first + hi, comp);
+				}
+			}, threadCount);
+		}
+	}
+} // namespace Fluxions
+
+#endif
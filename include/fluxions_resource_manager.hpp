@@ -2,6 +2,7 @@
 #define FLUXIONS_RESOURCE_MANAGER_HPP
 
 #include <fluxions_stdcxx.hpp>
+#include <fluxions_symbol.hpp>
 
 
 #define TRESOURCEMANAGER_VECTOR_IMPLEMENTATION 1
@@ -23,8 +24,14 @@ namespace Fluxions {
 		std::vector<unsigned> availableResourceHandles_;
 		std::vector<unsigned> allocatedResourceHandles_;
 
-		std::map<std::string, unsigned> stringToHandleMap_;
-		std::map<unsigned, std::vector<std::string>> handleToStringsMap_;
+		std::unordered_map<Symbol, unsigned> stringToHandleMap_;
+		std::map<unsigned, std::vector<Symbol>> handleToStringsMap_;
+
+		// returns false if name was never interned, so it cannot be in the maps
+		static bool findName(const std::string& name, Symbol& symbol) {
+			symbol = Symbol::Find(name);
+			return !symbol.empty() || name.empty();
+		}
 
 	public:
 		using iterator = typename std::map<unsigned, T>::iterator;
@@ -127,7 +134,10 @@ namespace Fluxions {
 
 	template <typename T>
 	unsigned TResourceManager<T>::count(const std::string& id) const noexcept {
-		return (unsigned)stringToHandleMap_.count(id);
+		Symbol symbol;
+		if (!findName(id, symbol))
+			return 0;
+		return (unsigned)stringToHandleMap_.count(symbol);
 	}
 
 
@@ -177,7 +187,7 @@ namespace Fluxions {
 			return BlankString;
 		if (it->second.empty())
 			return BlankString;
-		return it->second[0];
+		return it->second[0].str();
 	}
 
 
@@ -186,7 +196,7 @@ namespace Fluxions {
 		auto it = handleToStringsMap_.find(handle);
 		if (it == handleToStringsMap_.end())
 			return std::vector<std::string>();
-		return it->second;
+		return std::vector<std::string>(it->second.begin(), it->second.end());
 	}
 
 
@@ -236,8 +246,8 @@ namespace Fluxions {
 #endif
 
 		// remove string names allocated to refer to this handle
-		const std::vector<std::string>& strings = handleToStringsMap_[handle];
-		for (const std::string& name : strings) {
+		const std::vector<Symbol>& strings = handleToStringsMap_[handle];
+		for (Symbol name : strings) {
 			stringToHandleMap_.erase(name);
 		}
 
@@ -263,7 +273,10 @@ namespace Fluxions {
 
 	template <typename T>
 	unsigned TResourceManager<T>::getHandleFromName(const std::string& name) const {
-		auto it = stringToHandleMap_.find(name);
+		Symbol symbol;
+		if (!findName(name, symbol))
+			return 0;
+		auto it = stringToHandleMap_.find(symbol);
 		if (it == stringToHandleMap_.end())
 			return 0;
 		return it->second;
@@ -279,10 +292,11 @@ namespace Fluxions {
 		removeName(name);
 
 		// okay, go ahead and add it to the appropriate handle's string list
-		handleToStringsMap_[handle].push_back(name);
+		Symbol symbol(name);
+		handleToStringsMap_[handle].push_back(symbol);
 
 		// make this string point to this handle
-		stringToHandleMap_[name] = handle;
+		stringToHandleMap_[symbol] = handle;
 
 		return handle;
 	}
@@ -291,12 +305,15 @@ namespace Fluxions {
 	template <typename T>
 	void TResourceManager<T>::removeName(const std::string& name) {
 		// is this string already mapped to a handle?
-		auto it = stringToHandleMap_.find(name);
+		Symbol symbol;
+		if (!findName(name, symbol))
+			return;
+		auto it = stringToHandleMap_.find(symbol);
 		if (it != stringToHandleMap_.end()) {
 			unsigned handle = it->second;
-			std::vector<std::string>& container = handleToStringsMap_[handle];
+			std::vector<Symbol>& container = handleToStringsMap_[handle];
 			// yep! so remove previous reference to it
-			auto pos = find(container.begin(), container.end(), name);
+			auto pos = find(container.begin(), container.end(), symbol);
 			if (pos != container.end())
 				container.erase(pos);
 			stringToHandleMap_.erase(it);
@@ -0,0 +1,61 @@
+#ifndef FLUXIONS_SIMPLE_CACHE_WRITER_HPP
+#define FLUXIONS_SIMPLE_CACHE_WRITER_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace Fluxions {
+	/// <summary>SimpleCacheWriter saves mesh caches on a background thread</summary>
+	/// Each request holds an immutable copy of the mesh, so the caller may keep
+	/// changing its mesh. At most maxQueued requests wait at once and enqueue()
+	/// blocks while the queue is full. Files are written to a temporary name and
+	/// renamed so a partially written cache is never read.
+	class SimpleCacheWriter {
+	public:
+		static constexpr size_t DefaultMaxQueued = 4;
+
+		// Returns the process wide writer
+		static SimpleCacheWriter& Get();
+
+		SimpleCacheWriter();
+		~SimpleCacheWriter();
+
+		// Queues mesh to be written to cacheFilename unless a cache for sourceFilename
+		// with the same load options is already up to date. After shutdown() the cache
+		// is written before enqueue() returns.
+		bool enqueue(std::shared_ptr<const SimpleGeometryMesh> mesh,
+					 const std::string& cacheFilename,
+					 const std::string& sourceFilename);
+
+		// Waits until every queued cache has been written
+		void flush();
+
+		// Writes the remaining caches and stops the thread
+		void shutdown();
+
+		void setMaxQueued(size_t count);
+
+	private:
+		struct Request {
+			std::shared_ptr<const SimpleGeometryMesh> mesh;
+			std::string cacheFilename;
+			std::string sourceFilename;
+		};
+
+		std::mutex mutex_;
+		std::condition_variable queueChanged_;
+		std::deque<Request> queue_;
+		std::thread thread_;
+		size_t maxQueued_{ DefaultMaxQueued };
+		bool busy_{ false };
+		bool stopped_{ false };
+
+		void run();
+		static bool write(const Request& request);
+	};
+} // namespace Fluxions
+
+#endif
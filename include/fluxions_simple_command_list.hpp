@@ -0,0 +1,55 @@
+#ifndef FLUXIONS_SIMPLE_COMMAND_LIST_HPP
+#define FLUXIONS_SIMPLE_COMMAND_LIST_HPP
+
+#include <fluxions_opengl.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleCommandList records draws on any thread for later submission on the GL thread</summary>
+	/// Each command is a complete draw with its VAO, a sort key, and a 32 bit value of
+	/// per-draw data such as a material or view index. Lists recorded on separate threads
+	/// are merged with append() and ordered with sort(). The GL thread then binds VAOs and
+	/// applies draw data only where they change. Recording does not call OpenGL.
+	class SimpleCommandList {
+	public:
+		struct Command {
+			uint64_t sortKey = 0;
+			uint32_t drawData = 0;
+			GLuint vao = 0;
+			GLenum mode = 0;
+			bool isIndexed = false;
+			GLsizei count = 0;
+			GLint first = 0;
+			GLsizeiptr offset = 0;
+		};
+
+		void clear() { commands_.clear(); }
+		void reserve(size_t count) { commands_.reserve(count); }
+
+		// The sort key and draw data of commands added after these calls
+		void setSortKey(uint64_t sortKey) { sortKey_ = sortKey; }
+		void setDrawData(uint32_t drawData) { drawData_ = drawData; }
+		uint64_t sortKey() const { return sortKey_; }
+		uint32_t drawData() const { return drawData_; }
+
+		void drawElements(GLuint vao, GLenum mode, GLsizei count, GLsizeiptr offsetInBytes);
+		void drawArrays(GLuint vao, GLenum mode, GLint first, GLsizei count);
+
+		// Appends the commands of other, which keep their own sort keys and draw data
+		void append(const SimpleCommandList& other);
+
+		// Orders the commands by sort key. Commands with equal keys keep their recorded order.
+		void sort();
+
+		size_t size() const { return commands_.size(); }
+		bool empty() const { return commands_.empty(); }
+		const std::vector<Command>& commands() const { return commands_; }
+		Command& back() { return commands_.back(); }
+
+	private:
+		std::vector<Command> commands_;
+		uint64_t sortKey_ = 0;
+		uint32_t drawData_ = 0;
+	};
+} // namespace Fluxions
+
+#endif
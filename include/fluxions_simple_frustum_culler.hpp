@@ -0,0 +1,62 @@
+#ifndef FLUXIONS_SIMPLE_FRUSTUM_CULLER_HPP
+#define FLUXIONS_SIMPLE_FRUSTUM_CULLER_HPP
+
+#include <fluxions_base.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleFrustumCuller tests bounding boxes against the six planes of a view frustum</summary>
+	/// Boxes are stored as centers and half extents in SoA form and tested in blocks of
+	/// BlockSize, with blocks split across threads. The result is a bitset with one bit per
+	/// box. The culler does not call OpenGL, so it can be tested and timed without a context.
+	class SimpleFrustumCuller {
+	public:
+		static constexpr unsigned BlockSize = 8;
+
+		void clear();
+		void reserve(size_t count);
+
+		// Adds a box and returns its index. An empty box is always visible.
+		unsigned add(const BoundingBoxf& box);
+		unsigned addAlwaysVisible();
+		size_t size() const { return centerX_.size(); }
+
+		// Extracts the planes from a matrix mapping box coordinates to clip space
+		void setViewProjection(const Matrix4f& viewProjection);
+
+		// Sets the visibility bit of every box, 0 threads means use all hardware threads
+		void cull(unsigned threadCount = 0);
+
+		// Boxes added after the last cull() are visible
+		bool visible(size_t i) const {
+			return i >= culledCount_ || (visibility_[i >> 6] >> (i & 63)) & 1;
+		}
+		size_t visibleCount() const;
+
+		// Clears the bit of a culled box, for later stages such as occlusion culling
+		void hide(size_t i) {
+			if (i < culledCount_)
+				visibility_[i >> 6] &= ~(1ULL << (i & 63));
+		}
+
+		const std::vector<uint64_t>& visibility() const { return visibility_; }
+
+		// The planes as (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside the frustum,
+		// in the order left, right, bottom, top, near, far
+		const float* plane(unsigned i) const { return planes_[i]; }
+
+	private:
+		std::vector<float> centerX_;
+		std::vector<float> centerY_;
+		std::vector<float> centerZ_;
+		std::vector<float> extentX_;
+		std::vector<float> extentY_;
+		std::vector<float> extentZ_;
+		float planes_[6][4] = { { 0.0f } };
+		std::vector<uint64_t> visibility_;
+		size_t culledCount_ = 0;
+
+		uint64_t cullWord(size_t first, size_t last) const;
+	};
+} // namespace Fluxions
+
+#endif
@@ -2,9 +2,13 @@
 #define FLUXIONS_SIMPLE_GEOMETRY_MESH_HPP
 
 #include <fluxions_base.hpp>
+#include <fluxions_copy_on_write_vector.hpp>
 #include <fluxions_simple_loadable_resource.hpp>
+#include <fluxions_symbol.hpp>
 
 namespace Fluxions {
+	class SimpleGeometryPager;
+
 	class SimpleGeometryMesh : public SimpleLoadableResource {
 	public:
 		// These constants match the GL_POINTS, GL_LINES, ... constants
@@ -40,22 +44,122 @@ namespace Fluxions {
 			SurfaceType mode = SurfaceType::Triangles;
 			unsigned first = 0;
 			unsigned count = 0;
-			std::string materialLibrary;
-			std::string materialName;
-			std::string surfaceName;
+			Symbol materialLibrary;
+			Symbol materialName;
+			Symbol surfaceName;
 			int materialId = -1;
 
+			// Bounding volumes of the vertices referenced by this surface
+			BoundingBoxf boundingBox;
+			Vector3f sphereCenter;
+			float sphereRadius = 0.0f;
+
+			// All indices of this surface are within [baseVertex, baseVertex + vertexCount)
+			unsigned baseVertex = 0;
+			unsigned vertexCount = 0;
+
+			// Content hash of the referenced vertex and index data
+			uint64_t hash = 0;
+
+			// If instanceOf >= 0, this surface shares the index range of Surfaces[instanceOf]
+			// and its geometry is the shared geometry translated by instanceOffset
+			int instanceOf = -1;
+			Vector3f instanceOffset;
+
 			inline const char* name_cstr() const { return surfaceName.c_str(); }
 
+			// names are interned, so they are not counted here
+			inline size_t sizeInBytes() const { return sizeof(Surface); }
+		};
+
+
+		// The vertices and indices of one surface read from the cache by SimpleGeometryPager
+		struct SurfacePage {
+			std::vector<Vertex> vertices;
+			// relative to the first vertex of vertices
+			std::vector<unsigned> indices;
+
 			inline size_t sizeInBytes() const {
-				return sizeof(Surface) +
-					materialLibrary.size() +
-					materialName.size() +
-					surfaceName.size();
+				return sizeof(SurfacePage) + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned);
 			}
 		};
 
 
+		// Where an original surface was moved by mergeSurfacesByMaterial()
+		struct SurfaceRemap {
+			Symbol surfaceName;
+			// index of the merged surface in Surfaces
+			unsigned surface = 0;
+			// the original faces are Indices[first, first + count)
+			unsigned first = 0;
+			unsigned count = 0;
+		};
+
+
+		// Derived data that is computed on first use and tracked with hasAttributes()
+		enum AttributeFlags : unsigned {
+			NormalsAttribute = 1,
+			// tangents and binormals
+			TangentsAttribute = 2,
+			// BoundingBox and the bounding volumes of each surface
+			BoundsAttribute = 4,
+			AllAttributes = 7
+		};
+
+
+		// Controls which steps loadOBJ() performs. Tangents are left to ensureTangents().
+		struct LoadOptions {
+			enum class CachePolicy {
+				ReadWrite = 0,
+				ReadOnly,
+				WriteOnly,
+				Ignore
+			};
+
+			enum class Sanitize {
+				None = 0,	// keep values as parsed
+				Positions,	// replace non-finite positions with zero
+				All			// replace any non-finite attribute with zero
+			};
+
+			enum class Verbosity {
+				Quiet = 0,	// warnings only
+				Summary,	// one message per step
+				Surfaces	// also one message per object, group, and material
+			};
+
+			CachePolicy cachePolicy = CachePolicy::ReadWrite;
+			// compute tangents while loading instead of on first use
+			bool computeTangents = false;
+			// compute BoundingBox and the bounding volumes of each surface while loading
+			bool computeBounds = true;
+			// share vertices with identical position, normal, and texcoord indices
+			bool optimizeIndexing = false;
+			Sanitize sanitize = Sanitize::All;
+			// move the center of the bounding box to the origin
+			bool recenter = false;
+			// if > 0, uniformly scale so the largest extent of the bounding box is scaleToSize
+			float scaleToSize = 0.0f;
+			// if > 0, chunkSurfaces(trianglesPerChunk) is called after loading
+			unsigned trianglesPerChunk = 0;
+			Verbosity verbosity = Verbosity::Surfaces;
+			// write the cache with SimpleCacheWriter so loadOBJ() returns after parsing.
+			// loadOBJ() then only reports whether the write was queued; a failed write
+			// is logged by the writer and the next load parses the OBJ again.
+			bool writeCacheInBackground = true;
+
+			// Returns a nonzero value identifying the options that change the loaded data
+			unsigned key() const;
+		};
+
+		// Returned by topologyRevision() while a surface is being built. It never matches
+		// a finished topology, so anything built from it is stale.
+		static constexpr unsigned PendingTopologyRevision = 0;
+
+		// The cache file starts with CacheMagic, CacheVersion, and LoadOptions::key()
+		static constexpr unsigned CacheMagic = 0x43584d46; // "FMXC"
+		static constexpr unsigned CacheVersion = 5;
+
 		SimpleGeometryMesh();
 		~SimpleGeometryMesh();
 
@@ -63,12 +167,25 @@ namespace Fluxions {
 
 		bool load() override;
 		void unload() override;
+		// Makes sure the cache file is current, then releases Vertices and Indices.
+		// Surfaces stay resident and their geometry is paged in with pageSurface().
 		void cacheToDisk() override;
+		// Reads Vertices and Indices back from the cache file
 		void fetchCache() override;
 		size_t sizeInBytes() const override;
 
+		// Returns the geometry of a surface, reading it from the cache file if the mesh
+		// is cached to disk. Returns nullptr if surface is out of range or cannot be read.
+		std::shared_ptr<const SurfacePage> pageSurface(unsigned surface);
 
+		// Sets the bytes of paged surfaces kept in memory while cached to disk
+		void setPageBudget(size_t bytes);
+
+
+		// Returns false if the OBJ cannot be read or the cache cannot be written, unless
+		// LoadOptions::writeCacheInBackground is set, see there
 		bool loadOBJ(const std::string& filename);
+		bool loadOBJ(const std::string& filename, const LoadOptions& options);
 		bool saveOBJ(const std::string& filename) const;
 		int saveOBJByMaterial(const std::string& filename,
 							  const std::string& mtllib,
@@ -77,8 +194,83 @@ namespace Fluxions {
 							  const std::string& materialName,
 							  int materialId) const;
 		bool saveCache(const std::string& filename) const;
-		bool loadCache(const std::string& filename);
+		bool saveCache(std::ostream& fout) const;
+		// Loads a cache written with any options if optionsKey is 0, otherwise only a
+		// cache written with LoadOptions::key() equal to optionsKey
+		bool loadCache(const std::string& filename, unsigned optionsKey = 0);
+		bool loadCache(std::istream& fin, unsigned optionsKey = 0);
+
+		// Returns true if cacheFilename is newer than sourceFilename and was written with optionsKey
+		static bool isCacheCurrent(const std::string& cacheFilename, const std::string& sourceFilename, unsigned optionsKey);
+
+		// Returns LoadOptions::key() of the options used to create this mesh
+		unsigned optionsKey() const { return optionsKey_; }
+
+		// The verbosity of loadOBJ() and of later passes such as chunkSurfaces(). loadOBJ()
+		// sets it from LoadOptions::verbosity.
+		void setVerbosity(LoadOptions::Verbosity verbosity) { verbosity_ = verbosity; }
+		LoadOptions::Verbosity verbosity() const { return verbosity_; }
 		void computeTangentVectors();
+		void computeSurfaceBounds();
+
+		// Replaces the normals with area weighted face normals
+		void computeNormals();
+
+		// Lazy Attributes ///////////////////////////////////////////
+
+		// Returns true if all attributes in flags are valid for the current positions
+		bool hasAttributes(unsigned flags) const { return (validAttributes_ & flags) == flags; }
+
+		// Marks attributes as stale, call after changing positions through getVertex()
+		void invalidateAttributes(unsigned flags = AllAttributes) { validAttributes_ &= ~flags; }
+
+		// These compute an attribute only if it is not valid
+		void ensureNormals();
+		void ensureTangents();
+		void ensureBounds();
+
+		const BoundingBoxf& getBoundingBox() { ensureBounds(); return BoundingBox; }
+		const Vector3f& getNormal(int i) { ensureNormals(); return Vertices.vec()[i].normal; }
+		const Vector3f& getTangent(int i) { ensureTangents(); return Vertices.vec()[i].tangent; }
+		const Vector3f& getBinormal(int i) { ensureTangents(); return Vertices.vec()[i].binormal; }
+
+		// Changes whenever Indices or Surfaces are rebuilt or appended to. Copies that share
+		// their topology return the same value, so it identifies the connectivity of the mesh.
+		// Call topologyChanged() after changing Indices directly. Indices added by addIndex()
+		// take a new revision when the surface ends, and until then it returns PendingTopologyRevision.
+		unsigned topologyRevision() const { return topologyPending_ ? PendingTopologyRevision : topologyRevision_; }
+		void topologyChanged() { topologyRevision_ = NewTopologyRevision(); topologyPending_ = false; dirty = true; }
+
+		// Hashes the vertices and indices referenced by surface. If translationInvariant is true,
+		// positions are hashed relative to the first referenced vertex and quantized to quantum.
+		uint64_t computeSurfaceHash(const Surface& surface, bool translationInvariant = false, float quantum = 1.0e-4f) const;
+
+		// Stores computeSurfaceHash() in the hash of every surface
+		void computeSurfaceHashes(bool translationInvariant = false, float quantum = 1.0e-4f);
+
+		// Hashes the geometry of the entire mesh, useful for sharing identical meshes loaded from different files
+		uint64_t computeHash(bool translationInvariant = false, float quantum = 1.0e-4f) const;
+
+		// Makes surfaces with identical geometry share one index range and removes the
+		// unreferenced vertices and indices. Returns the number of surfaces that were shared.
+		unsigned shareDuplicateSurfaces(bool translationInvariant = false, float quantum = 1.0e-4f);
+
+		// The largest vertex range of a chunk so that its indices fit in 16 bits
+		static constexpr unsigned MaxChunkVertices = 65536;
+
+		// Splits triangle surfaces into spatially coherent chunks of at most trianglesPerChunk
+		// triangles using a k-d split at the median centroid. Vertices are rearranged so each
+		// triangle surface has a local range of at most MaxChunkVertices. Instances are split
+		// into one instance of each chunk of their owner. Other modes are kept whole, with a
+		// warning if their range is too large. Returns the new surface count.
+		unsigned chunkSurfaces(unsigned trianglesPerChunk);
+
+		// Reorders Indices so the faces of each material are contiguous and merges the
+		// surfaces that can be drawn with one call. Shared surfaces are kept separate.
+		// SurfaceRemaps records where each original surface went. Returns the number of
+		// surfaces removed.
+		unsigned mergeSurfacesByMaterial();
+
 		void clear();
 		void resize(int vertexCount, int indexCount, int surfaceCount = 1);
 		void createSimpleModel(int vertexCount, int indexCount, int surfaceCount = 1);
@@ -103,6 +295,8 @@ namespace Fluxions {
 
 		// Start drawing a new surface (aka sub mesh)
 		inline void beginSurface(SurfaceType mode) {
+			if (topologyPending_)
+				topologyChanged();
 			Surface newSurface;
 			newSurface.mode = mode;
 			newSurface.first = getIndexCount();
@@ -116,7 +310,7 @@ namespace Fluxions {
 		void position3f(float x, float y, float z, bool addIndex_ = false) {
 			curVertexAttrib_.position.reset(x, y, z);
 			Vertices.push_back(curVertexAttrib_);
-			dirty = true;
+			positionsChanged();
 			if (addIndex_) {
 				addIndex(-1);
 			}
@@ -126,7 +320,7 @@ namespace Fluxions {
 		void position3f(const Vector3f v, bool addIndex_ = false) {
 			curVertexAttrib_.position = v;
 			Vertices.push_back(curVertexAttrib_);
-			dirty = true;
+			positionsChanged();
 			if (addIndex_) {
 				addIndex(-1);
 			}
@@ -187,7 +381,7 @@ namespace Fluxions {
 			}
 			if (i == 0) {
 				Vertices.push_back(curVertexAttrib_);
-				dirty = true;
+				positionsChanged();
 				if (addIndex_) {
 					addIndex(-1);
 				}
@@ -204,9 +398,27 @@ namespace Fluxions {
 				return;
 			if (!Surfaces.empty())
 				Surfaces.back().count++;
-			dirty = true;
+			positionsChanged();
+			topologyPending_ = true;
 		}
 
+		// Bulk Building /////////////////////////////////////////////
+
+		// Reserve room for this many more vertices, indices, and surfaces
+		void reserve(size_t vertexCount, size_t indexCount, size_t surfaceCount = 0);
+
+		// Append count vertices. Positions and normals are 3 floats each and texcoords are 2
+		// floats each. A null array uses the current attribute. Returns the first new vertex.
+		unsigned addVertices(const float* positions, const float* normals, const float* texcoords, size_t count);
+
+		// Append count indices plus baseVertex to the current surface. Nothing is added and
+		// false is returned if any index is outside the vertex array.
+		bool addIndices(const unsigned* indices, size_t count, unsigned baseVertex = 0);
+
+		// Finish the surface started by beginSurface() and compute its bounds. An empty
+		// surface is removed. Returns the surface index or -1 if it was empty.
+		int commitSurface();
+
 		// Set a 1 component vertex attribute with 1 float
 		inline void attrib1f(int i, float x, bool addIndex = false) { attrib4f(i, x, 0.0f, 0.0f, 1.0f, addIndex); }
 
@@ -281,20 +493,49 @@ namespace Fluxions {
 		string_string_map mtllibs;
 		// The map of materials (first=identifier, last=original)
 		string_string_map Materials;
-		// The array of vertexes
-		std::vector<Vertex> Vertices;
-		// The array of indexes
-		std::vector<unsigned> Indices;
-		// The array of surfaces
-		std::vector<Surface> Surfaces;
+		// The array of vertexes, shared with copies of this mesh until either is modified
+		TCopyOnWriteVector<Vertex> Vertices;
+		// The array of indexes, shared with copies of this mesh until either is modified
+		TCopyOnWriteVector<unsigned> Indices;
+		// The array of surfaces, shared with copies of this mesh until either is modified
+		TCopyOnWriteVector<Surface> Surfaces;
+		// The original surfaces before mergeSurfacesByMaterial(), empty if never merged
+		std::vector<SurfaceRemap> SurfaceRemaps;
 		// The bounding box of the entire object
 		BoundingBoxf BoundingBox;
 
 	private:
 		Vertex curVertexAttrib_;
-		std::string currentMaterial_;
-		std::string currentMaterialLibrary_;
+		Symbol currentMaterial_;
+		Symbol currentMaterialLibrary_;
 		bool dirty{ true };
+		// AttributeFlags that are valid, plus GeneratedNormalsFlag
+		unsigned validAttributes_{ 0 };
+		unsigned topologyRevision_{ NewTopologyRevision() };
+		// set by addIndex() so the revision is drawn once per surface instead of once per index
+		bool topologyPending_{ false };
+		static unsigned NewTopologyRevision();
+		// set if the normals came from computeNormals() and should follow the positions
+		static constexpr unsigned GeneratedNormalsFlag = 8;
+		// invalidates the attributes derived from the positions
+		void positionsChanged() {
+			unsigned stale = TangentsAttribute | BoundsAttribute;
+			if (validAttributes_ & GeneratedNormalsFlag)
+				stale |= NormalsAttribute;
+			validAttributes_ &= ~stale;
+			dirty = true;
+		}
+		// LoadOptions::key() of the options used to create this mesh
+		unsigned optionsKey_{ LoadOptions().key() };
+		LoadOptions::Verbosity verbosity_{ LoadOptions::Verbosity::Surfaces };
+		// the cache file this mesh was loaded from or saved to for paging
+		std::string cacheFilename_;
+		std::shared_ptr<SimpleGeometryPager> pager_;
+		size_t pageBudget_{ 256 << 20 };
+		// computes the bounding volumes and vertex range of one surface
+		void computeBounds(Surface& surface) const;
+		// writes a canonical description of the surface geometry used for hashing and comparison
+		void serializeSurface(const Surface& surface, bool translationInvariant, float quantum, std::vector<uint32_t>& words, Vector3f& origin) const;
 		// note: modifies mtllibname
 		bool add_mtllib(std::istream& istr, std::string& mtllibname, const std::string& basepath);
 	};
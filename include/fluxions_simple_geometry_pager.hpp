@@ -0,0 +1,80 @@
+#ifndef FLUXIONS_SIMPLE_GEOMETRY_PAGER_HPP
+#define FLUXIONS_SIMPLE_GEOMETRY_PAGER_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleGeometryPager reads surfaces of a mesh cache file on demand</summary>
+	/// Each page holds the vertex and index ranges of one surface. Pages are read
+	/// with explicit seeks into the cache file and the least recently used pages
+	/// are dropped when the resident size is over budget. Pages are shared
+	/// pointers, so a dropped page stays valid for anyone still using it.
+	class SimpleGeometryPager {
+	public:
+		using Page = SimpleGeometryMesh::SurfacePage;
+		using PagePtr = std::shared_ptr<const Page>;
+
+		static constexpr size_t DefaultBudget = 256 << 20;
+
+		// Opens a cache written by SimpleGeometryMesh::saveCache() whose surfaces are surfaces
+		bool open(const std::string& cacheFilename, const std::vector<SimpleGeometryMesh::Surface>& surfaces);
+		void close();
+		bool isOpen() const { return !filename_.empty(); }
+		const std::string& filename() const { return filename_; }
+
+		// Returns the page of surface, reading it if it is not resident. Shared
+		// surfaces return the page of the surface they share.
+		PagePtr fetch(unsigned surface);
+
+		// Returns true if the page of surface is resident
+		bool isResident(unsigned surface) const;
+
+		// Drops the page of surface or every page
+		void evict(unsigned surface);
+		void evictAll();
+
+		// Sets the resident size in bytes above which pages are dropped
+		void setBudget(size_t bytes);
+		size_t budget() const { return budget_; }
+		size_t residentBytes() const { return residentBytes_; }
+
+		// Reads every vertex and index of the cache
+		bool readAll(std::vector<SimpleGeometryMesh::Vertex>& vertices, std::vector<unsigned>& indices);
+
+	private:
+		// the ranges of one surface in the cache file
+		struct Range {
+			unsigned first = 0;
+			unsigned count = 0;
+			unsigned baseVertex = 0;
+			unsigned vertexCount = 0;
+			int instanceOf = -1;
+		};
+
+		struct Entry {
+			PagePtr page;
+			std::list<unsigned>::iterator lru;
+		};
+
+		mutable std::mutex mutex_;
+		std::ifstream file_;
+		std::string filename_;
+		std::streamoff vertexOffset_{ 0 };
+		std::streamoff indexOffset_{ 0 };
+		unsigned vertexCount_{ 0 };
+		unsigned indexCount_{ 0 };
+		std::vector<Range> ranges_;
+
+		// most recently used pages are at the front
+		std::list<unsigned> lru_;
+		std::unordered_map<unsigned, Entry> pages_;
+		size_t budget_{ DefaultBudget };
+		size_t residentBytes_{ 0 };
+
+		PagePtr read(const Range& range);
+		void trim();
+	};
+} // namespace Fluxions
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef FLUXIONS_SIMPLE_GEOMETRY_SEQUENCE_HPP
+#define FLUXIONS_SIMPLE_GEOMETRY_SEQUENCE_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+#include <condition_variable>
+#include <thread>
+
+namespace Fluxions {
+	/// <summary>SimpleGeometrySequence plays back a sequence of OBJ files sharing one topology</summary>
+	/// The first file is loaded as the base mesh. Every other frame must have the same
+	/// indices, surfaces, and texcoords, and only its positions and normals are kept.
+	/// Frames are encoded as keyframes every keyframeInterval frames with deltas of the
+	/// float bit patterns in between, stored as zigzag varints. The base mesh and the
+	/// encoded frames are written to a single cache. Frames after the last requested
+	/// one are decoded ahead of time on a prefetch thread.
+	class SimpleGeometrySequence {
+	public:
+		// The cache file starts with CacheMagic and CacheVersion, followed by a mesh cache
+		static constexpr unsigned CacheMagic = 0x53584d46; // "FMXS"
+		static constexpr unsigned CacheVersion = 1;
+		static constexpr unsigned DefaultKeyframeInterval = 16;
+		static constexpr unsigned DefaultPrefetchFrames = 4;
+
+		// The decoded positions and normals of one frame
+		struct Frame {
+			unsigned index = 0;
+			std::vector<Vector3f> positions;
+			std::vector<Vector3f> normals;
+
+			inline size_t sizeInBytes() const { return sizeof(Frame) + (positions.size() + normals.size()) * sizeof(Vector3f); }
+		};
+		using FramePtr = std::shared_ptr<const Frame>;
+
+		SimpleGeometrySequence();
+		~SimpleGeometrySequence();
+
+		// Loads filenames as the frames of one sequence. If cacheFilename is not empty,
+		// the sequence is read from it when it is newer than every file, and otherwise
+		// written to it. Returns false if a frame does not match the first frame.
+		bool loadOBJSequence(const std::vector<std::string>& filenames,
+							 const SimpleGeometryMesh::LoadOptions& options = SimpleGeometryMesh::LoadOptions(),
+							 const std::string& cacheFilename = "");
+
+		bool saveCache(const std::string& filename) const;
+
+		// Reads the base mesh and frame table. Frames are read from the file when needed.
+		bool loadCache(const std::string& filename);
+
+		void clear();
+
+		unsigned frameCount() const { return (unsigned)frameTable_.size(); }
+
+		// The mesh of the first frame, which owns the shared indices and surfaces
+		const SimpleGeometryMesh& baseMesh() const { return baseMesh_; }
+
+		// Returns the decoded frame, waiting for it if it is not prefetched yet, and
+		// starts prefetching the frames after it. Returns nullptr if frame is out of range.
+		FramePtr frame(unsigned frame);
+
+		// Copies the positions and normals of frame into mesh, which must be a copy of
+		// baseMesh(). The indices and surfaces stay shared with baseMesh().
+		bool applyFrame(unsigned frame, SimpleGeometryMesh& mesh);
+
+		// The number of frames decoded ahead, 0 disables the prefetch thread
+		void setPrefetchFrames(unsigned count);
+		// The keyframe interval of later calls to loadOBJSequence(), frames already encoded keep theirs
+		void setKeyframeInterval(unsigned interval) { keyframeInterval_ = std::max(interval, 1u); }
+
+		// Size of the encoded frames, which are either resident or in the cache file
+		size_t encodedSizeInBytes() const;
+
+	private:
+		struct FrameEntry {
+			// offset into the cache file, 0 if the frame is resident in encoded_
+			uint64_t offset = 0;
+			unsigned size = 0;
+			bool keyframe = false;
+		};
+
+		SimpleGeometryMesh baseMesh_;
+		unsigned keyframeInterval_{ DefaultKeyframeInterval };
+		std::vector<FrameEntry> frameTable_;
+		std::vector<std::vector<uint8_t>> encoded_;
+
+		// the cache file frames are read from, guarded by fileMutex_
+		mutable std::mutex fileMutex_;
+		mutable std::ifstream file_;
+
+		// prefetched frames and the thread that decodes them, guarded by mutex_
+		std::mutex mutex_;
+		std::condition_variable changed_;
+		std::thread thread_;
+		std::map<unsigned, FramePtr> ready_;
+		unsigned requested_{ 0 };
+		unsigned prefetchFrames_{ DefaultPrefetchFrames };
+		bool stopping_{ false };
+
+		// the last frame decoded on the calling thread or the prefetch thread
+		FramePtr lastDecoded_;
+
+		void stopPrefetch();
+		void run();
+		void trimReady(unsigned first);
+		bool readEncoded(unsigned frame, std::vector<uint8_t>& bytes) const;
+		// decodes frame, continuing from previous when it is the frame before
+		FramePtr decode(unsigned frame, FramePtr previous) const;
+		static void encode(const Frame& frame, const Frame* previous, std::vector<uint8_t>& bytes);
+		static bool decodeInto(const std::vector<uint8_t>& bytes, const Frame* previous, Frame& frame);
+	};
+} // namespace Fluxions
+
+#endif
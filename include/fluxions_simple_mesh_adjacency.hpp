@@ -0,0 +1,129 @@
+#ifndef FLUXIONS_SIMPLE_MESH_ADJACENCY_HPP
+#define FLUXIONS_SIMPLE_MESH_ADJACENCY_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleMeshAdjacency is a corner table of the triangles of a SimpleGeometryMesh</summary>
+	/// Corner c is vertex c % 3 of triangle c / 3 and is also the half-edge from
+	/// vertex(c) to vertex(next(c)). twin() pairs the half-edges of an edge that
+	/// has exactly two consistently oriented faces. Edges are matched with a
+	/// parallel sort of their vertex pairs. The one-ring and the corners of each
+	/// vertex are stored contiguously, so iterating them touches one array.
+	class SimpleMeshAdjacency {
+	public:
+		// twin() of an edge with one face
+		static constexpr unsigned Boundary = ~0u;
+		// twin() of an edge with more than two faces or faces of opposite orientation
+		static constexpr unsigned NonManifold = ~1u;
+
+		// A contiguous list of vertices or corners
+		struct Range {
+			const unsigned* first = nullptr;
+			const unsigned* last = nullptr;
+
+			const unsigned* begin() const { return first; }
+			const unsigned* end() const { return last; }
+			size_t size() const { return (size_t)(last - first); }
+			bool empty() const { return first == last; }
+			unsigned operator[](size_t i) const { return first[i]; }
+		};
+
+		// Builds the table from the Triangles surfaces of mesh. Degenerate triangles are
+		// skipped. If weldPositions is true, vertices with equal positions are treated as
+		// one vertex, so seams in normals or texcoords do not split the surface.
+		// Returns false if the mesh has no triangles.
+		bool build(const SimpleGeometryMesh& mesh, bool weldPositions = false);
+
+		// Returns true if the table was built from the current topology of mesh. A welded
+		// table should also be rebuilt after moving vertices.
+		bool isCurrent(const SimpleGeometryMesh& mesh) const;
+
+		void clear();
+
+		unsigned triangleCount() const { return (unsigned)corners_.size() / 3; }
+		unsigned cornerCount() const { return (unsigned)corners_.size(); }
+		unsigned vertexCount() const { return vertexCount_; }
+		unsigned degenerateCount() const { return degenerateCount_; }
+		bool isWelded() const { return welded_; }
+
+		static unsigned triangle(unsigned corner) { return corner / 3; }
+		static unsigned next(unsigned corner) { return corner % 3 == 2 ? corner - 2 : corner + 1; }
+		static unsigned prev(unsigned corner) { return corner % 3 == 0 ? corner + 2 : corner - 1; }
+
+		// The vertex of corner, after welding
+		unsigned vertex(unsigned corner) const { return corners_[corner]; }
+
+		// The position in mesh.Indices that corner was read from
+		unsigned meshIndex(unsigned corner) const { return meshIndices_[corner]; }
+
+		// The opposite half-edge of halfEdge, Boundary, or NonManifold
+		unsigned twin(unsigned halfEdge) const { return twins_[halfEdge]; }
+
+		// The vertex that v was welded to, or v if the table is not welded
+		unsigned canonicalVertex(unsigned v) const { return canonical_.empty() ? v : canonical_[v]; }
+
+		bool isBoundaryEdge(unsigned halfEdge) const { return twins_[halfEdge] == Boundary; }
+		bool isNonManifoldEdge(unsigned halfEdge) const { return twins_[halfEdge] == NonManifold; }
+		bool isBoundaryVertex(unsigned v) const { return (vertexFlags_[canonicalVertex(v)] & BoundaryVertex) != 0; }
+		// A vertex is non-manifold if it has a non-manifold edge or its faces form more than one fan
+		bool isNonManifoldVertex(unsigned v) const { return (vertexFlags_[canonicalVertex(v)] & NonManifoldVertex) != 0; }
+
+		// The vertices sharing an edge with v, sorted by index
+		Range oneRing(unsigned v) const { return range(ringOffsets_, ring_, canonicalVertex(v)); }
+
+		// The corners of v, one per incident triangle
+		Range vertexCorners(unsigned v) const { return range(cornerOffsets_, vertexCorners_, canonicalVertex(v)); }
+
+		// One half-edge of each boundary edge and of each non-manifold edge
+		const std::vector<unsigned>& boundaryEdges() const { return boundaryEdges_; }
+		const std::vector<unsigned>& nonManifoldEdges() const { return nonManifoldEdges_; }
+		const std::vector<unsigned>& nonManifoldVertices() const { return nonManifoldVertices_; }
+
+		size_t sizeInBytes() const;
+
+	private:
+		enum VertexFlags : uint8_t {
+			BoundaryVertex = 1,
+			NonManifoldVertex = 2
+		};
+
+		unsigned vertexCount_ = 0;
+		unsigned degenerateCount_ = 0;
+		unsigned topologyRevision_ = SimpleGeometryMesh::PendingTopologyRevision;
+		bool welded_ = false;
+
+		// indexed by corner
+		std::vector<unsigned> corners_;
+		std::vector<unsigned> meshIndices_;
+		std::vector<unsigned> twins_;
+
+		// indexed by vertex, empty if not welded
+		std::vector<unsigned> canonical_;
+		std::vector<uint8_t> vertexFlags_;
+
+		// compressed rows indexed by vertex
+		std::vector<unsigned> ringOffsets_;
+		std::vector<unsigned> ring_;
+		std::vector<unsigned> cornerOffsets_;
+		std::vector<unsigned> vertexCorners_;
+
+		std::vector<unsigned> boundaryEdges_;
+		std::vector<unsigned> nonManifoldEdges_;
+		std::vector<unsigned> nonManifoldVertices_;
+
+		static Range range(const std::vector<unsigned>& offsets, const std::vector<unsigned>& values, unsigned v) {
+			if (v + 1 >= offsets.size())
+				return Range();
+			return Range{ values.data() + offsets[v], values.data() + offsets[v + 1] };
+		}
+
+		void weld(const SimpleGeometryMesh& mesh);
+		void matchEdges();
+		void buildVertexRows();
+		void classifyVertices();
+	};
+} // namespace Fluxions
+
+#endif
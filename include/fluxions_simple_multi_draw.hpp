@@ -0,0 +1,106 @@
+#ifndef FLUXIONS_SIMPLE_MULTI_DRAW_HPP
+#define FLUXIONS_SIMPLE_MULTI_DRAW_HPP
+
+#include <fluxions_opengl.hpp>
+
+namespace Fluxions {
+	// The layout glMultiDrawElementsIndirect() reads from GL_DRAW_INDIRECT_BUFFER
+	struct DrawElementsIndirectCommand {
+		GLuint count = 0;
+		GLuint instanceCount = 1;
+		GLuint firstIndex = 0;
+		GLint baseVertex = 0;
+		GLuint baseInstance = 0;
+	};
+
+	/// <summary>SimpleMultiDrawBatch packs indexed draws into multi draw batches</summary>
+	/// Consecutive draws with the same VAO and mode form one batch, which is one call to
+	/// glMultiDrawElementsIndirect() or glMultiDrawElements(). Building the commands
+	/// does not call OpenGL, so it can be tested and timed without a context.
+	class SimpleMultiDrawBatch {
+	public:
+		struct Batch {
+			GLuint vao = 0;
+			GLenum mode = 0;
+			unsigned firstCommand = 0;
+			unsigned commandCount = 0;
+		};
+
+		void clear();
+		void reserve(size_t commandCount);
+
+		// Appends a draw of count indices starting offsetInBytes into the element buffer,
+		// where each index is indexSize bytes. Returns the index of its batch.
+		unsigned add(GLuint vao, GLenum mode, GLsizei count, GLsizeiptr offsetInBytes, size_t indexSize);
+
+		// Makes the next add() start a new batch
+		void split() { splitNext_ = true; }
+
+		// Starts a new batch and adds the indexed draws of calls, which need vao, mode,
+		// isIndexed, count, and offset members. Returns the number of draws that are not indexed.
+		template <typename Call>
+		unsigned addDraws(const Call* calls, unsigned count, size_t indexSize) {
+			split();
+			unsigned drawArrays = 0;
+			for (unsigned i = 0; i < count; i++) {
+				if (calls[i].isIndexed)
+					add(calls[i].vao, calls[i].mode, calls[i].count, calls[i].offset, indexSize);
+				else
+					drawArrays++;
+			}
+			return drawArrays;
+		}
+
+		const std::vector<Batch>& batches() const { return batches_; }
+		const std::vector<DrawElementsIndirectCommand>& commands() const { return commands_; }
+
+		// The same draws as parallel arrays for glMultiDrawElements()
+		const std::vector<GLsizei>& counts() const { return counts_; }
+		const std::vector<const GLvoid*>& offsets() const { return offsets_; }
+
+		size_t commandsSizeInBytes() const { return commands_.size() * sizeof(DrawElementsIndirectCommand); }
+
+	private:
+		std::vector<Batch> batches_;
+		std::vector<DrawElementsIndirectCommand> commands_;
+		std::vector<GLsizei> counts_;
+		std::vector<const GLvoid*> offsets_;
+		bool splitNext_ = true;
+	};
+
+	// The sort key of a draw in a compiled draw list. From the top bits down, it holds the
+	// bucket, whether the draw uses slow vertices, the mode, whether it is indexed, and the
+	// first index or vertex. Modes above 7 share the value 7.
+	inline uint64_t MakeDrawSortKey(unsigned bucket, bool isSlowVertex, GLenum mode, bool isIndexed, uint32_t first) {
+		return ((uint64_t)bucket << 37) |
+			((uint64_t)(isSlowVertex ? 1 : 0) << 36) |
+			((uint64_t)std::min<GLenum>(mode, 7) << 33) |
+			((uint64_t)(isIndexed ? 1 : 0) << 32) |
+			first;
+	}
+
+	inline unsigned DrawSortKeyBucket(uint64_t key) { return (unsigned)(key >> 37); }
+
+	// Sorts values by keys with a least significant digit radix sort on 16 bit digits.
+	// The sort is stable, and digits that are the same for every key are skipped.
+	void RadixSort(std::vector<uint64_t>& keys, std::vector<unsigned>& values);
+
+	// List primitives can be joined into one draw when their ranges are adjacent
+	inline bool IsJoinableMode(GLenum mode) {
+		return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES;
+	}
+
+	// Extends last by call if they draw adjacent ranges with the same VAO and mode.
+	// Indexed draws are adjacent by offset in bytes, the others by first vertex.
+	template <typename LastCall, typename Call>
+	bool JoinDrawCall(LastCall& last, const Call& call, GLsizeiptr indexSize) {
+		if (last.vao != call.vao || last.mode != call.mode || last.isIndexed != call.isIndexed || !IsJoinableMode(call.mode))
+			return false;
+		if (call.isIndexed ? last.offset + last.count * indexSize != call.offset : last.first + last.count != call.first)
+			return false;
+		last.count += call.count;
+		return true;
+	}
+} // namespace Fluxions
+
+#endif
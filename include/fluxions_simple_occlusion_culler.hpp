@@ -0,0 +1,102 @@
+#ifndef FLUXIONS_SIMPLE_OCCLUSION_CULLER_HPP
+#define FLUXIONS_SIMPLE_OCCLUSION_CULLER_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_vertex.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleOcclusionCuller rasterizes occluders into a small depth buffer on the CPU</summary>
+	/// Occluder triangles are projected and binned into tiles of TileSize pixels. Tiles
+	/// are rasterized on separate threads, BlockSize pixels at a time, keeping the
+	/// farthest depth each triangle can have within a pixel whose center it covers. A
+	/// hierarchical Z pyramid of the farthest depth of each 2x2 block is then built, and
+	/// a box is occluded if its nearest point is behind every texel it covers. Triangles
+	/// crossing the near plane are not rasterized, so they never hide anything.
+	class SimpleOcclusionCuller {
+	public:
+		static constexpr unsigned TileSize = 32;
+		static constexpr unsigned BlockSize = 8;
+		static constexpr unsigned DefaultWidth = 256;
+		static constexpr unsigned DefaultHeight = 128;
+
+		SimpleOcclusionCuller() { setResolution(DefaultWidth, DefaultHeight); }
+
+		// The size of the depth buffer, rounded up to whole tiles
+		void setResolution(unsigned width, unsigned height);
+		unsigned width() const { return width_; }
+		unsigned height() const { return height_; }
+
+		// Clears the depth buffer and occluders, viewProjection maps positions to clip space
+		void beginFrame(const Matrix4f& viewProjection);
+
+		// Adds the triangles of indices as occluders. Each index refers to
+		// vertices[index - firstVertex], and triangles outside the vertices are skipped.
+		template <typename IndexType>
+		void addOccluder(const SimpleZVertex* vertices, size_t firstVertex, size_t vertexCount,
+						 const IndexType* indices, size_t indexCount);
+
+		// Rasterizes the occluders and builds the depth pyramid, 0 threads means use all hardware threads
+		void rasterize(unsigned threadCount = 0);
+
+		// Returns true if box is hidden behind the occluders. Boxes crossing the near
+		// plane or outside the screen are never occluded.
+		bool isOccluded(const BoundingBoxf& box) const;
+
+		size_t triangleCount() const { return triangles_.size(); }
+		unsigned levelCount() const { return (unsigned)levels_.size(); }
+		float depth(unsigned level, unsigned x, unsigned y) const { return levels_[level].depth[y * levels_[level].width + x]; }
+
+	private:
+		// edge functions a*x + b*y + c are >= 0 inside, and the depth plane gives the
+		// farthest depth within a pixel
+		struct Triangle {
+			float edge[3][3];
+			float zPlane[3];
+			float zMax;
+			int minX, minY, maxX, maxY;
+		};
+
+		struct Level {
+			unsigned width = 0;
+			unsigned height = 0;
+			std::vector<float> depth;
+		};
+
+		unsigned width_{ 0 };
+		unsigned height_{ 0 };
+		unsigned tilesX_{ 0 };
+		unsigned tilesY_{ 0 };
+		float rows_[4][4] = { { 0.0f } };
+		std::vector<Triangle> triangles_;
+		std::vector<std::vector<unsigned>> bins_;
+		std::vector<Level> levels_;
+
+		inline void transform(const GLfloat* p, float* clip) const {
+			for (unsigned r = 0; r < 4; r++) {
+				clip[r] = rows_[r][0] * p[0] + rows_[r][1] * p[1] + rows_[r][2] * p[2] + rows_[r][3];
+			}
+		}
+
+		void addTriangle(const float clip[3][4]);
+		void rasterizeTile(unsigned tile);
+	};
+
+	template <typename IndexType>
+	void SimpleOcclusionCuller::addOccluder(const SimpleZVertex* vertices, size_t firstVertex, size_t vertexCount,
+											const IndexType* indices, size_t indexCount) {
+		float clip[3][4];
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			bool valid = true;
+			for (unsigned k = 0; k < 3 && valid; k++) {
+				size_t v = (size_t)indices[i + k];
+				valid = v >= firstVertex && v - firstVertex < vertexCount;
+				if (valid)
+					transform(vertices[v - firstVertex].position, clip[k]);
+			}
+			if (valid)
+				addTriangle(clip);
+		}
+	}
+} // namespace Fluxions
+
+#endif
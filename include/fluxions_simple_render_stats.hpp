@@ -0,0 +1,61 @@
+#ifndef FLUXIONS_SIMPLE_RENDER_STATS_HPP
+#define FLUXIONS_SIMPLE_RENDER_STATS_HPP
+
+#include <fluxions_stdcxx.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleMetricsSink receives named values from stats exports</summary>
+	class SimpleMetricsSink {
+	public:
+		virtual ~SimpleMetricsSink() {}
+		virtual void metric(const std::string& name, double value) = 0;
+	};
+
+	/// <summary>SimpleStreamMetricsSink writes each metric as a "name value" line</summary>
+	class SimpleStreamMetricsSink : public SimpleMetricsSink {
+	public:
+		SimpleStreamMetricsSink(std::ostream& out) : out_(out) {}
+		void metric(const std::string& name, double value) override;
+
+	private:
+		std::ostream& out_;
+	};
+
+	// The counters of one render pass
+	struct SimpleRenderPassStats {
+		unsigned long long calls = 0;			// outermost Render calls
+		unsigned long long drawCalls = 0;		// a multi draw is one call
+		unsigned long long vaoSwitches = 0;
+		unsigned long long indices = 0;			// or vertices for glDrawArrays()
+		unsigned long long bytesUploaded = 0;
+		unsigned long long surfacesDrawn = 0;
+		unsigned long long surfacesCulled = 0;
+		double cpuMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		unsigned long long gpuTimerCount = 0;	// timer queries that reported gpuMilliseconds
+
+		void add(const SimpleRenderPassStats& other);
+	};
+
+	/// <summary>SimpleRenderStats keeps the counters of each named render pass</summary>
+	/// Passes are created on first use and are never removed, so pointers to them stay
+	/// valid. reset() zeroes the counters of every pass, usually once per frame.
+	class SimpleRenderStats {
+	public:
+		SimpleRenderPassStats& pass(const std::string& name) { return passes_[name]; }
+		const std::map<std::string, SimpleRenderPassStats>& passes() const { return passes_; }
+
+		// The sum of every pass
+		SimpleRenderPassStats total() const;
+
+		void reset();
+
+		// Sends each counter as prefix + pass + "." + counter, such as "renderer.shadow.drawCalls"
+		void exportTo(SimpleMetricsSink& sink, const std::string& prefix = "renderer.") const;
+
+	private:
+		std::map<std::string, SimpleRenderPassStats> passes_;
+	};
+} // namespace Fluxions
+
+#endif
@@ -4,6 +4,12 @@
 #include <fluxions_simple_vertex.hpp>
 #include <fluxions_simple_surface.hpp>
 #include <fluxions_simple_geometry_mesh.hpp>
+#include <fluxions_simple_multi_draw.hpp>
+#include <fluxions_simple_command_list.hpp>
+#include <fluxions_simple_render_stats.hpp>
+#include <chrono>
+#include <fluxions_simple_frustum_culler.hpp>
+#include <fluxions_simple_occlusion_culler.hpp>
 
 namespace Fluxions {
 	/// <summary>SimpleRenderer handles the needs of several different rendering approaches</summary>
@@ -16,11 +22,11 @@ namespace Fluxions {
 	template <typename IndexType, GLenum GLIndexType>
 	class SimpleRenderer {
 	private:
-		GLuint abo = 0;		// memory structure [ZONLY, FAST VERTICES, SLOW VERTICES]
-		GLuint eabo = 0;	// memory structure [ZONLY, FAST VERTICES, SLOW VERTICES]
+		// Index() skips indices at or above this
+		static constexpr IndexType MaxIndex = std::numeric_limits<IndexType>::max();
 
-		std::vector<GLubyte> vertexMemoryBuffer;
-		std::vector<GLubyte> indexMemoryBuffer;
+		GLuint abo = 0;		// memory structure [ZONLY, FAST VERTICES, SLOW VERTICES]
+		GLuint eabo = 0;	// memory structure [ZONLY INDICES, INDICES]
 
 		std::vector<SimpleZVertex> zVertices;
 		std::vector<SimpleFastVertex> fastVertices;
@@ -28,8 +34,25 @@ namespace Fluxions {
 		std::vector<IndexType> indices;
 		std::vector<IndexType> zIndices;
 		std::vector<SimpleSurface> surfaces;
+
+		// Elements uploaded and then released from the vectors above, which hold the elements after them
+		size_t releasedZVertices = 0;
+		size_t releasedFastVertices = 0;
+		size_t releasedSlowVertices = 0;
+		size_t releasedIndices = 0;
+		size_t releasedZIndices = 0;
+		bool releaseAfterUpload = false;
+
+		size_t ZVertexCount() const { return releasedZVertices + zVertices.size(); }
+		size_t FastVertexCount() const { return releasedFastVertices + fastVertices.size(); }
+		size_t SlowVertexCount() const { return releasedSlowVertices + slowVertices.size(); }
+		size_t IndexCount() const { return releasedIndices + indices.size(); }
+		size_t ZIndexCount() const { return releasedZIndices + zIndices.size(); }
+
 		std::set<unsigned> object_set; // used to tell whether an object exists in the renderer or not (for external purposes)
 
+		// Each section has a reserved capacity and its size is the number of bytes uploaded.
+		// Sections only move when one of them outgrows its capacity.
 		struct BUFFERINFO {
 			GLsizeiptr zVertexOffset = 0;
 			GLsizeiptr zVertexSize = 0;
@@ -43,10 +66,19 @@ namespace Fluxions {
 			GLsizeiptr indexOffset = 0;
 			GLsizeiptr indexSize = 0;
 
+			GLsizeiptr zVertexCapacity = 0;
+			GLsizeiptr fastVertexCapacity = 0;
+			GLsizeiptr slowVertexCapacity = 0;
+			GLsizeiptr zIndexCapacity = 0;
+			GLsizeiptr indexCapacity = 0;
+
 			GLsizeiptr vertexBufferSizeInBytes = 0;
 			GLsizeiptr indexBufferSizeInBytes = 0;
 		} bufferInfo;
 
+		// surfaces before this have their buffer offsets computed
+		unsigned fixedSurfaceCount = 0;
+
 		SimpleFastVertex currentFastVertex;
 		SimpleSlowVertex currentSlowVertex;
 		SimpleBoneVertex currentBoneVertex;
@@ -60,10 +92,10 @@ namespace Fluxions {
 		GLuint currentGroupId = 0;
 		GLuint currentObjectId = 0;
 		GLuint currentProgramId = 0;
-		std::string currentMtlName;
-		std::string currentMtlLibName;
-		std::string currentObjectName;
-		std::string currentGroupName;
+		Symbol currentMtlName;
+		Symbol currentMtlLibName;
+		Symbol currentObjectName;
+		Symbol currentGroupName;
 
 		VertexType lastVertexType = VertexType::UNDECIDED;
 
@@ -75,7 +107,115 @@ namespace Fluxions {
 		bool isMakingSurface = false;
 		unsigned currentSurface = 0;
 
-		void BuildMemoryBuffers();
+		// One draw call of a compiled draw list
+		struct DRAWCALL {
+			GLuint vao = 0;
+			GLenum mode = 0;
+			bool isIndexed = false;
+			GLsizei count = 0;
+			GLint first = 0;
+			GLsizeiptr offset = 0;
+		};
+
+		// The draw calls of one (objectId, drawMtlId) bucket
+		struct DRAWRANGE {
+			unsigned first = 0;		// into drawCalls
+			unsigned count = 0;
+			unsigned zFirst = 0;	// into zDrawCalls
+			unsigned zCount = 0;
+			int surfaceCount = 0;
+			unsigned surfaceFirst = 0;	// into drawOrder
+			unsigned zSurfaceFirst = 0;	// into zDrawOrder
+
+			// the indexed draws as multi draw batches, drawArrays is the number of the rest
+			unsigned batchFirst = 0;
+			unsigned batchCount = 0;
+			unsigned drawArrays = 0;
+			unsigned zBatchFirst = 0;
+			unsigned zBatchCount = 0;
+			unsigned zDrawArrays = 0;
+		};
+
+		std::vector<DRAWCALL> drawCalls;
+		std::vector<DRAWCALL> zDrawCalls;
+		std::unordered_map<uint64_t, DRAWRANGE> drawRanges;
+		bool drawListsDirty = true;
+
+		// the surfaces in the order they were compiled, which culled draws are rebuilt from
+		std::vector<unsigned> drawOrder;
+		std::vector<unsigned> zDrawOrder;
+		std::vector<DRAWCALL> culledDrawCalls;
+
+		SimpleFrustumCuller culler;
+		bool cullingEnabled = false;
+
+		SimpleOcclusionCuller occlusionCuller;
+		std::set<GLuint> occluderObjectIds;
+
+		void CullOccludedSurfaces(unsigned threadCount);
+
+		SimpleMultiDrawBatch multiDraw;
+		GLuint drawIndirectBuffer = 0;
+		bool useMultiDraw = true;
+		bool useMultiDrawIndirect = false;
+
+		static uint64_t DrawRangeKey(GLuint objectId, GLint mtlId) { return ((uint64_t)objectId << 32) | (uint32_t)mtlId; }
+		void SubmitDrawCalls(const DRAWCALL* calls, unsigned count);
+		DRAWCALL MakeDrawCall(const SimpleSurface& surface, bool onlyRenderZ) const;
+		// appends a draw of surface to calls, joining it with the last one after bucketFirst if possible
+		void AppendDrawCall(std::vector<DRAWCALL>& calls, size_t bucketFirst, const SimpleSurface& surface, bool onlyRenderZ);
+		// the same for command lists, where only commands after listFirst are joined
+		void RecordDrawCall(SimpleCommandList& list, size_t listFirst, const DRAWCALL& call) const;
+		void SubmitBatches(unsigned firstBatch, unsigned batchCount, const DRAWCALL* calls, unsigned count, unsigned drawArrays);
+
+		// merged command lists and the arrays of their multi draws, used on the GL thread
+		SimpleCommandList mergedCommands;
+		std::vector<GLsizei> commandCounts;
+		std::vector<const GLvoid*> commandOffsets;
+
+		// the counters of the current pass, or nullptr while stats are disabled
+		SimpleRenderStats stats;
+		SimpleRenderPassStats* passStats = nullptr;
+		std::string statsPassName = "default";
+		bool useGpuTimers = false;
+
+		// the outermost Render call being timed
+		bool statsScopeActive = false;
+		SimpleRenderPassStats* scopeStats = nullptr;
+		std::chrono::steady_clock::time_point scopeStart;
+		GLuint scopeTimerQuery = 0;
+
+		struct TIMERQUERY {
+			GLuint query = 0;
+			SimpleRenderPassStats* pass = nullptr;
+		};
+		std::vector<GLuint> freeTimerQueries;
+		std::vector<TIMERQUERY> pendingTimerQueries;
+
+		// Times the public Render call it is created in, unless it was called by another one
+		struct STATSSCOPE {
+			SimpleRenderer& renderer;
+			bool active;
+			STATSSCOPE(SimpleRenderer& r) : renderer(r), active(r.BeginStatsScope()) {}
+			~STATSSCOPE() {
+				if (active)
+					renderer.EndStatsScope();
+			}
+		};
+		bool BeginStatsScope();
+		void EndStatsScope();
+
+		// the Render calls bind VAOs and draw through these, so the stats count every call
+		void BindVertexArray(GLuint vao);
+		void DrawElements(GLenum mode, GLsizei count, GLsizeiptr offset);
+		void DrawArrays(GLenum mode, GLint first, GLsizei count);
+		void CountMultiDraw(const GLsizei* counts, GLsizei drawCount);
+		void CountSurfaces(size_t drawn, size_t culled);
+
+		void SetupVertexArrays();
+		void AppendIndices(const unsigned* meshIndices, size_t count);
+		void AppendTranslatedSurface(const std::vector<SimpleGeometryMesh::Vertex>& meshVertices,
+									 const unsigned* meshIndices, size_t count, const Vector3f& offset);
 		void HandleVertexTypeChange(VertexType vertexType);
 		void EmitVertex();
 		void ZVertex(GLfloat x, GLfloat y, GLfloat z);
@@ -149,8 +289,65 @@ namespace Fluxions {
 		void BoneWeight4f(Vector4f v) { VertexAttrib4f(BONEWEIGHT, v.x, v.y, v.z, v.w); }
 		void Attrib24f(Vector4f v) { VertexAttrib4f(ATTRIB2, v.x, v.y, v.z, v.w); }
 
+		// Uploads the vertices and indices added since the last call. The sections of each
+		// buffer are grown by copying on the GPU when they run out of reserved capacity.
 		bool BuildBuffers();
 		void BindBuffers();
+
+		// Frees the CPU copies of vertices and indices once BuildBuffers() has uploaded them.
+		// Geometry can still be added afterwards. Needs glCopyBufferSubData() support.
+		void SetReleaseAfterUpload(bool enabled) { releaseAfterUpload = enabled; }
+
+		// Buckets the surfaces by objectId and drawMtlId, sorts each bucket by VAO, mode,
+		// and index offset, and joins draws of adjacent index ranges. RenderIf(objectId, mtlId)
+		// calls this when surfaces or ids have changed since the last call.
+		void CompileDrawLists();
+
+		// If enabled, RenderIf(objectId, mtlId) submits the draws of a bucket with
+		// glMultiDrawElementsIndirect(), or glMultiDrawElements() without GL 4.3
+		void SetUseMultiDraw(bool enabled) { useMultiDraw = enabled; }
+
+		// Tests the bounding box of each surface against the frustum of viewProjection, which
+		// maps surface coordinates to clip space. Until DisableCulling(), the Render calls skip
+		// surfaces outside it. Surfaces without bounds are always drawn.
+		void CullSurfaces(const Matrix4f& viewProjection, unsigned threadCount = 0);
+		void DisableCulling() { cullingEnabled = false; }
+		bool IsSurfaceVisible(size_t i) const { return !cullingEnabled || culler.visible(i); }
+
+		// The triangles of occluder objects are rasterized into a small depth buffer by
+		// CullSurfaces(), which then also culls the surfaces hidden behind them.
+		// Occluders come from the Z only geometry, so they must not be released.
+		void SetOccluder(GLuint objectId, bool isOccluder = true);
+		void SetOcclusionResolution(unsigned width, unsigned height) { occlusionCuller.setResolution(width, height); }
+
+		// Builds the buffers and draw lists on the GL thread. Afterwards RecordIf() and
+		// RecordSurfaces() may be called from several threads at once, until geometry, ids,
+		// or culling change. Returns false if the buffers could not be built.
+		bool PrepareRecording();
+
+		// Records the draws RenderIf(objectId, mtlId) would submit and returns the number of
+		// visible surfaces. Nothing is recorded if the draw lists are not prepared.
+		int RecordIf(SimpleCommandList& list, GLuint objectId, int mtlId, bool onlyRenderZ = false) const;
+
+		// Records the visible surfaces in [first, last) in order, so threads can split the surfaces
+		void RecordSurfaces(SimpleCommandList& list, size_t first, size_t last, bool onlyRenderZ = false) const;
+
+		// Merges the lists, sorts them by sort key, and submits them. setDrawData is called
+		// before each run of commands with the same draw data. Runs of indexed draws with the
+		// same VAO and mode are submitted with glMultiDrawElements() if multi draw is enabled.
+		void SubmitCommandLists(const SimpleCommandList* lists, size_t listCount, const std::function<void(uint32_t)>& setDrawData = nullptr);
+
+		// Counts draw calls, VAO switches, indices, uploads, and drawn and culled surfaces, and
+		// times each Render call, into the pass named by SetStatsPass(). With gpuTimers, GPU time
+		// is measured with timer queries where available. Their results arrive a frame or more
+		// later, and CollectGpuTimes() adds the finished ones to the passes that issued them.
+		void EnableStats(bool enabled, bool gpuTimers = false);
+		void SetStatsPass(const std::string& name);
+		void CollectGpuTimes(bool wait = false);
+		const SimpleRenderStats& GetStats() const { return stats; }
+		void ResetStats() { stats.reset(); }
+
+
 		void reset(bool softReset);
 		void Render();
 		void RenderIf(const std::string& objectName, const std::string& groupName, const std::string& mtllibName, const std::string& mtlName, bool onlyRenderZ = false);
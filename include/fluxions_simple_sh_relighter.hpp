@@ -0,0 +1,45 @@
+#ifndef FLUXIONS_SIMPLE_SH_RELIGHTER_HPP
+#define FLUXIONS_SIMPLE_SH_RELIGHTER_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_gte_spherical_harmonic.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleSHRelighter computes vertex colors from per-vertex SH transfer vectors</summary>
+	/// Each vertex color is the dot product of the vertex sh[9] transfer vector with
+	/// the environment lighting coefficients of each color channel. Vertices are
+	/// processed in blocks of BlockSize and blocks are split across threads.
+	class SimpleSHRelighter {
+	public:
+		static constexpr unsigned NumCoefficients = 9;
+		static constexpr unsigned BlockSize = 8;
+
+		// Set the environment from one SphericalHarmonicf per color channel
+		void setEnvironment(const SphericalHarmonicf& r, const SphericalHarmonicf& g, const SphericalHarmonicf& b);
+
+		// Set the environment from a single SphericalHarmonicf tinted by color
+		void setEnvironment(const SphericalHarmonicf& sph, const Color3f& color);
+
+		// Set the environment from first order coefficients stored like BaseEnvironment::fogSH
+		void setEnvironment(const Vector4f& sh4, const Color3f& color);
+
+		// Number of threads used by relight(), 0 means use all hardware threads
+		void setThreadCount(unsigned count) { threadCount_ = count; }
+
+		// Writes one color per vertex of mesh into colors
+		void relight(const SimpleGeometryMesh& mesh, std::vector<Color4f>& colors) const;
+
+		// Writes count colors from transfer vectors starting at sh and separated by stride bytes
+		void relight(const float* sh, size_t strideInBytes, size_t count, Color4f* colors) const;
+
+	private:
+		// environment coefficients, indexed by [channel][coefficient]
+		float env_[3][NumCoefficients]{};
+		unsigned threadCount_{ 0 };
+
+		void relightRange(const float* sh, size_t strideInBytes, size_t first, size_t last, Color4f* colors) const;
+	};
+} // namespace Fluxions
+
+#endif
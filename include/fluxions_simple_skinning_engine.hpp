@@ -0,0 +1,56 @@
+#ifndef FLUXIONS_SIMPLE_SKINNING_ENGINE_HPP
+#define FLUXIONS_SIMPLE_SKINNING_ENGINE_HPP
+
+#include <fluxions_base.hpp>
+#include <fluxions_simple_geometry_mesh.hpp>
+
+namespace Fluxions {
+	/// <summary>SimpleSkinningEngine skins mesh vertices on the CPU with a matrix palette</summary>
+	/// Each vertex blends the palette matrices of its four boneIndex entries by its
+	/// boneWeights. Vertices are processed in blocks of BlockSize with the blended
+	/// matrices and attributes in SoA form, and blocks are split across threads. The
+	/// results are written to separate arrays, so the source mesh is never modified.
+	class SimpleSkinningEngine {
+	public:
+		static constexpr unsigned BlockSize = 8;
+		static constexpr unsigned MaxInfluences = 4;
+
+		// The skinned attributes of each vertex
+		struct Output {
+			std::vector<Vector3f> positions;
+			std::vector<Vector3f> normals;
+			std::vector<Vector3f> tangents;
+		};
+
+		// Sets the bone matrices. Only the affine part is used and normals and tangents
+		// are transformed by the upper 3x3 and renormalized, so bones should not have
+		// non-uniform scale.
+		void setPalette(const std::vector<Matrix4f>& palette) { setPalette(palette.data(), palette.size()); }
+		void setPalette(const Matrix4f* palette, size_t count);
+		size_t paletteSize() const { return palette_.size() / 12; }
+
+		// Number of threads used by skin(), 0 means use all hardware threads
+		void setThreadCount(unsigned count) { threadCount_ = count; }
+
+		// Skins every vertex of mesh into output. Tangents are computed lazily, so they are
+		// only skinned if the mesh has valid tangents, see ensureTangents(), and
+		// output.tangents is left empty otherwise.
+		void skin(const SimpleGeometryMesh& mesh, Output& output) const;
+
+		// Skins count vertices. Any of positions, normals, or tangents may be null to skip it.
+		// Bone indices outside the palette are ignored and the remaining weights are
+		// normalized. A vertex without weights is copied.
+		void skin(const SimpleGeometryMesh::Vertex* vertices, size_t count,
+				  Vector3f* positions, Vector3f* normals, Vector3f* tangents) const;
+
+	private:
+		// the rows of the 3x4 affine part of each matrix, 12 floats per bone
+		std::vector<float> palette_;
+		unsigned threadCount_{ 0 };
+
+		void skinRange(const SimpleGeometryMesh::Vertex* vertices, size_t first, size_t last,
+					   Vector3f* positions, Vector3f* normals, Vector3f* tangents) const;
+	};
+} // namespace Fluxions
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef FLUXIONS_SIMPLE_SURFACE_HPP
 #define FLUXIONS_SIMPLE_SURFACE_HPP
 
+#include <fluxions_gte.hpp>
+#include <fluxions_symbol.hpp>
 #include <fluxions_simple_vertex.hpp>
 
 namespace Fluxions {
@@ -42,10 +44,20 @@ namespace Fluxions {
 		GLuint mtllibId = 0;
 		GLint drawMtlId{ -1 };
 
-		std::string mtlName;
-		std::string mtllibName;
-		std::string objectName;
-		std::string groupName;
+		// Bounding volumes for culling (valid if hasBounds is true)
+		bool hasBounds = false;
+		BoundingBoxf boundingBox;
+		Vector3f sphereCenter;
+		float sphereRadius = 0.0f;
+
+		// If instanceOf >= 0, this surface draws the same indices as surfaces[instanceOf]
+		// in the same place, so only its material may differ
+		GLint instanceOf{ -1 };
+
+		Symbol mtlName;
+		Symbol mtllibName;
+		Symbol objectName;
+		Symbol groupName;
 	};
 } // namespace Fluxions
 
@@ -14,12 +14,15 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <list>
 #include <functional>
 #include <regex>
 #include <random>
 #include <future>
+#include <mutex>
+#include <atomic>
 #include <cctype>
 #include <cfloat>
 
@@ -0,0 +1,61 @@
+#ifndef FLUXIONS_SYMBOL_HPP
+#define FLUXIONS_SYMBOL_HPP
+
+#include <fluxions_stdcxx.hpp>
+
+namespace Fluxions {
+	/// <summary>Symbol is an interned string represented by a 32-bit id</summary>
+	/// Equal strings always have the same id, so comparing and hashing symbols are
+	/// integer operations. The text is kept in a process wide, thread safe table and
+	/// is never freed. The empty string always has id 0.
+	class Symbol {
+	public:
+		Symbol() {}
+		Symbol(const std::string& s) : id_(Intern(s)) {}
+		Symbol(const char* s) : id_(s ? Intern(s) : 0) {}
+
+		// Returns the symbol for s if it was interned before, otherwise the empty symbol
+		static Symbol Find(std::string_view s);
+
+		// Returns the number of strings in the table, including the empty string
+		static unsigned TableSize();
+
+		inline unsigned id() const { return id_; }
+		inline bool empty() const { return id_ == 0; }
+		inline size_t size() const { return str().size(); }
+		inline const char* c_str() const { return str().c_str(); }
+		const std::string& str() const;
+
+		inline operator const std::string&() const { return str(); }
+
+		inline bool operator==(Symbol other) const { return id_ == other.id_; }
+		inline bool operator!=(Symbol other) const { return id_ != other.id_; }
+		inline bool operator==(const std::string& s) const { return str() == s; }
+		inline bool operator!=(const std::string& s) const { return str() != s; }
+		inline bool operator==(const char* s) const { return str() == s; }
+		inline bool operator!=(const char* s) const { return str() != s; }
+
+		// Orders by id (the order of interning), not alphabetically
+		inline bool operator<(Symbol other) const { return id_ < other.id_; }
+
+	private:
+		unsigned id_{ 0 };
+
+		static unsigned Intern(std::string_view s);
+	};
+
+	inline std::ostream& operator<<(std::ostream& ostr, Symbol symbol) {
+		return ostr << symbol.str();
+	}
+} // namespace Fluxions
+
+namespace std {
+	template <>
+	struct hash<Fluxions::Symbol> {
+		size_t operator()(Fluxions::Symbol symbol) const noexcept {
+			return std::hash<unsigned>()(symbol.id());
+		}
+	};
+} // namespace std
+
+#endif
@@ -1,6 +1,7 @@
 #include "fluxions_base_pch.hpp"
 #include <fluxions_base.hpp>
 #include <fluxions_file_system.hpp>
+#include <fluxions_simple_cache_writer.hpp>
 
 namespace Fluxions {
 	bool debugging = false;
@@ -115,7 +116,10 @@ namespace Fluxions {
 #endif
 	}
 
-	void Kill() {}
+	void Kill() {
+		// finish any cache files that are still being written
+		SimpleCacheWriter::Get().shutdown();
+	}
 
 	void YieldThread() {
 #ifdef _WIN32
@@ -233,6 +233,278 @@ const char* FxGetFramebufferStatusAsString(GLenum status) {
 }
 
 
+// FxGraphicsState
+// Shadow copy of the GL state set through the Fx* functions
+
+namespace {
+	// shadow values that are not known, which never match a value being set
+	constexpr GLuint FX_UNKNOWN = ~0u;
+	constexpr GLint FX_UNKNOWN_SIZE = -1;
+
+	const GLenum fxTextureTargets[] = {
+		GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP,
+		GL_TEXTURE_1D_ARRAY, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_RECTANGLE, GL_TEXTURE_CUBE_MAP_ARRAY
+	};
+	const GLenum fxBufferTargets[] = {
+		GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+		GL_DRAW_INDIRECT_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_UNIFORM_BUFFER
+	};
+	const GLenum fxCapabilities[] = {
+		GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_STENCIL_TEST
+	};
+	constexpr int FX_TEXTURE_TARGETS = sizeof(fxTextureTargets) / sizeof(GLenum);
+	constexpr int FX_BUFFER_TARGETS = sizeof(fxBufferTargets) / sizeof(GLenum);
+	constexpr int FX_CAPABILITIES = sizeof(fxCapabilities) / sizeof(GLenum);
+
+	struct FxTextureUnitState {
+		GLuint textures[FX_TEXTURE_TARGETS];
+		GLuint sampler;
+	};
+
+	struct FxGraphicsState {
+		bool enabled{ true };
+		GLuint program{ FX_UNKNOWN };
+		GLuint vao{ FX_UNKNOWN };
+		GLuint activeTexture{ FX_UNKNOWN };
+		GLuint buffers[FX_BUFFER_TARGETS];
+		GLuint capabilities[FX_CAPABILITIES];
+		GLuint blendFunc[4];
+		GLuint blendEquation[2];
+		GLuint depthFunc{ FX_UNKNOWN };
+		GLuint depthMask{ FX_UNKNOWN };
+		GLint viewport[4];
+		GLint scissor[4];
+		std::vector<FxTextureUnitState> units;
+		FxGraphicsStateStats stats;
+
+		FxGraphicsState() { invalidate(); }
+
+		void invalidate() {
+			program = FX_UNKNOWN;
+			vao = FX_UNKNOWN;
+			activeTexture = FX_UNKNOWN;
+			std::fill_n(buffers, FX_BUFFER_TARGETS, FX_UNKNOWN);
+			std::fill_n(capabilities, FX_CAPABILITIES, FX_UNKNOWN);
+			std::fill_n(blendFunc, 4, FX_UNKNOWN);
+			std::fill_n(blendEquation, 2, FX_UNKNOWN);
+			depthFunc = FX_UNKNOWN;
+			depthMask = FX_UNKNOWN;
+			std::fill_n(viewport, 4, FX_UNKNOWN_SIZE);
+			std::fill_n(scissor, 4, FX_UNKNOWN_SIZE);
+			for (auto& unit : units) {
+				std::fill_n(unit.textures, FX_TEXTURE_TARGETS, FX_UNKNOWN);
+				unit.sampler = FX_UNKNOWN;
+			}
+		}
+	} g_GraphicsState;
+
+	template <int count>
+	int FxIndexOf(const GLenum(&values)[count], GLenum value) {
+		for (int i = 0; i < count; i++) {
+			if (values[i] == value)
+				return i;
+		}
+		return -1;
+	}
+
+	// Stores the new values and returns true if the call setting them must be issued
+	template <typename T, int count>
+	bool FxStateChanged(T(&shadow)[count], const T(&values)[count]) {
+		if (g_GraphicsState.enabled && std::equal(values, values + count, shadow)) {
+			g_GraphicsState.stats.filteredCalls++;
+			return false;
+		}
+		std::copy(values, values + count, shadow);
+		g_GraphicsState.stats.issuedCalls++;
+		return true;
+	}
+
+	bool FxStateChanged(GLuint& shadow, GLuint value) {
+		if (g_GraphicsState.enabled && shadow == value) {
+			g_GraphicsState.stats.filteredCalls++;
+			return false;
+		}
+		shadow = value;
+		g_GraphicsState.stats.issuedCalls++;
+		return true;
+	}
+
+	// Calls that change untracked state are always issued
+	void FxStateUntracked() {
+		g_GraphicsState.stats.issuedCalls++;
+	}
+
+	// Returns the shadow of a query, which is read with glGetIntegerv() if it is not known
+	GLint FxQueryState(GLuint& shadow, GLenum pname) {
+		if (!g_GraphicsState.enabled || shadow == FX_UNKNOWN) {
+			GLint value = 0;
+			glGetIntegerv(pname, &value);
+			shadow = (GLuint)value;
+			g_GraphicsState.stats.issuedCalls++;
+			g_GraphicsState.stats.queryCalls++;
+		}
+		else {
+			g_GraphicsState.stats.filteredCalls++;
+		}
+		return (GLint)shadow;
+	}
+
+	void FxQueryState(GLint(&shadow)[4], GLenum pname, GLint* values) {
+		if (!g_GraphicsState.enabled || shadow[2] == FX_UNKNOWN_SIZE) {
+			glGetIntegerv(pname, shadow);
+			g_GraphicsState.stats.issuedCalls++;
+			g_GraphicsState.stats.queryCalls++;
+		}
+		else {
+			g_GraphicsState.stats.filteredCalls++;
+		}
+		std::copy(shadow, shadow + 4, values);
+	}
+
+	GLboolean FxQueryCapability(GLenum capability) {
+		GLuint& shadow = g_GraphicsState.capabilities[FxIndexOf(fxCapabilities, capability)];
+		if (!g_GraphicsState.enabled || shadow == FX_UNKNOWN) {
+			shadow = glIsEnabled(capability) ? 1 : 0;
+			g_GraphicsState.stats.issuedCalls++;
+			g_GraphicsState.stats.queryCalls++;
+		}
+		else {
+			g_GraphicsState.stats.filteredCalls++;
+		}
+		return shadow ? GL_TRUE : GL_FALSE;
+	}
+
+	// The shadow of a texture binding, or nullptr if the unit or target is not tracked
+	GLuint* FxTextureShadow(GLuint unit, GLenum target) {
+		int index = FxIndexOf(fxTextureTargets, target);
+		if (unit >= g_GraphicsState.units.size() || index < 0)
+			return nullptr;
+		return &g_GraphicsState.units[unit].textures[index];
+	}
+
+	// Binds texture to the active unit
+	void FxBindActiveTexture(GLenum target, GLuint texture) {
+		GLuint* shadow = FxTextureShadow(g_GraphicsState.activeTexture, target);
+		if (!shadow) {
+			FxStateUntracked();
+			glBindTexture(target, texture);
+		}
+		else if (FxStateChanged(*shadow, texture)) {
+			glBindTexture(target, texture);
+		}
+	}
+
+	// Deleted objects are unbound from the current context, so their shadows become 0
+	void FxForgetName(GLuint* shadows, size_t count, GLuint name) {
+		std::replace(shadows, shadows + count, name, 0u);
+	}
+}
+
+void FxEnableGraphicsStateCache(bool enabled) {
+	g_GraphicsState.enabled = enabled;
+	g_GraphicsState.invalidate();
+}
+
+bool FxIsGraphicsStateCacheEnabled() {
+	return g_GraphicsState.enabled;
+}
+
+void FxInvalidateGraphicsState() {
+	g_GraphicsState.invalidate();
+}
+
+const FxGraphicsStateStats& FxGetGraphicsStateStats() {
+	return g_GraphicsState.stats;
+}
+
+void FxResetGraphicsStateStats() {
+	g_GraphicsState.stats = FxGraphicsStateStats();
+}
+
+void FxUseProgram(GLuint program) {
+	if (FxStateChanged(g_GraphicsState.program, program))
+		glUseProgram(program);
+}
+
+void FxBindVertexArray(GLuint vao) {
+	if (FxStateChanged(g_GraphicsState.vao, vao)) {
+		glBindVertexArray(vao);
+		// the element array buffer binding belongs to the VAO
+		g_GraphicsState.buffers[FxIndexOf(fxBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = FX_UNKNOWN;
+	}
+}
+
+void FxBindBuffer(GLenum target, GLuint buffer) {
+	int index = FxIndexOf(fxBufferTargets, target);
+	if (index < 0) {
+		FxStateUntracked();
+		glBindBuffer(target, buffer);
+	}
+	else if (FxStateChanged(g_GraphicsState.buffers[index], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void FxEnable(GLenum capability) {
+	int index = FxIndexOf(fxCapabilities, capability);
+	if (index < 0) {
+		FxStateUntracked();
+		glEnable(capability);
+	}
+	else if (FxStateChanged(g_GraphicsState.capabilities[index], 1u)) {
+		glEnable(capability);
+	}
+}
+
+void FxDisable(GLenum capability) {
+	int index = FxIndexOf(fxCapabilities, capability);
+	if (index < 0) {
+		FxStateUntracked();
+		glDisable(capability);
+	}
+	else if (FxStateChanged(g_GraphicsState.capabilities[index], 0u)) {
+		glDisable(capability);
+	}
+}
+
+void FxBlendFunc(GLenum src, GLenum dst) {
+	FxBlendFuncSeparate(src, dst, src, dst);
+}
+
+void FxBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha) {
+	const GLuint values[4] = { srcRGB, dstRGB, srcAlpha, dstAlpha };
+	if (FxStateChanged(g_GraphicsState.blendFunc, values))
+		glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+}
+
+void FxBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+	const GLuint values[2] = { modeRGB, modeAlpha };
+	if (FxStateChanged(g_GraphicsState.blendEquation, values))
+		glBlendEquationSeparate(modeRGB, modeAlpha);
+}
+
+void FxDepthFunc(GLenum func) {
+	if (FxStateChanged(g_GraphicsState.depthFunc, (GLuint)func))
+		glDepthFunc(func);
+}
+
+void FxDepthMask(GLboolean flag) {
+	if (FxStateChanged(g_GraphicsState.depthMask, flag ? 1u : 0u))
+		glDepthMask(flag);
+}
+
+void FxViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	const GLint values[4] = { x, y, width, height };
+	if (FxStateChanged(g_GraphicsState.viewport, values))
+		glViewport(x, y, width, height);
+}
+
+void FxScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+	const GLint values[4] = { x, y, width, height };
+	if (FxStateChanged(g_GraphicsState.scissor, values))
+		glScissor(x, y, width, height);
+}
+
 GLint FxSetActiveTexture(GLint unit) {
 	if (g_MaxCombinedTextureUnits == 0) {
 		glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &g_MaxCombinedTextureUnits);
@@ -242,7 +514,15 @@ GLint FxSetActiveTexture(GLint unit) {
 	if (unit < 0 || unit >= g_MaxCombinedTextureUnits)
 		return -1;
 
-	glActiveTexture(GL_TEXTURE0 + unit);
+	if (g_GraphicsState.units.size() < (size_t)g_MaxCombinedTextureUnits) {
+		FxTextureUnitState unknown;
+		std::fill_n(unknown.textures, FX_TEXTURE_TARGETS, FX_UNKNOWN);
+		unknown.sampler = FX_UNKNOWN;
+		g_GraphicsState.units.resize(g_MaxCombinedTextureUnits, unknown);
+	}
+
+	if (FxStateChanged(g_GraphicsState.activeTexture, (GLuint)unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
 	return unit;
 }
 
@@ -255,8 +535,9 @@ bool FxBindTextureAndSampler(GLint unit, GLenum target, GLuint texture, GLuint s
 	if (unit < 0)
 		return false;
 
-	glBindTexture(target, texture);
-	glBindSampler(unit, sampler);
+	FxBindActiveTexture(target, texture);
+	if (FxStateChanged(g_GraphicsState.units[unit].sampler, sampler))
+		glBindSampler(unit, sampler);
 	return true;
 }
 
@@ -265,7 +546,7 @@ bool FxBindTexture(GLint unit, GLenum target, GLuint texture) {
 	if (unit < 0)
 		return false;
 
-	glBindTexture(target, texture);
+	FxBindActiveTexture(target, texture);
 	return true;
 }
 
@@ -274,13 +555,14 @@ bool FxBindSampler(GLint unit, GLuint sampler) {
 	if (unit < 0)
 		return false;
 
-	glBindSampler(unit, sampler);
+	if (FxStateChanged(g_GraphicsState.units[unit].sampler, sampler))
+		glBindSampler(unit, sampler);
 	return true;
 }
 
 bool FxDebugBindTexture(GLenum target, GLuint texture) {
 	while (glGetError() != GL_NO_ERROR);
-	glBindTexture(target, texture);
+	FxBindActiveTexture(target, texture);
 	while (glGetError() != GL_NO_ERROR) {
 		GLint id1, id2;
 		glGetIntegerv(GL_TEXTURE_BINDING_2D, &id1);
@@ -299,7 +581,7 @@ bool FxCreateBuffer(GLenum target, unsigned* p, GLsizeiptr size, const void* dat
 		if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("buffer %d created", *p); }
 	}
 	if (*p) {
-		glBindBuffer(target, *p);
+		FxBindBuffer(target, *p);
 		if (data != nullptr) glBufferData(target, size, data, usage);
 	}
 	return *p != 0;
@@ -308,6 +590,7 @@ bool FxCreateBuffer(GLenum target, unsigned* p, GLsizeiptr size, const void* dat
 void FxDeleteBuffer(GLuint* p) {
 	if (*p == 0) return;
 	glDeleteBuffers(1, p);
+	FxForgetName(g_GraphicsState.buffers, FX_BUFFER_TARGETS, *p);
 	if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("buffer %d deleted", *p); }
 	*p = 0;
 }
@@ -348,7 +631,7 @@ bool FxCreateTexture(GLenum target, GLuint* p) {
 	if (*p) FxDeleteTexture(p);
 	if (!*p) {
 		glGenTextures(1, p);
-		glBindTexture(target, *p);
+		FxBindActiveTexture(target, *p);
 		if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("texture %d created", *p); }
 	}
 	return *p != 0;
@@ -357,6 +640,9 @@ bool FxCreateTexture(GLenum target, GLuint* p) {
 void FxDeleteTexture(GLuint* p) {
 	if (*p == 0) return;
 	glDeleteTextures(1, p);
+	for (auto& unit : g_GraphicsState.units) {
+		FxForgetName(unit.textures, FX_TEXTURE_TARGETS, *p);
+	}
 	if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("texture %d deleted", *p); }
 	*p = 0;
 }
@@ -373,6 +659,9 @@ bool FxCreateSampler(GLuint* p) {
 void FxDeleteSampler(GLuint* p) {
 	if (*p == 0) return;
 	glDeleteSamplers(1, p);
+	for (auto& unit : g_GraphicsState.units) {
+		FxForgetName(&unit.sampler, 1, *p);
+	}
 	if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("sampler %d deleted", *p); }
 	*p = 0;
 }
@@ -382,13 +671,17 @@ bool FxCreateVertexArray(GLuint* p) {
 	if (*p) FxDeleteVertexArray(p);
 	glGenVertexArrays(1, p);
 	if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("vao %d created", *p); }
-	glBindVertexArray(*p);
+	FxBindVertexArray(*p);
 	return *p != 0;
 }
 
 void FxDeleteVertexArray(GLuint* p) {
 	if (*p == 0) return;
 	glDeleteVertexArrays(1, p);
+	if (g_GraphicsState.vao == *p) {
+		g_GraphicsState.vao = 0;
+		g_GraphicsState.buffers[FxIndexOf(fxBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = FX_UNKNOWN;
+	}
 	if constexpr (debuggingLevel >= DEBUGGING_DEBUGS) { HFLOGDEBUG("vao %d deleted", *p); }
 	*p = 0;
 }
@@ -444,59 +737,72 @@ void FxClearScreenRgb(GLfloat r, GLfloat g, GLfloat b) {
 }
 
 FxSaveGraphicsState::FxSaveGraphicsState() {
-	glGetIntegerv(GL_ACTIVE_TEXTURE, &last_active_texture);
-	glActiveTexture(GL_TEXTURE0);
-	glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-	glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
-	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &last_element_array_buffer);
-	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
-	glGetIntegerv(GL_BLEND_SRC_RGB, &last_blend_src_rgb);
-	glGetIntegerv(GL_BLEND_DST_RGB, &last_blend_dst_rgb);
-	glGetIntegerv(GL_BLEND_SRC_ALPHA, &last_blend_src_alpha);
-	glGetIntegerv(GL_BLEND_DST_ALPHA, &last_blend_dst_alpha);
-	glGetIntegerv(GL_BLEND_EQUATION_RGB, &last_blend_equation_rgb);
-	glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &last_blend_equation_alpha);
-	glGetIntegerv(GL_VIEWPORT, last_viewport);
-	glGetIntegerv(GL_SCISSOR_BOX, last_scissor_box);
-	GLboolean last_enable_blend = glIsEnabled(GL_BLEND);
-	GLboolean last_enable_cull_face = glIsEnabled(GL_CULL_FACE);
-	GLboolean last_enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
-	GLboolean last_enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+	// the shadow copy holds the active texture as a unit number
+	if (g_GraphicsState.enabled && g_GraphicsState.activeTexture != FX_UNKNOWN) {
+		last_active_texture = GL_TEXTURE0 + g_GraphicsState.activeTexture;
+		g_GraphicsState.stats.filteredCalls++;
+	}
+	else {
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &last_active_texture);
+		g_GraphicsState.activeTexture = last_active_texture - GL_TEXTURE0;
+		g_GraphicsState.stats.issuedCalls++;
+		g_GraphicsState.stats.queryCalls++;
+	}
+	FxSetActiveTexture(0);
+	GLuint untrackedTexture = FX_UNKNOWN;
+	GLuint* texture = FxTextureShadow(0, GL_TEXTURE_2D);
+	last_texture = FxQueryState(texture ? *texture : untrackedTexture, GL_TEXTURE_BINDING_2D);
+	last_program = FxQueryState(g_GraphicsState.program, GL_CURRENT_PROGRAM);
+	last_array_buffer = FxQueryState(g_GraphicsState.buffers[FxIndexOf(fxBufferTargets, GL_ARRAY_BUFFER)], GL_ARRAY_BUFFER_BINDING);
+	last_vertex_array = FxQueryState(g_GraphicsState.vao, GL_VERTEX_ARRAY_BINDING);
+	last_element_array_buffer = FxQueryState(g_GraphicsState.buffers[FxIndexOf(fxBufferTargets, GL_ELEMENT_ARRAY_BUFFER)], GL_ELEMENT_ARRAY_BUFFER_BINDING);
+	last_blend_src_rgb = FxQueryState(g_GraphicsState.blendFunc[0], GL_BLEND_SRC_RGB);
+	last_blend_dst_rgb = FxQueryState(g_GraphicsState.blendFunc[1], GL_BLEND_DST_RGB);
+	last_blend_src_alpha = FxQueryState(g_GraphicsState.blendFunc[2], GL_BLEND_SRC_ALPHA);
+	last_blend_dst_alpha = FxQueryState(g_GraphicsState.blendFunc[3], GL_BLEND_DST_ALPHA);
+	last_blend_equation_rgb = FxQueryState(g_GraphicsState.blendEquation[0], GL_BLEND_EQUATION_RGB);
+	last_blend_equation_alpha = FxQueryState(g_GraphicsState.blendEquation[1], GL_BLEND_EQUATION_ALPHA);
+	FxQueryState(g_GraphicsState.viewport, GL_VIEWPORT, last_viewport);
+	FxQueryState(g_GraphicsState.scissor, GL_SCISSOR_BOX, last_scissor_box);
+	last_enable_blend = FxQueryCapability(GL_BLEND);
+	last_enable_cull_face = FxQueryCapability(GL_CULL_FACE);
+	last_enable_depth_test = FxQueryCapability(GL_DEPTH_TEST);
+	last_enable_scissor_test = FxQueryCapability(GL_SCISSOR_TEST);
 }
 
 FxSaveGraphicsState::~FxSaveGraphicsState() {
-	glUseProgram(last_program);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, last_texture);
-	glActiveTexture(last_active_texture);
-	glBindVertexArray(last_vertex_array);
-	glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, last_element_array_buffer);
-	glBlendEquationSeparate(last_blend_equation_rgb, last_blend_equation_alpha);
-	glBlendFuncSeparate(last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha);
+	// the state may have been changed behind the shadow copy, so every call is issued
+	FxInvalidateGraphicsState();
+	FxUseProgram(last_program);
+	FxBindTexture(0, GL_TEXTURE_2D, last_texture);
+	FxSetActiveTexture(last_active_texture - GL_TEXTURE0);
+	FxBindVertexArray(last_vertex_array);
+	FxBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
+	FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, last_element_array_buffer);
+	FxBlendEquationSeparate(last_blend_equation_rgb, last_blend_equation_alpha);
+	FxBlendFuncSeparate(last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha);
 	if (last_enable_blend)
-		glEnable(GL_BLEND);
+		FxEnable(GL_BLEND);
 	else
-		glDisable(GL_BLEND);
+		FxDisable(GL_BLEND);
 	if (last_enable_cull_face)
-		glEnable(GL_CULL_FACE);
+		FxEnable(GL_CULL_FACE);
 	else
-		glDisable(GL_CULL_FACE);
+		FxDisable(GL_CULL_FACE);
 	if (last_enable_depth_test)
-		glEnable(GL_DEPTH_TEST);
+		FxEnable(GL_DEPTH_TEST);
 	else
-		glDisable(GL_DEPTH_TEST);
+		FxDisable(GL_DEPTH_TEST);
 	if (last_enable_scissor_test)
-		glEnable(GL_SCISSOR_TEST);
+		FxEnable(GL_SCISSOR_TEST);
 	else
-		glDisable(GL_SCISSOR_TEST);
-	glViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
-	glScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
+		FxDisable(GL_SCISSOR_TEST);
+	FxViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
+	FxScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
 }
 
 void FxGlutTestLitSolidTeapotScene(double fovy, double aspect) {
-	glEnable(GL_DEPTH_TEST);
+	FxEnable(GL_DEPTH_TEST);
 	glEnable(GL_LIGHT0);
 	glEnable(GL_LIGHTING);
 	glMatrixMode(GL_PROJECTION);
@@ -523,7 +829,7 @@ void FxGlutTestLitSolidTeapotScene(double fovy, double aspect) {
 
 	glDisable(GL_LIGHT0);
 	glDisable(GL_LIGHTING);
-	glDisable(GL_DEPTH_TEST);
+	FxDisable(GL_DEPTH_TEST);
 }
 
 void FxGlutBitmapString(void* font, const char* str) {
@@ -1031,8 +1337,8 @@ void FxDrawGL1EnvironmentCube(GLfloat size, GLuint cubeMapTexId) {
 		0, 3, 2  //2,3,0
 	};
 
-	glEnable(GL_CULL_FACE);
-	glActiveTexture(GL_TEXTURE0);
+	FxEnable(GL_CULL_FACE);
+	FxSetActiveTexture(0);
 	glEnable(GL_TEXTURE_CUBE_MAP);
 	FxDebugBindTexture(GL_TEXTURE_CUBE_MAP, cubeMapTexId);
 	glVertexPointer(3, GL_FLOAT, 0, v);
@@ -1044,9 +1350,9 @@ void FxDrawGL1EnvironmentCube(GLfloat size, GLuint cubeMapTexId) {
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	glVertexPointer(4, GL_FLOAT, 0, 0);
 	glTexCoordPointer(4, GL_FLOAT, 0, 0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	FxBindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
 	glDisable(GL_TEXTURE_CUBE_MAP);
-	glDisable(GL_CULL_FACE);
+	FxDisable(GL_CULL_FACE);
 }
 
 // FxDrawGL2UnwrappedCubeMap
@@ -1223,8 +1529,8 @@ void FxDrawGL2UnwrappedCubeMap(GLuint x, GLuint y, GLuint size, GLint vloc, GLin
 		FxCreateBuffer(GL_ELEMENT_ARRAY_BUFFER, &eabo, sizeof(indices), indices, GL_STATIC_DRAW);
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, abo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+	FxBindBuffer(GL_ARRAY_BUFFER, abo);
+	FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
 	glVertexAttribPointer(vloc, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (const void*)0);
 	glVertexAttribPointer(tloc, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (const void*)12);
 	if (vloc >= 0)
@@ -1237,9 +1543,9 @@ void FxDrawGL2UnwrappedCubeMap(GLuint x, GLuint y, GLuint size, GLint vloc, GLin
 	if (tloc >= 0)
 		glDisableVertexAttribArray(tloc);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glUseProgram(0);
+	FxBindBuffer(GL_ARRAY_BUFFER, 0);
+	FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	FxUseProgram(0);
 }
 
 // FxDrawGL2CubeMap
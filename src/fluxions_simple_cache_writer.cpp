@@ -0,0 +1,116 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_file_path_info.hpp>
+#include <fluxions_simple_cache_writer.hpp>
+
+namespace Fluxions {
+	SimpleCacheWriter& SimpleCacheWriter::Get() {
+		static SimpleCacheWriter writer;
+		return writer;
+	}
+
+
+	SimpleCacheWriter::SimpleCacheWriter() {}
+
+
+	SimpleCacheWriter::~SimpleCacheWriter() {
+		shutdown();
+	}
+
+
+	bool SimpleCacheWriter::enqueue(std::shared_ptr<const SimpleGeometryMesh> mesh,
+									const std::string& cacheFilename,
+									const std::string& sourceFilename) {
+		if (!mesh)
+			return false;
+		Request request{ mesh, cacheFilename, sourceFilename };
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!stopped_ && !thread_.joinable())
+			thread_ = std::thread([this]() { run(); });
+
+		queueChanged_.wait(lock, [this]() { return stopped_ || queue_.size() < maxQueued_; });
+		if (stopped_) {
+			lock.unlock();
+			return write(request);
+		}
+		queue_.push_back(std::move(request));
+		queueChanged_.notify_all();
+		return true;
+	}
+
+
+	void SimpleCacheWriter::flush() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		queueChanged_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+	}
+
+
+	void SimpleCacheWriter::shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stopped_)
+				return;
+			stopped_ = true;
+		}
+		queueChanged_.notify_all();
+		if (thread_.joinable())
+			thread_.join();
+	}
+
+
+	void SimpleCacheWriter::setMaxQueued(size_t count) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		maxQueued_ = std::max<size_t>(count, 1);
+		queueChanged_.notify_all();
+	}
+
+
+	void SimpleCacheWriter::run() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (1) {
+			queueChanged_.wait(lock, [this]() { return stopped_ || !queue_.empty(); });
+			// the queue is drained before stopping so shutdown() also flushes
+			if (queue_.empty())
+				break;
+
+			Request request = std::move(queue_.front());
+			queue_.pop_front();
+			busy_ = true;
+			queueChanged_.notify_all();
+
+			lock.unlock();
+			write(request);
+			request.mesh.reset();
+			lock.lock();
+
+			busy_ = false;
+			queueChanged_.notify_all();
+		}
+	}
+
+
+	bool SimpleCacheWriter::write(const Request& request) {
+		const SimpleGeometryMesh& mesh = *request.mesh;
+		if (SimpleGeometryMesh::isCacheCurrent(request.cacheFilename, request.sourceFilename, mesh.optionsKey())) {
+			HFLOGINFO("'%s' ... cached OBJ '%s' is up to date", mesh.name_cstr(), request.cacheFilename.c_str());
+			return true;
+		}
+
+		std::string tempFilename = request.cacheFilename + ".tmp";
+		if (!mesh.saveCache(tempFilename)) {
+			remove(tempFilename.c_str());
+			HFLOGWARN("'%s' ... could not write cached OBJ '%s'", mesh.name_cstr(), request.cacheFilename.c_str());
+			return false;
+		}
+
+		// rename() does not replace an existing file on every platform
+		remove(request.cacheFilename.c_str());
+		if (rename(tempFilename.c_str(), request.cacheFilename.c_str()) != 0) {
+			remove(tempFilename.c_str());
+			HFLOGWARN("'%s' ... could not rename '%s'", mesh.name_cstr(), tempFilename.c_str());
+			return false;
+		}
+		HFLOGINFO("'%s' ... wrote cached OBJ '%s'", mesh.name_cstr(), request.cacheFilename.c_str());
+		return true;
+	}
+} // namespace Fluxions
@@ -0,0 +1,41 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_simple_command_list.hpp>
+
+namespace Fluxions {
+	void SimpleCommandList::drawElements(GLuint vao, GLenum mode, GLsizei count, GLsizeiptr offsetInBytes) {
+		Command command;
+		command.sortKey = sortKey_;
+		command.drawData = drawData_;
+		command.vao = vao;
+		command.mode = mode;
+		command.isIndexed = true;
+		command.count = count;
+		command.offset = offsetInBytes;
+		commands_.push_back(command);
+	}
+
+
+	void SimpleCommandList::drawArrays(GLuint vao, GLenum mode, GLint first, GLsizei count) {
+		Command command;
+		command.sortKey = sortKey_;
+		command.drawData = drawData_;
+		command.vao = vao;
+		command.mode = mode;
+		command.isIndexed = false;
+		command.count = count;
+		command.first = first;
+		commands_.push_back(command);
+	}
+
+
+	void SimpleCommandList::append(const SimpleCommandList& other) {
+		commands_.insert(commands_.end(), other.commands_.begin(), other.commands_.end());
+	}
+
+
+	void SimpleCommandList::sort() {
+		auto byKey = [](const Command& a, const Command& b) { return a.sortKey < b.sortKey; };
+		if (!std::is_sorted(commands_.begin(), commands_.end(), byKey))
+			std::stable_sort(commands_.begin(), commands_.end(), byKey);
+	}
+} // namespace Fluxions
@@ -0,0 +1,144 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_frustum_culler.hpp>
+
+namespace Fluxions {
+	void SimpleFrustumCuller::clear() {
+		centerX_.clear();
+		centerY_.clear();
+		centerZ_.clear();
+		extentX_.clear();
+		extentY_.clear();
+		extentZ_.clear();
+		visibility_.clear();
+		culledCount_ = 0;
+	}
+
+
+	void SimpleFrustumCuller::reserve(size_t count) {
+		centerX_.reserve(count);
+		centerY_.reserve(count);
+		centerZ_.reserve(count);
+		extentX_.reserve(count);
+		extentY_.reserve(count);
+		extentZ_.reserve(count);
+	}
+
+
+	unsigned SimpleFrustumCuller::add(const BoundingBoxf& box) {
+		if (box.minBounds.x > box.maxBounds.x ||
+			box.minBounds.y > box.maxBounds.y ||
+			box.minBounds.z > box.maxBounds.z)
+			return addAlwaysVisible();
+		centerX_.push_back(0.5f * (box.minBounds.x + box.maxBounds.x));
+		centerY_.push_back(0.5f * (box.minBounds.y + box.maxBounds.y));
+		centerZ_.push_back(0.5f * (box.minBounds.z + box.maxBounds.z));
+		extentX_.push_back(0.5f * (box.maxBounds.x - box.minBounds.x));
+		extentY_.push_back(0.5f * (box.maxBounds.y - box.minBounds.y));
+		extentZ_.push_back(0.5f * (box.maxBounds.z - box.minBounds.z));
+		return (unsigned)size() - 1;
+	}
+
+
+	unsigned SimpleFrustumCuller::addAlwaysVisible() {
+		// an infinite box is never behind a plane, so no lane needs a special case
+		constexpr float huge = std::numeric_limits<float>::max();
+		centerX_.push_back(0.0f);
+		centerY_.push_back(0.0f);
+		centerZ_.push_back(0.0f);
+		extentX_.push_back(huge);
+		extentY_.push_back(huge);
+		extentZ_.push_back(huge);
+		return (unsigned)size() - 1;
+	}
+
+
+	void SimpleFrustumCuller::setViewProjection(const Matrix4f& m) {
+		// each plane is the fourth row plus or minus one of the others
+		const float rows[4][4] = {
+			{ m.m11, m.m12, m.m13, m.m14 },
+			{ m.m21, m.m22, m.m23, m.m24 },
+			{ m.m31, m.m32, m.m33, m.m34 },
+			{ m.m41, m.m42, m.m43, m.m44 }
+		};
+		for (unsigned i = 0; i < 6; i++) {
+			const float sign = (i & 1) ? -1.0f : 1.0f;
+			const float* row = rows[i / 2];
+			for (unsigned k = 0; k < 4; k++) {
+				planes_[i][k] = rows[3][k] + sign * row[k];
+			}
+			float length = sqrtf(planes_[i][0] * planes_[i][0] + planes_[i][1] * planes_[i][1] + planes_[i][2] * planes_[i][2]);
+			if (length > 0.0f) {
+				for (unsigned k = 0; k < 4; k++) {
+					planes_[i][k] /= length;
+				}
+			}
+		}
+	}
+
+
+	void SimpleFrustumCuller::cull(unsigned threadCount) {
+		// threads write whole words of the bitset, so a range is a multiple of 64 boxes
+		const size_t count = size();
+		const size_t wordCount = (count + 63) / 64;
+		visibility_.assign(wordCount, 0);
+		ParallelFor(wordCount, 64, [&](size_t firstWord, size_t lastWord) {
+			for (size_t w = firstWord; w < lastWord; w++) {
+				visibility_[w] = cullWord(w * 64, std::min(count, w * 64 + 64));
+			}
+		}, threadCount);
+		culledCount_ = count;
+	}
+
+
+	uint64_t SimpleFrustumCuller::cullWord(size_t first, size_t last) const {
+		uint64_t bits = 0;
+		for (size_t i = first; i < last; i += BlockSize) {
+			const size_t n = std::min<size_t>(BlockSize, last - i);
+
+			// a box is outside if its nearest corner is behind any plane
+			float cx[BlockSize], cy[BlockSize], cz[BlockSize];
+			float ex[BlockSize], ey[BlockSize], ez[BlockSize];
+			int inside[BlockSize];
+			for (unsigned j = 0; j < BlockSize; j++) {
+				const size_t k = i + std::min<size_t>(j, n - 1);
+				cx[j] = centerX_[k];
+				cy[j] = centerY_[k];
+				cz[j] = centerZ_[k];
+				ex[j] = extentX_[k];
+				ey[j] = extentY_[k];
+				ez[j] = extentZ_[k];
+				inside[j] = 1;
+			}
+			for (unsigned p = 0; p < 6; p++) {
+				const float a = planes_[p][0];
+				const float b = planes_[p][1];
+				const float c = planes_[p][2];
+				const float d = planes_[p][3];
+				const float absA = fabsf(a);
+				const float absB = fabsf(b);
+				const float absC = fabsf(c);
+				for (unsigned j = 0; j < BlockSize; j++) {
+					float distance = a * cx[j] + b * cy[j] + c * cz[j] + d;
+					float radius = absA * ex[j] + absB * ey[j] + absC * ez[j];
+					inside[j] &= (distance + radius >= 0.0f) ? 1 : 0;
+				}
+			}
+			for (size_t j = 0; j < n; j++) {
+				bits |= (uint64_t)inside[j] << ((i - first) + j);
+			}
+		}
+		return bits;
+	}
+
+
+	size_t SimpleFrustumCuller::visibleCount() const {
+		size_t count = size() - culledCount_;
+		for (uint64_t word : visibility_) {
+			for (; word; word &= word - 1) {
+				count++;
+			}
+		}
+		return count;
+	}
+} // namespace Fluxions
@@ -1,6 +1,9 @@
 #include "fluxions_base_pch.hpp"
 #include <fluxions_base.hpp>
 #include <fluxions_file_system.hpp>
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_cache_writer.hpp>
+#include <fluxions_simple_geometry_pager.hpp>
 #include <fluxions_simple_geometry_mesh.hpp>
 
 
@@ -18,17 +21,85 @@ namespace Fluxions {
 	}
 
 	void SimpleGeometryMesh::unload() {
+		pager_.reset();
 		SimpleLoadableResource::unload();
 	}
 
 	void SimpleGeometryMesh::cacheToDisk() {
+		if (cached())
+			return;
+		if (cacheFilename_.empty()) {
+			if (path().empty()) {
+				HFLOGWARN("'%s' ... cannot be cached without a path", name_cstr());
+				return;
+			}
+			cacheFilename_ = path() + ".cache";
+		}
+
+		// the pager reads each surface through its vertex range
+		ensureBounds();
+
+		// a background write of this cache may still be in progress
+		SimpleCacheWriter::Get().flush();
+		if (dirty || !isCacheCurrent(cacheFilename_, path(), optionsKey_)) {
+			if (!saveCache(cacheFilename_)) {
+				HFLOGWARN("'%s' ... could not write '%s'", name_cstr(), cacheFilename_.c_str());
+				return;
+			}
+			dirty = false;
+		}
+
+		auto pager = std::make_shared<SimpleGeometryPager>();
+		pager->setBudget(pageBudget_);
+		if (!pager->open(cacheFilename_, Surfaces))
+			return;
+		pager_ = pager;
+
+		// swap with empty vectors so the memory is actually released
+		Vertices = std::vector<Vertex>();
+		Indices = std::vector<unsigned>();
 		SimpleLoadableResource::cacheToDisk();
 	}
 
 	void SimpleGeometryMesh::fetchCache() {
+		if (!cached() || !pager_)
+			return;
+		if (!pager_->readAll(Vertices.mut(), Indices.mut())) {
+			HFLOGWARN("'%s' ... could not read '%s'", name_cstr(), cacheFilename_.c_str());
+			return;
+		}
+		pager_.reset();
 		SimpleLoadableResource::fetchCache();
 	}
 
+	std::shared_ptr<const SimpleGeometryMesh::SurfacePage> SimpleGeometryMesh::pageSurface(unsigned surface) {
+		if (surface >= Surfaces.size())
+			return nullptr;
+		if (pager_)
+			return pager_->fetch(surface);
+
+		// resident meshes copy the ranges so callers see the same layout either way
+		ensureBounds();
+		const Surface& s = Surfaces.vec()[surface];
+		const auto& vertices = Vertices.vec();
+		const auto& indices = Indices.vec();
+		auto page = std::make_shared<SurfacePage>();
+		size_t lastVertex = std::min<size_t>((size_t)s.baseVertex + s.vertexCount, vertices.size());
+		size_t lastIndex = std::min<size_t>((size_t)s.first + s.count, indices.size());
+		if (s.baseVertex < lastVertex)
+			page->vertices.assign(vertices.begin() + s.baseVertex, vertices.begin() + lastVertex);
+		for (size_t i = s.first; i < lastIndex; i++) {
+			page->indices.push_back(indices[i] - s.baseVertex);
+		}
+		return page;
+	}
+
+	void SimpleGeometryMesh::setPageBudget(size_t bytes) {
+		pageBudget_ = bytes;
+		if (pager_)
+			pager_->setBudget(bytes);
+	}
+
 	size_t SimpleGeometryMesh::sizeInBytes() const {
 		size_t surfaceSize{ 0 };
 		for (auto& s : Surfaces) {
@@ -42,6 +113,20 @@ namespace Fluxions {
 	}
 
 	bool SimpleGeometryMesh::loadOBJ(const std::string& filename) {
+		return loadOBJ(filename, LoadOptions());
+	}
+
+	bool SimpleGeometryMesh::loadOBJ(const std::string& filename, const LoadOptions& options) {
+		using CachePolicy = LoadOptions::CachePolicy;
+		using Sanitize = LoadOptions::Sanitize;
+		using Verbosity = LoadOptions::Verbosity;
+		const bool logSummary = options.verbosity >= Verbosity::Summary;
+		const bool logSurfaces = options.verbosity >= Verbosity::Surfaces;
+		verbosity_ = options.verbosity;
+		const bool readCache = options.cachePolicy == CachePolicy::ReadWrite || options.cachePolicy == CachePolicy::ReadOnly;
+		const bool writeCache = options.cachePolicy == CachePolicy::ReadWrite || options.cachePolicy == CachePolicy::WriteOnly;
+		const bool trackBounds = options.computeBounds || options.recenter || options.scaleToSize > 0.0f;
+
 		std::string cache_filename = filename + ".cache";
 		FilePathInfo fpi_original(filename);
 		FilePathInfo fpi_cache(cache_filename);
@@ -49,16 +134,22 @@ namespace Fluxions {
 		// Save name and path for possible reload later
 		setName(fpi_original.filename());
 		setPath(fpi_original.shortestPath());
+		optionsKey_ = options.key();
 
-		if (fpi_cache.exists()) {
+		if (readCache && fpi_cache.exists()) {
 			// Is the original file newer than the cache?
 			if (fpi_original.lastWriteTime() <= fpi_cache.lastWriteTime()) {
-				HFLOGINFO("'%s' ... reading cached OBJ '%s'", name_cstr(), cache_filename.c_str());
-				return loadCache(cache_filename);
+				if (logSummary) HFLOGINFO("'%s' ... reading cached OBJ '%s'", name_cstr(), cache_filename.c_str());
+				if (loadCache(cache_filename, optionsKey_)) {
+					cacheFilename_ = cache_filename;
+					dirty = false;
+					return true;
+				}
+				HFLOGWARN("'%s' ... cached OBJ '%s' is invalid or out of date", name_cstr(), cache_filename.c_str());
 			}
 		}
 
-		HFLOGINFO("'%s' ... loading", name_cstr());
+		if (logSummary) HFLOGINFO("'%s' ... loading", name_cstr());
 		int curSurface = 0;
 		std::string surfaceName;
 		std::string objectName;
@@ -76,9 +167,8 @@ namespace Fluxions {
 		int first = 0;
 		// int count = 0;
 		int firstVertex = 0;
-		double size = 1.0;
 
-		bool optimizeIndexing = false;
+		bool optimizeIndexing = options.optimizeIndexing;
 
 		BoundingBox.reset();
 
@@ -101,7 +191,7 @@ namespace Fluxions {
 				if (Surfaces.size() != 0) {
 					Surfaces[curSurface].count = (int)faceList.size() * 3;
 
-					HFLOGINFO("'%s' ... adding %d new faces starting at %d to '%s'", name_cstr(), faceList.size(), first, Surfaces[curSurface].name_cstr());
+					if (logSurfaces) HFLOGINFO("'%s' ... adding %d new faces starting at %d to '%s'", name_cstr(), faceList.size(), first, Surfaces[curSurface].name_cstr());
 
 					// 2. add indices (triangles)
 					for (auto it = faceList.begin(); it != faceList.end(); it++) {
@@ -121,13 +211,13 @@ namespace Fluxions {
 				linecount = 0;
 				istr >> objectName;
 				toloweridentifier(objectName);
-				HFLOGINFO("'%s' ... adding new object %s", name_cstr(), objectName.c_str());
+				if (logSurfaces) HFLOGINFO("'%s' ... adding new object %s", name_cstr(), objectName.c_str());
 			}
 			else if (str == "g") {
 				linecount = 0;
 				istr >> surfaceName;
 				toloweridentifier(surfaceName);
-				HFLOGINFO("'%s' ... changing surface name to %s", name_cstr(), surfaceName.c_str());
+				if (logSurfaces) HFLOGINFO("'%s' ... changing surface name to %s", name_cstr(), surfaceName.c_str());
 				Surfaces[curSurface].surfaceName = surfaceName;
 			}
 			else if (str == "usemtl") {
@@ -137,7 +227,7 @@ namespace Fluxions {
 				if (Surfaces.size() != 0 && !faceList.empty()) {
 					Surfaces[curSurface].count = (int)faceList.size() * 3;
 
-					HFLOGINFO("'%s' ... adding %d new faces starting at %d to %s", name_cstr(), faceList.size(), first, Surfaces[curSurface].surfaceName.c_str());
+					if (logSurfaces) HFLOGINFO("'%s' ... adding %d new faces starting at %d to %s", name_cstr(), faceList.size(), first, Surfaces[curSurface].surfaceName.c_str());
 
 					// 2. add indices (triangles)
 					for (auto it = faceList.begin(); it != faceList.end(); it++) {
@@ -164,11 +254,11 @@ namespace Fluxions {
 				Surfaces[curSurface].materialLibrary = materialLibrary;
 				Surfaces[curSurface].materialName = str;
 				Materials[str] = materialLibrary;
-				HFLOGINFO("'%s' ... using material '%s' from '%s'", name_cstr(), str.c_str(), materialLibrary.c_str());
+				if (logSurfaces) HFLOGINFO("'%s' ... using material '%s' from '%s'", name_cstr(), str.c_str(), materialLibrary.c_str());
 			}
 			else if (str == "mtllib") {
 				if (add_mtllib(istr, materialLibrary, fpi_original.parentPath())) {
-					HFLOGINFO("'%s' ... adding mtllib '%s' to load list", name_cstr(), materialLibrary.c_str());
+					if (logSurfaces) HFLOGINFO("'%s' ... adding mtllib '%s' to load list", name_cstr(), materialLibrary.c_str());
 				}
 				else {
 					HFLOGWARN("'%s' ... mtllib '%s' was not found", name_cstr(), materialLibrary.c_str());
@@ -235,7 +325,8 @@ namespace Fluxions {
 						if (i2 >= 0)
 							vtx.texcoord = vtList[(size_t)i2 - 1];
 						vertexMap[iv[k]] = vtx;
-						BoundingBox += vtx.position;
+						if (trackBounds)
+							BoundingBox += vtx.position;
 						// END NOT TRYING TO INDEX THESE THINGS
 					}
 					else {
@@ -259,7 +350,8 @@ namespace Fluxions {
 							if (i2 >= 0)
 								vtx.texcoord = vtList[(size_t)i2 - 1];
 							vertexMap[iv[k]] = vtx;
-							BoundingBox += vtx.position;
+							if (trackBounds)
+								BoundingBox += vtx.position;
 						}
 					}
 				}
@@ -275,43 +367,83 @@ namespace Fluxions {
 		}
 		fin.close();
 
+		// optionally move the center to the origin and scale into a box of scaleToSize
+		Vector3f center = options.recenter ? BoundingBox.center() : Vector3f(0, 0, 0);
 		float scale = 1;
-		if (size < 0)
-			scale = (float)(-2 * size / BoundingBox.maxSize());
+		if (options.scaleToSize > 0.0f && BoundingBox.maxSize() > 0.0f)
+			scale = options.scaleToSize / BoundingBox.maxSize();
+		const bool transformPositions = options.recenter || scale != 1.0f;
 
-		HFLOGINFO("'%s' ... scale is %f", name_cstr(), scale);
+		if (logSummary) HFLOGINFO("'%s' ... scale is %f", name_cstr(), scale);
+		Vertices.reserve(vertexMap.size());
 		for (auto it = vertexMap.begin(); it != vertexMap.end(); it++) {
-			if (size < 0)
-				it->second.position -= BoundingBox.center();
+			if (transformPositions) {
+				it->second.position -= center;
+				it->second.position *= scale;
+			}
+
+			// normals in the file may not be unit length
+			if (it->second.normal.length() > 0.0f)
+				it->second.normal.normalize();
 
 #define MAKE_FINITE(x)  \
 	if (!isfinite((x))) \
 		(x) = 0.0;
-			//it->second.position *= scale;
-
-			MAKE_FINITE(it->second.position.x);
-			MAKE_FINITE(it->second.position.y);
-			MAKE_FINITE(it->second.position.z);
-			MAKE_FINITE(it->second.normal.x);
-			MAKE_FINITE(it->second.normal.y);
-			MAKE_FINITE(it->second.normal.z);
-			MAKE_FINITE(it->second.texcoord.x);
-			MAKE_FINITE(it->second.texcoord.y);
-			MAKE_FINITE(it->second.binormal.x);
-			MAKE_FINITE(it->second.binormal.y);
-			MAKE_FINITE(it->second.binormal.z);
-			MAKE_FINITE(it->second.tangent.x);
-			MAKE_FINITE(it->second.tangent.y);
-			MAKE_FINITE(it->second.tangent.z);
+
+			if (options.sanitize != Sanitize::None) {
+				MAKE_FINITE(it->second.position.x);
+				MAKE_FINITE(it->second.position.y);
+				MAKE_FINITE(it->second.position.z);
+			}
+			if (options.sanitize == Sanitize::All) {
+				MAKE_FINITE(it->second.normal.x);
+				MAKE_FINITE(it->second.normal.y);
+				MAKE_FINITE(it->second.normal.z);
+				MAKE_FINITE(it->second.texcoord.x);
+				MAKE_FINITE(it->second.texcoord.y);
+				MAKE_FINITE(it->second.binormal.x);
+				MAKE_FINITE(it->second.binormal.y);
+				MAKE_FINITE(it->second.binormal.z);
+				MAKE_FINITE(it->second.tangent.x);
+				MAKE_FINITE(it->second.tangent.y);
+				MAKE_FINITE(it->second.tangent.z);
+			}
 
 			Vertices.push_back(it->second);
 		}
-		HFLOGINFO("'%s' ... max uniform scale is %f", name_cstr(), BoundingBox.maxSize());
 
-		computeTangentVectors();
-
-		HFLOGINFO("'%s' ... writing cached OBJ '%s'", name_cstr(), cache_filename.c_str());
-		return saveCache(cache_filename);
+		// the bounds were only tracked to transform the positions if computeBounds is false
+		if (transformPositions || !options.computeBounds)
+			BoundingBox.reset();
+		if (transformPositions && options.computeBounds) {
+			for (const auto& vertex : Vertices.vec()) {
+				BoundingBox += vertex.position;
+			}
+		}
+		if (logSummary) HFLOGINFO("'%s' ... max uniform scale is %f", name_cstr(), BoundingBox.maxSize());
+
+		// normals read from the file stay valid, the rest is computed on first use
+		validAttributes_ = vnList.empty() ? 0u : (unsigned)NormalsAttribute;
+		if (options.computeTangents)
+			ensureTangents();
+		if (options.trianglesPerChunk > 0)
+			chunkSurfaces(options.trianglesPerChunk);
+		else if (options.computeBounds)
+			computeSurfaceBounds();
+		if (options.computeBounds)
+			validAttributes_ |= BoundsAttribute;
+
+		if (!writeCache)
+			return true;
+		cacheFilename_ = cache_filename;
+		dirty = false;
+		if (options.writeCacheInBackground) {
+			if (logSummary) HFLOGINFO("'%s' ... queueing cached OBJ '%s'", name_cstr(), cache_filename.c_str());
+			return SimpleCacheWriter::Get().enqueue(std::make_shared<SimpleGeometryMesh>(*this), cache_filename, filename);
+		}
+		if (logSummary) HFLOGINFO("'%s' ... writing cached OBJ '%s'", name_cstr(), cache_filename.c_str());
+		dirty = !saveCache(cache_filename);
+		return !dirty;
 	}
 
 
@@ -470,6 +602,12 @@ namespace Fluxions {
 
 
 	bool SimpleGeometryMesh::saveCache(const std::string& filename) const {
+		std::ofstream fout(filename, std::ios::binary);
+		return saveCache(fout);
+	}
+
+
+	bool SimpleGeometryMesh::saveCache(std::ostream& fout) const {
 		unsigned vertexCount = (unsigned)Vertices.size();
 		unsigned indexCount = (unsigned)Indices.size();
 		unsigned surfaceCount = (unsigned)Surfaces.size();
@@ -479,16 +617,18 @@ namespace Fluxions {
 			return false;
 		}
 
-		// save a cache
-		std::ofstream fout(filename, std::ios::binary);
+		WriteBinaryElement(fout, CacheMagic);
+		WriteBinaryElement(fout, CacheVersion);
+		WriteBinaryElement(fout, optionsKey_);
+		WriteBinaryElement(fout, validAttributes_);
 		WriteBinaryElement(fout, vertexCount);
 		WriteBinaryElement(fout, indexCount);
 		WriteBinaryElement(fout, surfaceCount);
 
 		WriteBinaryStringMap(fout, mtllibs);
 
-		WriteBinaryElement(fout, Vertices);
-		WriteBinaryElement(fout, Indices);
+		WriteBinaryElement(fout, Vertices.vec());
+		WriteBinaryElement(fout, Indices.vec());
 
 		for (unsigned i = 0; i < surfaceCount; i++) {
 			unsigned mode = (unsigned)Surfaces[i].mode;
@@ -501,21 +641,68 @@ namespace Fluxions {
 			WriteBinaryString(fout, Surfaces[i].materialName);
 			WriteBinaryString(fout, Surfaces[i].materialLibrary);
 			WriteBinaryString(fout, Surfaces[i].surfaceName);
+			WriteBinaryElement(fout, Surfaces[i].boundingBox);
+			WriteBinaryElement(fout, Surfaces[i].sphereCenter);
+			WriteBinaryElement(fout, Surfaces[i].sphereRadius);
+			WriteBinaryElement(fout, Surfaces[i].hash);
+			WriteBinaryElement(fout, Surfaces[i].instanceOf);
+			WriteBinaryElement(fout, Surfaces[i].instanceOffset);
+			WriteBinaryElement(fout, Surfaces[i].baseVertex);
+			WriteBinaryElement(fout, Surfaces[i].vertexCount);
 		}
 
-		fout.close();
-		return true;
+		return (bool)fout;
 	}
 
 
-	bool SimpleGeometryMesh::loadCache(const std::string& filename) {
+	bool SimpleGeometryMesh::isCacheCurrent(const std::string& cacheFilename, const std::string& sourceFilename, unsigned optionsKey) {
+		FilePathInfo fpi_cache(cacheFilename);
+		FilePathInfo fpi_source(sourceFilename);
+		if (!fpi_cache.exists() || fpi_source.lastWriteTime() > fpi_cache.lastWriteTime())
+			return false;
+
+		std::ifstream fin(cacheFilename, std::ios::binary);
+		unsigned magic = 0;
+		unsigned version = 0;
+		unsigned cacheOptionsKey = 0;
+		ReadBinaryElement(fin, magic);
+		ReadBinaryElement(fin, version);
+		ReadBinaryElement(fin, cacheOptionsKey);
+		return fin && magic == CacheMagic && version == CacheVersion && cacheOptionsKey == optionsKey;
+	}
+
+
+	bool SimpleGeometryMesh::loadCache(const std::string& filename, unsigned optionsKey) {
 		std::ifstream fin(filename, std::ios::binary);
 		if (!fin)
 			return false;
+		return loadCache(fin, optionsKey);
+	}
+
+
+	bool SimpleGeometryMesh::loadCache(std::istream& fin, unsigned optionsKey) {
+		unsigned magic = 0;
+		unsigned version = 0;
+		unsigned cacheOptionsKey = 0;
 		unsigned vertexCount = 0;
 		unsigned indexCount = 0;
 		unsigned surfaceCount = 0;
 
+		ReadBinaryElement(fin, magic);
+		ReadBinaryElement(fin, version);
+		if (magic != CacheMagic || version != CacheVersion) {
+			HFLOGWARN("Cache has an unknown format or version");
+			return false;
+		}
+
+		ReadBinaryElement(fin, cacheOptionsKey);
+		if (optionsKey && optionsKey != cacheOptionsKey) {
+			HFLOGWARN("Cache was written with different load options");
+			return false;
+		}
+		optionsKey_ = cacheOptionsKey;
+
+		ReadBinaryElement(fin, validAttributes_);
 		ReadBinaryElement(fin, vertexCount);
 		ReadBinaryElement(fin, indexCount);
 		ReadBinaryElement(fin, surfaceCount);
@@ -533,8 +720,8 @@ namespace Fluxions {
 		Surfaces.resize(surfaceCount);
 		BoundingBox.reset();
 
-		ReadBinaryElement(fin, Vertices, vertexCount);
-		ReadBinaryElement(fin, Indices, indexCount);
+		ReadBinaryElement(fin, Vertices.mut(), vertexCount);
+		ReadBinaryElement(fin, Indices.mut(), indexCount);
 
 		for (unsigned i = 0; i < surfaceCount; i++) {
 			unsigned mode = 0;
@@ -550,6 +737,14 @@ namespace Fluxions {
 			ReadBinaryString(fin, mtlName);
 			ReadBinaryString(fin, mtllibName);
 			ReadBinaryString(fin, surfaceName);
+			ReadBinaryElement(fin, Surfaces[i].boundingBox);
+			ReadBinaryElement(fin, Surfaces[i].sphereCenter);
+			ReadBinaryElement(fin, Surfaces[i].sphereRadius);
+			ReadBinaryElement(fin, Surfaces[i].hash);
+			ReadBinaryElement(fin, Surfaces[i].instanceOf);
+			ReadBinaryElement(fin, Surfaces[i].instanceOffset);
+			ReadBinaryElement(fin, Surfaces[i].baseVertex);
+			ReadBinaryElement(fin, Surfaces[i].vertexCount);
 
 			Surfaces[i].mode = (SimpleGeometryMesh::SurfaceType)mode;
 			Surfaces[i].first = first;
@@ -559,17 +754,27 @@ namespace Fluxions {
 			Surfaces[i].surfaceName = surfaceName;
 		}
 
-		for (auto& v : Vertices) {
+		for (const auto& v : Vertices.vec()) {
 			BoundingBox += v.position;
 		}
 
 		Materials.clear();
 		for (auto& surface : Surfaces) {
-			Materials[surface.materialName] = surface.materialLibrary;
+			Materials[surface.materialName.str()] = surface.materialLibrary.str();
 		}
 
-		fin.close();
-		return true;
+		// the data matches the cache, so only the revision changes
+		topologyRevision_ = NewTopologyRevision();
+		topologyPending_ = false;
+		return (bool)fin;
+	}
+
+
+	unsigned SimpleGeometryMesh::NewTopologyRevision() {
+		static std::atomic<unsigned> nextRevision{ PendingTopologyRevision + 1 };
+		unsigned revision = nextRevision++;
+		// skip the sentinel when the counter wraps
+		return revision != PendingTopologyRevision ? revision : nextRevision++;
 	}
 
 
@@ -586,6 +791,8 @@ namespace Fluxions {
 			Indices.resize(indexCount);
 		if (surfaceCount > 0)
 			Surfaces.resize(surfaceCount);
+		validAttributes_ = 0;
+		topologyChanged();
 	}
 
 
@@ -595,11 +802,12 @@ namespace Fluxions {
 			Vertices[i].binormal = Vector3f(0, 0, 0);
 		}
 
-		for (size_t i = 0; i < Indices.size(); i += 3) {
+		const std::vector<unsigned>& meshIndices = Indices.vec();
+		for (size_t i = 0; i < meshIndices.size(); i += 3) {
 			int indices[3];
-			indices[0] = Indices[i];
-			indices[1] = Indices[i + 1];
-			indices[2] = Indices[i + 2];
+			indices[0] = meshIndices[i];
+			indices[1] = meshIndices[i + 1];
+			indices[2] = meshIndices[i + 2];
 			Vector3f v1, v2;
 			v1 = Vertices[indices[1]].position - Vertices[indices[0]].position;
 			v2 = Vertices[indices[2]].position - Vertices[indices[0]].position;
@@ -664,6 +872,805 @@ namespace Fluxions {
 			//Vertices[i].tangent.w = (DotProduct(CrossProduct(n, t), b) < 0.0f) ? -1.0f : 1.0f;
 			//Vertices[i].binormal = bprime;
 		}
+		validAttributes_ |= TangentsAttribute;
+	}
+
+
+	void SimpleGeometryMesh::computeBounds(Surface& surface) const {
+		surface.boundingBox.reset();
+		surface.sphereCenter = Vector3f(0, 0, 0);
+		surface.sphereRadius = 0.0f;
+		surface.baseVertex = 0;
+		surface.vertexCount = 0;
+
+		size_t first = std::min<size_t>(surface.first, Indices.size());
+		size_t last = std::min<size_t>((size_t)surface.first + surface.count, Indices.size());
+		if (first >= last)
+			return;
+
+		// shared surfaces are placed at instanceOffset (which is zero otherwise)
+		unsigned minIndex = Indices[first];
+		unsigned maxIndex = Indices[first];
+		for (size_t i = first; i < last; i++) {
+			surface.boundingBox += Vertices[Indices[i]].position + surface.instanceOffset;
+			minIndex = std::min(minIndex, Indices[i]);
+			maxIndex = std::max(maxIndex, Indices[i]);
+		}
+		surface.baseVertex = minIndex;
+		surface.vertexCount = maxIndex - minIndex + 1;
+
+		Vector3f center = surface.boundingBox.center();
+		float radiusSquared = 0.0f;
+		for (size_t i = first; i < last; i++) {
+			Vector3f d = Vertices[Indices[i]].position + surface.instanceOffset - center;
+			radiusSquared = std::max(radiusSquared, d.x * d.x + d.y * d.y + d.z * d.z);
+		}
+		surface.sphereCenter = center;
+		surface.sphereRadius = sqrtf(radiusSquared);
+	}
+
+
+	void SimpleGeometryMesh::computeSurfaceBounds() {
+		// Each surface is independent, so surfaces are split across threads. Surfaces is
+		// made writable once here so the threads only read Vertices and Indices.
+		Surface* surfaces = Surfaces.data();
+		ParallelFor(Surfaces.size(), 1, [this, surfaces](size_t firstSurface, size_t lastSurface) {
+			for (size_t s = firstSurface; s < lastSurface; s++) {
+				computeBounds(surfaces[s]);
+			}
+		});
+	}
+
+
+	void SimpleGeometryMesh::computeNormals() {
+		const auto& vertices = Vertices.vec();
+		const auto& indices = Indices.vec();
+		std::vector<Vector3f> normals(vertices.size(), Vector3f(0, 0, 0));
+		for (const auto& surface : Surfaces) {
+			if (surface.mode != SurfaceType::Triangles)
+				continue;
+			unsigned last = surface.first + surface.count - surface.count % 3;
+			for (unsigned i = surface.first; i < last; i += 3) {
+				unsigned i0 = indices[i];
+				unsigned i1 = indices[i + 1];
+				unsigned i2 = indices[i + 2];
+				// the length of the cross product weights the face by its area
+				Vector3f faceNormal = CrossProduct(vertices[i1].position - vertices[i0].position,
+												   vertices[i2].position - vertices[i0].position);
+				normals[i0] += faceNormal;
+				normals[i1] += faceNormal;
+				normals[i2] += faceNormal;
+			}
+		}
+
+		Vertex* v = Vertices.data();
+		for (size_t i = 0; i < normals.size(); i++) {
+			Vector3f& n = normals[i];
+			if (n.x * n.x + n.y * n.y + n.z * n.z > 0.0f) {
+				n.normalize();
+				v[i].normal = n;
+			}
+		}
+		validAttributes_ |= NormalsAttribute | GeneratedNormalsFlag;
+	}
+
+
+	void SimpleGeometryMesh::ensureNormals() {
+		if (!hasAttributes(NormalsAttribute))
+			computeNormals();
+	}
+
+
+	void SimpleGeometryMesh::ensureTangents() {
+		if (hasAttributes(TangentsAttribute))
+			return;
+		ensureNormals();
+		computeTangentVectors();
+	}
+
+
+	void SimpleGeometryMesh::ensureBounds() {
+		if (hasAttributes(BoundsAttribute))
+			return;
+		BoundingBox.reset();
+		for (const auto& vertex : Vertices.vec()) {
+			BoundingBox += vertex.position;
+		}
+		computeSurfaceBounds();
+		validAttributes_ |= BoundsAttribute;
+	}
+
+
+	void SimpleGeometryMesh::reserve(size_t vertexCount, size_t indexCount, size_t surfaceCount) {
+		Vertices.reserve(Vertices.size() + vertexCount);
+		Indices.reserve(Indices.size() + indexCount);
+		Surfaces.reserve(Surfaces.size() + surfaceCount);
+	}
+
+
+	unsigned SimpleGeometryMesh::addVertices(const float* positions, const float* normals, const float* texcoords, size_t count) {
+		size_t first = Vertices.size();
+		if (count == 0)
+			return (unsigned)first;
+
+		// one allocation, then each attribute array is copied in its own pass
+		Vertices.resize(first + count, curVertexAttrib_);
+		Vertex* v = Vertices.data() + first;
+		if (positions) {
+			for (size_t i = 0; i < count; i++) {
+				const float* p = positions + i * 3;
+				v[i].position.reset(p[0], p[1], p[2]);
+			}
+		}
+		if (normals) {
+			for (size_t i = 0; i < count; i++) {
+				const float* n = normals + i * 3;
+				v[i].normal.reset(n[0], n[1], n[2]);
+			}
+		}
+		if (texcoords) {
+			for (size_t i = 0; i < count; i++) {
+				const float* t = texcoords + i * 2;
+				v[i].texcoord.reset(t[0], t[1]);
+			}
+		}
+		positionsChanged();
+		return (unsigned)first;
+	}
+
+
+	bool SimpleGeometryMesh::addIndices(const unsigned* indices, size_t count, unsigned baseVertex) {
+		if (!indices || count == 0)
+			return count == 0;
+
+		// validate the whole span once instead of checking each index
+		unsigned maxIndex = 0;
+		for (size_t i = 0; i < count; i++) {
+			maxIndex = std::max(maxIndex, indices[i]);
+		}
+		if ((size_t)maxIndex + baseVertex >= Vertices.size()) {
+			HFLOGWARN("'%s' ... index %u is outside of %d vertices", name_cstr(), maxIndex + baseVertex, getVertexCount());
+			return false;
+		}
+
+		size_t first = Indices.size();
+		Indices.resize(first + count);
+		unsigned* dst = Indices.data() + first;
+		if (baseVertex == 0) {
+			memcpy(dst, indices, count * sizeof(unsigned));
+		}
+		else {
+			for (size_t i = 0; i < count; i++) {
+				dst[i] = indices[i] + baseVertex;
+			}
+		}
+		if (!Surfaces.empty())
+			Surfaces.back().count += (unsigned)count;
+		positionsChanged();
+		topologyChanged();
+		return true;
+	}
+
+
+	int SimpleGeometryMesh::commitSurface() {
+		if (Surfaces.empty())
+			return -1;
+		if (topologyPending_)
+			topologyChanged();
+		if (Surfaces.back().count == 0) {
+			Surfaces.pop_back();
+			return -1;
+		}
+		computeBounds(Surfaces.back());
+		return (int)Surfaces.size() - 1;
+	}
+
+
+	static inline uint64_t HashWords(const std::vector<uint32_t>& words) {
+		// FNV-1a over 32-bit words followed by a final avalanche
+		uint64_t h = 14695981039346656037ULL;
+		for (uint32_t w : words) {
+			h ^= w;
+			h *= 1099511628211ULL;
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+
+	unsigned SimpleGeometryMesh::LoadOptions::key() const {
+		// only the options that change the loaded data are part of the key
+		std::vector<uint32_t> words;
+		words.push_back(computeTangents);
+		words.push_back(computeBounds);
+		words.push_back(optimizeIndexing);
+		words.push_back((uint32_t)sanitize);
+		words.push_back(recenter);
+		uint32_t scaleBits;
+		memcpy(&scaleBits, &scaleToSize, sizeof(scaleBits));
+		words.push_back(scaleBits);
+		words.push_back(trianglesPerChunk);
+		uint64_t h = HashWords(words);
+		unsigned k = (unsigned)(h ^ (h >> 32));
+		return k ? k : 1;
+	}
+
+
+	static inline void PushQuantized(std::vector<uint32_t>& words, float x, float invQuantum) {
+		long long q = llround((double)x * invQuantum);
+		words.push_back((uint32_t)(q & 0xffffffff));
+		words.push_back((uint32_t)((unsigned long long)q >> 32));
+	}
+
+
+	static inline void PushFloat(std::vector<uint32_t>& words, float x) {
+		uint32_t u;
+		memcpy(&u, &x, sizeof(u));
+		words.push_back(u);
+	}
+
+
+	void SimpleGeometryMesh::serializeSurface(const Surface& surface, bool translationInvariant, float quantum, std::vector<uint32_t>& words, Vector3f& origin) const {
+		size_t first = std::min<size_t>(surface.first, Indices.size());
+		size_t last = std::min<size_t>((size_t)surface.first + surface.count, Indices.size());
+		words.clear();
+		words.push_back((uint32_t)surface.mode);
+		words.push_back((uint32_t)(last > first ? last - first : 0));
+		origin = Vector3f(0, 0, 0);
+		if (first >= last)
+			return;
+
+		if (translationInvariant)
+			origin = Vertices[Indices[first]].position;
+		float invQuantum = quantum > 0.0f ? 1.0f / quantum : 1.0f;
+
+		// indices are renumbered in order of first use so that copies stored at
+		// different places in Vertices produce the same description
+		std::unordered_map<unsigned, uint32_t> localIndices;
+		localIndices.reserve(last - first);
+		for (size_t i = first; i < last; i++) {
+			auto [it, isNew] = localIndices.emplace(Indices[i], (uint32_t)localIndices.size());
+			words.push_back(it->second);
+			if (!isNew)
+				continue;
+
+			const Vertex& v = Vertices[Indices[i]];
+			if (translationInvariant) {
+				PushQuantized(words, v.position.x - origin.x, invQuantum);
+				PushQuantized(words, v.position.y - origin.y, invQuantum);
+				PushQuantized(words, v.position.z - origin.z, invQuantum);
+			}
+			else {
+				PushFloat(words, v.position.x);
+				PushFloat(words, v.position.y);
+				PushFloat(words, v.position.z);
+			}
+			PushFloat(words, v.normal.x);
+			PushFloat(words, v.normal.y);
+			PushFloat(words, v.normal.z);
+			PushFloat(words, v.texcoord.x);
+			PushFloat(words, v.texcoord.y);
+		}
+	}
+
+
+	uint64_t SimpleGeometryMesh::computeSurfaceHash(const Surface& surface, bool translationInvariant, float quantum) const {
+		std::vector<uint32_t> words;
+		Vector3f origin;
+		serializeSurface(surface, translationInvariant, quantum, words, origin);
+		return HashWords(words);
+	}
+
+
+	void SimpleGeometryMesh::computeSurfaceHashes(bool translationInvariant, float quantum) {
+		Surface* surfaces = Surfaces.data();
+		ParallelFor(Surfaces.size(), 1, [&](size_t firstSurface, size_t lastSurface) {
+			std::vector<uint32_t> words;
+			Vector3f origin;
+			for (size_t s = firstSurface; s < lastSurface; s++) {
+				serializeSurface(surfaces[s], translationInvariant, quantum, words, origin);
+				surfaces[s].hash = HashWords(words);
+			}
+		});
+	}
+
+
+	uint64_t SimpleGeometryMesh::computeHash(bool translationInvariant, float quantum) const {
+		std::vector<uint32_t> words;
+		std::vector<uint32_t> meshWords;
+		Vector3f origin;
+		Vector3f meshOrigin;
+		bool haveMeshOrigin = false;
+		float invQuantum = quantum > 0.0f ? 1.0f / quantum : 1.0f;
+
+		for (auto& surface : Surfaces) {
+			serializeSurface(surface, translationInvariant, quantum, words, origin);
+			if (!haveMeshOrigin) {
+				meshOrigin = origin;
+				haveMeshOrigin = true;
+			}
+			uint64_t h = HashWords(words);
+			meshWords.push_back((uint32_t)(h & 0xffffffff));
+			meshWords.push_back((uint32_t)(h >> 32));
+			// keep the placement of each surface relative to the first one
+			PushQuantized(meshWords, origin.x - meshOrigin.x, invQuantum);
+			PushQuantized(meshWords, origin.y - meshOrigin.y, invQuantum);
+			PushQuantized(meshWords, origin.z - meshOrigin.z, invQuantum);
+		}
+		return HashWords(meshWords);
+	}
+
+
+	unsigned SimpleGeometryMesh::shareDuplicateSurfaces(bool translationInvariant, float quantum) {
+		computeSurfaceHashes(translationInvariant, quantum);
+
+		// hash -> surfaces that own their index range
+		std::unordered_map<uint64_t, std::vector<int>> owners;
+		std::vector<uint32_t> words;
+		std::vector<uint32_t> ownerWords;
+		Vector3f origin;
+		Vector3f ownerOrigin;
+		unsigned sharedCount = 0;
+
+		for (int s = 0; s < (int)Surfaces.size(); s++) {
+			Surface& surface = Surfaces[s];
+			if (surface.instanceOf >= 0 || surface.count == 0)
+				continue;
+
+			auto& candidates = owners[surface.hash];
+			bool shared = false;
+			for (int c : candidates) {
+				// confirm the match so that hash collisions never merge different geometry
+				serializeSurface(Surfaces[c], translationInvariant, quantum, ownerWords, ownerOrigin);
+				serializeSurface(surface, translationInvariant, quantum, words, origin);
+				if (words != ownerWords)
+					continue;
+				surface.instanceOf = c;
+				surface.instanceOffset = origin - ownerOrigin;
+				shared = true;
+				sharedCount++;
+				break;
+			}
+			if (!shared)
+				candidates.push_back(s);
+		}
+
+		if (!sharedCount)
+			return 0;
+
+		// the old arrays are only read until they are replaced
+		const std::vector<Vertex>& vertices = Vertices.vec();
+		const std::vector<unsigned>& indices = Indices.vec();
+
+		// 1. Keep only the index ranges of the owning surfaces
+		std::vector<unsigned> newIndices;
+		newIndices.reserve(indices.size());
+		for (auto& surface : Surfaces) {
+			if (surface.instanceOf >= 0)
+				continue;
+			unsigned first = (unsigned)newIndices.size();
+			size_t last = std::min<size_t>((size_t)surface.first + surface.count, indices.size());
+			for (size_t i = surface.first; i < last; i++) {
+				newIndices.push_back(indices[i]);
+			}
+			surface.first = first;
+		}
+		for (auto& surface : Surfaces) {
+			if (surface.instanceOf < 0)
+				continue;
+			surface.first = Surfaces[surface.instanceOf].first;
+			surface.count = Surfaces[surface.instanceOf].count;
+		}
+
+		// 2. Keep only the vertices that are still referenced
+		constexpr unsigned unused = ~0u;
+		std::vector<unsigned> remap(vertices.size(), unused);
+		std::vector<Vertex> newVertices;
+		newVertices.reserve(vertices.size());
+		for (auto& index : newIndices) {
+			if (remap[index] == unused) {
+				remap[index] = (unsigned)newVertices.size();
+				newVertices.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		if (verbosity_ >= LoadOptions::Verbosity::Summary)
+			HFLOGINFO("'%s' ... shared %d surfaces, removed %d vertices and %d indices", name_cstr(),
+					  sharedCount, (int)(Vertices.size() - newVertices.size()), (int)(Indices.size() - newIndices.size()));
+
+		Vertices = std::move(newVertices);
+		Indices = std::move(newIndices);
+		SurfaceRemaps.clear();
+		// the vertex ranges of every surface moved with the compaction
+		computeSurfaceBounds();
+		topologyChanged();
+		return sharedCount;
+	}
+
+
+	namespace {
+		// ChunkSplitter recursively partitions a list of triangles at the median centroid
+		// of the longest axis until each part fits the triangle and vertex budgets
+		struct ChunkSplitter {
+			const std::vector<unsigned>& indices;
+			size_t firstIndex;
+			size_t trianglesPerChunk;
+			std::vector<Vector3f> centroids;
+			std::vector<unsigned> triangles;
+			std::vector<std::pair<size_t, size_t>> leaves;
+			std::mutex leavesMutex;
+
+			ChunkSplitter(const std::vector<unsigned>& indices_, size_t firstIndex_, size_t trianglesPerChunk_)
+				: indices(indices_), firstIndex(firstIndex_), trianglesPerChunk(trianglesPerChunk_) {}
+
+			static float axisValue(const Vector3f& v, int axis) {
+				return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+			}
+
+			size_t uniqueVertexCount(size_t b, size_t e) const {
+				std::vector<unsigned> v;
+				v.reserve((e - b) * 3);
+				for (size_t t = b; t < e; t++) {
+					for (size_t k = 0; k < 3; k++) {
+						v.push_back(indices[firstIndex + triangles[t] * 3 + k]);
+					}
+				}
+				std::sort(v.begin(), v.end());
+				return (size_t)(std::unique(v.begin(), v.end()) - v.begin());
+			}
+
+			void split(size_t b, size_t e, int parallelDepth) {
+				size_t n = e - b;
+				bool fits = n <= trianglesPerChunk &&
+					(n * 3 <= SimpleGeometryMesh::MaxChunkVertices || uniqueVertexCount(b, e) <= SimpleGeometryMesh::MaxChunkVertices);
+				if (fits || n <= 1) {
+					std::lock_guard<std::mutex> lock(leavesMutex);
+					leaves.push_back({ b, e });
+					return;
+				}
+
+				Vector3f lo = centroids[triangles[b]];
+				Vector3f hi = lo;
+				for (size_t t = b; t < e; t++) {
+					const Vector3f& c = centroids[triangles[t]];
+					lo.x = std::min(lo.x, c.x);
+					lo.y = std::min(lo.y, c.y);
+					lo.z = std::min(lo.z, c.z);
+					hi.x = std::max(hi.x, c.x);
+					hi.y = std::max(hi.y, c.y);
+					hi.z = std::max(hi.z, c.z);
+				}
+				Vector3f size = hi - lo;
+				int axis = 0;
+				if (size.y > size.x) axis = 1;
+				if (size.z > (axis ? size.y : size.x)) axis = 2;
+
+				size_t mid = b + n / 2;
+				std::nth_element(triangles.begin() + b, triangles.begin() + mid, triangles.begin() + e,
+								 [this, axis](unsigned t1, unsigned t2) {
+									 return axisValue(centroids[t1], axis) < axisValue(centroids[t2], axis);
+								 });
+
+				// the top levels of the tree are split across threads
+				if (parallelDepth > 0 && n > 65536) {
+					auto f = std::async(std::launch::async, [this, b, mid, parallelDepth]() { split(b, mid, parallelDepth - 1); });
+					split(mid, e, parallelDepth - 1);
+					f.get();
+				}
+				else {
+					split(b, mid, 0);
+					split(mid, e, 0);
+				}
+			}
+		};
+	} // namespace
+
+
+	unsigned SimpleGeometryMesh::chunkSurfaces(unsigned trianglesPerChunk) {
+		if (trianglesPerChunk == 0 || Surfaces.empty())
+			return 0;
+
+		// the threads below only read the current arrays
+		const std::vector<Vertex>& vertices = Vertices.vec();
+		const std::vector<unsigned>& indices = Indices.vec();
+		const std::vector<Surface>& surfaces = Surfaces.vec();
+
+		int parallelDepth = 0;
+		for (unsigned threads = GetParallelThreadCount(); threads > 1; threads >>= 1) {
+			parallelDepth++;
+		}
+
+		// an instance of a surface that is not an instance itself is split with its owner
+		auto ownerOf = [&surfaces](const Surface& surface) {
+			int owner = surface.instanceOf;
+			return owner >= 0 && owner < (int)surfaces.size() && surfaces[owner].instanceOf < 0 ? owner : -1;
+		};
+
+		// A chunk is a list of positions into Indices taken from one source surface
+		struct Chunk {
+			unsigned surface;
+			std::vector<unsigned> positions;
+			std::vector<unsigned> vertices;
+			std::vector<unsigned> localIndices;
+			unsigned first = 0;
+			unsigned baseVertex = 0;
+		};
+		std::vector<Chunk> chunks;
+		std::vector<size_t> firstChunk(surfaces.size(), 0);
+		std::vector<size_t> chunkCount(surfaces.size(), 0);
+
+		for (unsigned s = 0; s < (unsigned)surfaces.size(); s++) {
+			const Surface& surface = surfaces[s];
+			firstChunk[s] = chunks.size();
+			if (ownerOf(surface) >= 0)
+				continue;
+
+			size_t first = std::min<size_t>(surface.first, indices.size());
+			size_t last = std::min<size_t>((size_t)surface.first + surface.count, indices.size());
+			size_t triangleCount = (last - first) / 3;
+			if (surface.mode != SurfaceType::Triangles || triangleCount == 0) {
+				Chunk chunk;
+				chunk.surface = s;
+				for (size_t i = first; i < last; i++) {
+					chunk.positions.push_back((unsigned)i);
+				}
+				chunks.push_back(std::move(chunk));
+				chunkCount[s] = 1;
+				continue;
+			}
+			if ((last - first) % 3 != 0) {
+				HFLOGWARN("'%s' ... surface %u drops %d indices that do not form a triangle", name_cstr(), s, (int)((last - first) % 3));
+			}
+
+			ChunkSplitter splitter(indices, first, trianglesPerChunk);
+			splitter.centroids.resize(triangleCount);
+			splitter.triangles.resize(triangleCount);
+			ParallelFor(triangleCount, 4096, [&](size_t firstTriangle, size_t lastTriangle) {
+				for (size_t t = firstTriangle; t < lastTriangle; t++) {
+					const Vector3f& a = vertices[indices[first + t * 3 + 0]].position;
+					const Vector3f& b = vertices[indices[first + t * 3 + 1]].position;
+					const Vector3f& c = vertices[indices[first + t * 3 + 2]].position;
+					splitter.centroids[t] = (a + b + c) * (1.0f / 3.0f);
+					splitter.triangles[t] = (unsigned)t;
+				}
+			});
+			splitter.split(0, triangleCount, parallelDepth);
+			std::sort(splitter.leaves.begin(), splitter.leaves.end());
+
+			for (auto& leaf : splitter.leaves) {
+				Chunk chunk;
+				chunk.surface = s;
+				chunk.positions.reserve((leaf.second - leaf.first) * 3);
+				for (size_t t = leaf.first; t < leaf.second; t++) {
+					for (unsigned k = 0; k < 3; k++) {
+						chunk.positions.push_back((unsigned)(first + splitter.triangles[t] * 3 + k));
+					}
+				}
+				chunks.push_back(std::move(chunk));
+			}
+			chunkCount[s] = splitter.leaves.size();
+		}
+
+		// 1. Find the vertices of each chunk and its indices relative to them
+		ParallelFor(chunks.size(), 1, [&](size_t firstC, size_t lastC) {
+			for (size_t c = firstC; c < lastC; c++) {
+				Chunk& chunk = chunks[c];
+				chunk.vertices.reserve(chunk.positions.size());
+				for (unsigned p : chunk.positions) {
+					chunk.vertices.push_back(indices[p]);
+				}
+				std::sort(chunk.vertices.begin(), chunk.vertices.end());
+				chunk.vertices.erase(std::unique(chunk.vertices.begin(), chunk.vertices.end()), chunk.vertices.end());
+				chunk.localIndices.reserve(chunk.positions.size());
+				for (unsigned p : chunk.positions) {
+					auto it = std::lower_bound(chunk.vertices.begin(), chunk.vertices.end(), indices[p]);
+					chunk.localIndices.push_back((unsigned)(it - chunk.vertices.begin()));
+				}
+			}
+		});
+
+		// only strips, fans, loops, and points are kept whole, so only they can be too large
+		for (const Chunk& chunk : chunks) {
+			if (chunk.vertices.size() > MaxChunkVertices) {
+				HFLOGWARN("'%s' ... surface %u is not made of triangles and keeps %d vertices, more than %u",
+						  name_cstr(), chunk.surface, (int)chunk.vertices.size(), MaxChunkVertices);
+			}
+		}
+
+		// 2. Give each chunk a contiguous range of the new arrays
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+		for (auto& chunk : chunks) {
+			chunk.baseVertex = (unsigned)vertexCount;
+			chunk.first = (unsigned)indexCount;
+			vertexCount += chunk.vertices.size();
+			indexCount += chunk.localIndices.size();
+		}
+
+		std::vector<Vertex> newVertices(vertexCount);
+		std::vector<unsigned> newIndices(indexCount);
+		ParallelFor(chunks.size(), 1, [&](size_t firstC, size_t lastC) {
+			for (size_t c = firstC; c < lastC; c++) {
+				const Chunk& chunk = chunks[c];
+				for (size_t j = 0; j < chunk.vertices.size(); j++) {
+					newVertices[chunk.baseVertex + j] = vertices[chunk.vertices[j]];
+				}
+				for (size_t j = 0; j < chunk.localIndices.size(); j++) {
+					newIndices[chunk.first + j] = chunk.baseVertex + chunk.localIndices[j];
+				}
+			}
+		});
+
+		// 3. Replace each source surface with its chunks, keeping the surface order. An
+		// instance becomes one instance of each chunk of its owner.
+		std::vector<unsigned> firstNewSurface(surfaces.size(), 0);
+		size_t newSurfaceCount = 0;
+		for (unsigned s = 0; s < (unsigned)surfaces.size(); s++) {
+			int owner = ownerOf(surfaces[s]);
+			firstNewSurface[s] = (unsigned)newSurfaceCount;
+			newSurfaceCount += chunkCount[owner >= 0 ? owner : s];
+		}
+
+		std::vector<Surface> newSurfaces;
+		newSurfaces.reserve(newSurfaceCount);
+		for (unsigned s = 0; s < (unsigned)surfaces.size(); s++) {
+			int owner = ownerOf(surfaces[s]);
+			unsigned source = owner >= 0 ? (unsigned)owner : s;
+			for (size_t k = 0; k < chunkCount[source]; k++) {
+				const Chunk& chunk = chunks[firstChunk[source] + k];
+				Surface surface = surfaces[s];
+				surface.first = chunk.first;
+				surface.count = (unsigned)chunk.localIndices.size();
+				surface.instanceOf = owner >= 0 ? (int)(firstNewSurface[owner] + k) : -1;
+				surface.hash = 0;
+				newSurfaces.push_back(surface);
+			}
+		}
+
+		if (verbosity_ >= LoadOptions::Verbosity::Summary)
+			HFLOGINFO("'%s' ... split %d surfaces into %d chunks", name_cstr(), (int)surfaces.size(), (int)newSurfaces.size());
+
+		Vertices = std::move(newVertices);
+		Indices = std::move(newIndices);
+		Surfaces = std::move(newSurfaces);
+		SurfaceRemaps.clear();
+		computeSurfaceBounds();
+		topologyChanged();
+		return (unsigned)Surfaces.size();
+	}
+
+
+	static inline bool IsMergeableSurfaceType(SimpleGeometryMesh::SurfaceType mode) {
+		// strips, fans, and loops cannot be joined without changing their primitives
+		return mode == SimpleGeometryMesh::SurfaceType::Points ||
+			mode == SimpleGeometryMesh::SurfaceType::Lines ||
+			mode == SimpleGeometryMesh::SurfaceType::Triangles;
+	}
+
+
+	unsigned SimpleGeometryMesh::mergeSurfacesByMaterial() {
+		if (Surfaces.size() < 2)
+			return 0;
+
+		// the old arrays are only read until they are replaced
+		const std::vector<Surface>& surfaces = Surfaces.vec();
+		const std::vector<unsigned>& indices = Indices.vec();
+
+		// shared surfaces and their owners keep their own index ranges
+		std::vector<bool> shared(surfaces.size(), false);
+		for (size_t s = 0; s < surfaces.size(); s++) {
+			if (surfaces[s].instanceOf >= 0 && surfaces[s].instanceOf < (int)surfaces.size()) {
+				shared[s] = true;
+				shared[surfaces[s].instanceOf] = true;
+			}
+		}
+
+		auto sameMaterial = [](const Surface& a, const Surface& b) {
+			return a.mode == b.mode &&
+				a.materialLibrary == b.materialLibrary &&
+				a.materialName == b.materialName;
+		};
+
+		// the sort is stable so faces keep their file order within a material
+		std::vector<unsigned> order(surfaces.size());
+		for (unsigned s = 0; s < (unsigned)order.size(); s++) {
+			order[s] = s;
+		}
+		std::stable_sort(order.begin(), order.end(), [&surfaces](unsigned a, unsigned b) {
+			const Surface& x = surfaces[a];
+			const Surface& y = surfaces[b];
+			if (x.mode != y.mode)
+				return (int)x.mode < (int)y.mode;
+			if (x.materialLibrary != y.materialLibrary)
+				return x.materialLibrary < y.materialLibrary;
+			return x.materialName < y.materialName;
+		});
+
+		// 1. Copy the index ranges in sorted order and merge runs of the same material
+		std::vector<unsigned> newIndices;
+		std::vector<Surface> newSurfaces;
+		std::vector<unsigned> newFirst(surfaces.size(), 0);
+		std::vector<int> newSurfaceIndex(surfaces.size(), -1);
+		newIndices.reserve(indices.size());
+		newSurfaces.reserve(surfaces.size());
+		// the last surface that later surfaces of the same material may be merged into
+		int openSurface = -1;
+
+		for (unsigned s : order) {
+			const Surface& surface = surfaces[s];
+			if (surface.instanceOf >= 0) {
+				newSurfaceIndex[s] = (int)newSurfaces.size();
+				openSurface = -1;
+				newSurfaces.push_back(surface);
+				continue;
+			}
+
+			newFirst[s] = (unsigned)newIndices.size();
+			size_t first = std::min<size_t>(surface.first, indices.size());
+			size_t last = std::min<size_t>((size_t)surface.first + surface.count, indices.size());
+			newIndices.insert(newIndices.end(), indices.begin() + first, indices.begin() + last);
+			unsigned count = (unsigned)(last - first);
+
+			bool mergeable = !shared[s] && IsMergeableSurfaceType(surface.mode);
+			if (mergeable && openSurface >= 0 && sameMaterial(newSurfaces[openSurface], surface)) {
+				newSurfaces[openSurface].count += count;
+				newSurfaces[openSurface].hash = 0;
+				newSurfaceIndex[s] = openSurface;
+				continue;
+			}
+
+			Surface newSurface = surface;
+			newSurface.first = newFirst[s];
+			newSurface.count = count;
+			newSurfaceIndex[s] = (int)newSurfaces.size();
+			openSurface = mergeable ? (int)newSurfaces.size() : -1;
+			newSurfaces.push_back(newSurface);
+		}
+
+		// 2. Point shared surfaces at the new range of their owner
+		for (auto& surface : newSurfaces) {
+			if (surface.instanceOf < 0)
+				continue;
+			surface.instanceOf = newSurfaceIndex[surface.instanceOf];
+			surface.first = newSurfaces[surface.instanceOf].first;
+			surface.count = newSurfaces[surface.instanceOf].count;
+		}
+
+		// 3. Record where every original surface went, following any earlier merge
+		std::vector<SurfaceRemap> remaps(surfaces.size());
+		for (unsigned s = 0; s < (unsigned)surfaces.size(); s++) {
+			const Surface& surface = surfaces[s];
+			SurfaceRemap& remap = remaps[s];
+			remap.surfaceName = surface.surfaceName;
+			remap.surface = (unsigned)newSurfaceIndex[s];
+			remap.first = surface.instanceOf >= 0 ? newSurfaces[remap.surface].first : newFirst[s];
+			remap.count = surface.count;
+		}
+		if (SurfaceRemaps.empty()) {
+			SurfaceRemaps.swap(remaps);
+		}
+		else {
+			for (auto& remap : SurfaceRemaps) {
+				if (remap.surface >= surfaces.size())
+					continue;
+				const SurfaceRemap& moved = remaps[remap.surface];
+				remap.first = moved.first + (remap.first - surfaces[remap.surface].first);
+				remap.surface = moved.surface;
+			}
+		}
+
+		unsigned removedCount = (unsigned)(surfaces.size() - newSurfaces.size());
+		if (verbosity_ >= LoadOptions::Verbosity::Summary)
+			HFLOGINFO("'%s' ... merged %d surfaces into %d surfaces", name_cstr(), (int)surfaces.size(), (int)newSurfaces.size());
+
+		Indices = std::move(newIndices);
+		Surfaces = std::move(newSurfaces);
+		computeSurfaceBounds();
+		topologyChanged();
+		return removedCount;
 	}
 
 
@@ -671,6 +1678,9 @@ namespace Fluxions {
 		Vertices.clear();
 		Indices.clear();
 		Surfaces.clear();
+		SurfaceRemaps.clear();
+		validAttributes_ = 0;
+		topologyChanged();
 	}
 
 
@@ -678,5 +1688,6 @@ namespace Fluxions {
 		for (auto& vertex : Vertices) {
 			vertex.position = mat * vertex.position;
 		}
+		positionsChanged();
 	}
 } // namespace Fluxions
@@ -0,0 +1,185 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_fileio_iostream.hpp>
+#include <fluxions_simple_geometry_pager.hpp>
+
+namespace Fluxions {
+	bool SimpleGeometryPager::open(const std::string& cacheFilename, const std::vector<SimpleGeometryMesh::Surface>& surfaces) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		file_.close();
+		file_.clear();
+		filename_.clear();
+		lru_.clear();
+		pages_.clear();
+		residentBytes_ = 0;
+
+		file_.open(cacheFilename, std::ios::binary);
+		if (!file_)
+			return false;
+
+		unsigned magic = 0;
+		unsigned version = 0;
+		unsigned optionsKey = 0;
+		unsigned validAttributes = 0;
+		unsigned surfaceCount = 0;
+		string_string_map mtllibs;
+		ReadBinaryElement(file_, magic);
+		ReadBinaryElement(file_, version);
+		ReadBinaryElement(file_, optionsKey);
+		ReadBinaryElement(file_, validAttributes);
+		ReadBinaryElement(file_, vertexCount_);
+		ReadBinaryElement(file_, indexCount_);
+		ReadBinaryElement(file_, surfaceCount);
+		ReadBinaryStringMap(file_, mtllibs);
+		if (!file_ || magic != SimpleGeometryMesh::CacheMagic || version != SimpleGeometryMesh::CacheVersion) {
+			HFLOGWARN("'%s' is not a mesh cache", cacheFilename.c_str());
+			file_.close();
+			return false;
+		}
+		if (surfaceCount != surfaces.size()) {
+			HFLOGWARN("'%s' has %d surfaces instead of %d", cacheFilename.c_str(), (int)surfaceCount, (int)surfaces.size());
+			file_.close();
+			return false;
+		}
+
+		// the vertex array follows the header and the index array follows the vertices
+		vertexOffset_ = file_.tellg();
+		indexOffset_ = vertexOffset_ + (std::streamoff)vertexCount_ * sizeof(SimpleGeometryMesh::Vertex);
+
+		ranges_.resize(surfaces.size());
+		for (size_t i = 0; i < surfaces.size(); i++) {
+			const SimpleGeometryMesh::Surface& surface = surfaces[i];
+			Range& range = ranges_[i];
+			range.first = surface.first;
+			range.count = surface.count;
+			range.baseVertex = surface.baseVertex;
+			range.vertexCount = surface.vertexCount;
+			range.instanceOf = surface.instanceOf;
+			if ((size_t)range.first + range.count > indexCount_ ||
+				(size_t)range.baseVertex + range.vertexCount > vertexCount_) {
+				HFLOGWARN("'%s' surface %d is outside of the cache", cacheFilename.c_str(), (int)i);
+				file_.close();
+				return false;
+			}
+		}
+		filename_ = cacheFilename;
+		return true;
+	}
+
+
+	void SimpleGeometryPager::close() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		file_.close();
+		filename_.clear();
+		ranges_.clear();
+		lru_.clear();
+		pages_.clear();
+		residentBytes_ = 0;
+	}
+
+
+	SimpleGeometryPager::PagePtr SimpleGeometryPager::fetch(unsigned surface) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (surface >= ranges_.size())
+			return nullptr;
+		if (ranges_[surface].instanceOf >= 0)
+			surface = (unsigned)ranges_[surface].instanceOf;
+
+		auto it = pages_.find(surface);
+		if (it != pages_.end()) {
+			lru_.splice(lru_.begin(), lru_, it->second.lru);
+			return it->second.page;
+		}
+
+		PagePtr page = read(ranges_[surface]);
+		if (!page)
+			return nullptr;
+		lru_.push_front(surface);
+		pages_[surface] = Entry{ page, lru_.begin() };
+		residentBytes_ += page->sizeInBytes();
+		trim();
+		return page;
+	}
+
+
+	bool SimpleGeometryPager::isResident(unsigned surface) const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (surface < ranges_.size() && ranges_[surface].instanceOf >= 0)
+			surface = (unsigned)ranges_[surface].instanceOf;
+		return pages_.count(surface) != 0;
+	}
+
+
+	void SimpleGeometryPager::evict(unsigned surface) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = pages_.find(surface);
+		if (it == pages_.end())
+			return;
+		residentBytes_ -= it->second.page->sizeInBytes();
+		lru_.erase(it->second.lru);
+		pages_.erase(it);
+	}
+
+
+	void SimpleGeometryPager::evictAll() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		lru_.clear();
+		pages_.clear();
+		residentBytes_ = 0;
+	}
+
+
+	void SimpleGeometryPager::setBudget(size_t bytes) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		budget_ = bytes;
+		trim();
+	}
+
+
+	bool SimpleGeometryPager::readAll(std::vector<SimpleGeometryMesh::Vertex>& vertices, std::vector<unsigned>& indices) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!file_.is_open())
+			return false;
+		file_.clear();
+		file_.seekg(vertexOffset_);
+		ReadBinaryElement(file_, vertices, vertexCount_);
+		file_.seekg(indexOffset_);
+		ReadBinaryElement(file_, indices, indexCount_);
+		return (bool)file_;
+	}
+
+
+	SimpleGeometryPager::PagePtr SimpleGeometryPager::read(const Range& range) {
+		auto page = std::make_shared<Page>();
+		file_.clear();
+		if (range.vertexCount) {
+			file_.seekg(vertexOffset_ + (std::streamoff)range.baseVertex * sizeof(SimpleGeometryMesh::Vertex));
+			ReadBinaryElement(file_, page->vertices, range.vertexCount);
+		}
+		if (range.count) {
+			file_.seekg(indexOffset_ + (std::streamoff)range.first * sizeof(unsigned));
+			ReadBinaryElement(file_, page->indices, range.count);
+		}
+		if (!file_) {
+			HFLOGWARN("'%s' could not be read", filename_.c_str());
+			return nullptr;
+		}
+
+		// page indices are relative to the first vertex of the page
+		for (auto& index : page->indices) {
+			index -= range.baseVertex;
+		}
+		return page;
+	}
+
+
+	void SimpleGeometryPager::trim() {
+		// the most recently used page is kept even if it is over budget by itself
+		while (residentBytes_ > budget_ && lru_.size() > 1) {
+			unsigned surface = lru_.back();
+			lru_.pop_back();
+			auto it = pages_.find(surface);
+			residentBytes_ -= it->second.page->sizeInBytes();
+			pages_.erase(it);
+		}
+	}
+} // namespace Fluxions
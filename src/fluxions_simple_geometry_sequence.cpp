@@ -0,0 +1,537 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_file_path_info.hpp>
+#include <fluxions_fileio_iostream.hpp>
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_geometry_sequence.hpp>
+
+namespace Fluxions {
+	namespace {
+		static_assert(sizeof(Vector3f) == 3 * sizeof(float), "frames are encoded as packed floats");
+
+		inline void WriteVarint(std::vector<uint8_t>& bytes, uint32_t x) {
+			while (x >= 0x80) {
+				bytes.push_back((uint8_t)(x | 0x80));
+				x >>= 7;
+			}
+			bytes.push_back((uint8_t)x);
+		}
+
+		inline bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& x) {
+			x = 0;
+			for (unsigned shift = 0; shift < 35; shift += 7) {
+				if (p == end)
+					return false;
+				uint8_t b = *p++;
+				x |= (uint32_t)(b & 0x7f) << shift;
+				if (!(b & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		// small differences of either sign become small unsigned values
+		inline uint32_t ZigZag(int32_t d) { return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31); }
+		inline int32_t UnZigZag(uint32_t x) { return (int32_t)(x >> 1) ^ -(int32_t)(x & 1); }
+
+		// the floats of a frame in the order they are encoded
+		inline void FrameStreams(const SimpleGeometrySequence::Frame& frame, const float* streams[2], size_t& count) {
+			streams[0] = reinterpret_cast<const float*>(frame.positions.data());
+			streams[1] = reinterpret_cast<const float*>(frame.normals.data());
+			count = frame.positions.size() * 3;
+		}
+	}
+
+
+	SimpleGeometrySequence::SimpleGeometrySequence() {}
+
+
+	SimpleGeometrySequence::~SimpleGeometrySequence() {
+		stopPrefetch();
+	}
+
+
+	bool SimpleGeometrySequence::loadOBJSequence(const std::vector<std::string>& filenames,
+												 const SimpleGeometryMesh::LoadOptions& options,
+												 const std::string& cacheFilename) {
+		clear();
+		if (filenames.empty())
+			return false;
+
+		if (!cacheFilename.empty()) {
+			FilePathInfo fpi_cache(cacheFilename);
+			bool current = fpi_cache.exists();
+			for (size_t i = 0; current && i < filenames.size(); i++) {
+				current = FilePathInfo(filenames[i]).lastWriteTime() <= fpi_cache.lastWriteTime();
+			}
+			if (current) {
+				HFLOGINFO("'%s' ... reading cached sequence '%s'", filenames[0].c_str(), cacheFilename.c_str());
+				if (loadCache(cacheFilename)) {
+					FilePathInfo fpi(filenames[0]);
+					baseMesh_.setName(fpi.filename());
+					baseMesh_.setPath(fpi.shortestPath());
+					return true;
+				}
+				HFLOGWARN("'%s' ... cached sequence '%s' is invalid", filenames[0].c_str(), cacheFilename.c_str());
+				clear();
+			}
+		}
+
+		// chunking moves vertices by position, so it would give every frame a different topology.
+		// optimizeIndexing is kept because it shares vertices by their OBJ face indices, not by
+		// their values, and frames that index differently are rejected by the topology check.
+		// Recentering and scaling are applied below so every frame uses the first frame's transform.
+		SimpleGeometryMesh::LoadOptions baseOptions = options;
+		baseOptions.cachePolicy = SimpleGeometryMesh::LoadOptions::CachePolicy::Ignore;
+		baseOptions.trianglesPerChunk = 0;
+		baseOptions.recenter = false;
+		baseOptions.scaleToSize = 0.0f;
+		if (!baseMesh_.loadOBJ(filenames[0], baseOptions))
+			return false;
+
+		// the same center and scale as loadOBJ() with the caller's options
+		BoundingBoxf box;
+		for (const auto& vertex : baseMesh_.Vertices.vec()) {
+			box += vertex.position;
+		}
+		const Vector3f center = options.recenter ? box.center() : Vector3f(0, 0, 0);
+		float scale = 1.0f;
+		if (options.scaleToSize > 0.0f && box.maxSize() > 0.0f)
+			scale = options.scaleToSize / box.maxSize();
+		const bool transformPositions = options.recenter || scale != 1.0f;
+		if (transformPositions) {
+			for (auto& vertex : baseMesh_.Vertices.mut()) {
+				vertex.position -= center;
+				vertex.position *= scale;
+			}
+			baseMesh_.invalidateAttributes(SimpleGeometryMesh::TangentsAttribute | SimpleGeometryMesh::BoundsAttribute);
+			if (options.computeBounds)
+				baseMesh_.ensureBounds();
+			if (options.computeTangents)
+				baseMesh_.ensureTangents();
+		}
+
+		// frames only need positions and normals
+		SimpleGeometryMesh::LoadOptions frameOptions = baseOptions;
+		frameOptions.computeTangents = false;
+		frameOptions.computeBounds = false;
+		frameOptions.verbosity = SimpleGeometryMesh::LoadOptions::Verbosity::Quiet;
+
+		const unsigned frameCount = (unsigned)filenames.size();
+		const unsigned interval = keyframeInterval_;
+		const size_t vertexCount = baseMesh_.Vertices.size();
+		frameTable_.resize(frameCount);
+		encoded_.resize(frameCount);
+
+		// each group starts with a keyframe, so groups are parsed and encoded on separate threads
+		// the threads only read the base mesh, so its arrays are never detached
+		const SimpleGeometryMesh& base = baseMesh_;
+		std::atomic<unsigned> badFrames{ 0 };
+		unsigned groupCount = (frameCount + interval - 1) / interval;
+		ParallelFor(groupCount, 1, [&](size_t firstGroup, size_t lastGroup) {
+			Frame previous;
+			Frame current;
+			SimpleGeometryMesh mesh;
+			for (size_t g = firstGroup; g < lastGroup; g++) {
+				unsigned first = (unsigned)g * interval;
+				unsigned last = std::min(frameCount, first + interval);
+				for (unsigned f = first; f < last; f++) {
+					const SimpleGeometryMesh* frameMesh = &base;
+					if (f > 0) {
+						if (!mesh.loadOBJ(filenames[f], frameOptions)) {
+							HFLOGERROR("'%s' ... frame %u could not be loaded", filenames[f].c_str(), f);
+							badFrames++;
+							return;
+						}
+						frameMesh = &mesh;
+					}
+
+					// the topology is verified once here so playback only copies positions and normals
+					const auto& vertices = frameMesh->Vertices.vec();
+					bool matches = vertices.size() == vertexCount &&
+						frameMesh->Indices == base.Indices &&
+						frameMesh->Surfaces.size() == base.Surfaces.size();
+					for (size_t s = 0; matches && s < base.Surfaces.size(); s++) {
+						const auto& a = frameMesh->Surfaces[s];
+						const auto& b = base.Surfaces[s];
+						matches = a.mode == b.mode && a.first == b.first && a.count == b.count;
+					}
+					for (size_t i = 0; matches && i < vertexCount; i++) {
+						const auto& a = vertices[i].texcoord;
+						const auto& b = base.Vertices[i].texcoord;
+						matches = a.x == b.x && a.y == b.y;
+					}
+					if (!matches) {
+						HFLOGERROR("'%s' ... frame %u does not match the topology of '%s'", filenames[f].c_str(), f, filenames[0].c_str());
+						badFrames++;
+						return;
+					}
+
+					current.index = f;
+					current.positions.resize(vertexCount);
+					current.normals.resize(vertexCount);
+					for (size_t i = 0; i < vertexCount; i++) {
+						current.positions[i] = vertices[i].position;
+						current.normals[i] = vertices[i].normal;
+					}
+					if (f > 0 && transformPositions) {
+						for (auto& position : current.positions) {
+							position -= center;
+							position *= scale;
+						}
+					}
+					bool keyframe = f == first;
+					encode(current, keyframe ? nullptr : &previous, encoded_[f]);
+					frameTable_[f].size = (unsigned)encoded_[f].size();
+					frameTable_[f].keyframe = keyframe;
+					std::swap(previous, current);
+				}
+			}
+		});
+
+		if (badFrames > 0) {
+			clear();
+			return false;
+		}
+
+		size_t rawSize = (size_t)frameCount * vertexCount * 2 * sizeof(Vector3f);
+		HFLOGINFO("'%s' ... %u frames encoded in %zu bytes (%zu uncompressed)", baseMesh_.name_cstr(), frameCount, encodedSizeInBytes(), rawSize);
+
+		if (!cacheFilename.empty()) {
+			HFLOGINFO("'%s' ... writing cached sequence '%s'", baseMesh_.name_cstr(), cacheFilename.c_str());
+			if (!saveCache(cacheFilename))
+				HFLOGWARN("'%s' ... could not write cached sequence '%s'", baseMesh_.name_cstr(), cacheFilename.c_str());
+		}
+		return true;
+	}
+
+
+	bool SimpleGeometrySequence::saveCache(const std::string& filename) const {
+		if (frameTable_.empty())
+			return false;
+
+		std::ofstream fout(filename, std::ios::binary);
+		unsigned frameCount = (unsigned)frameTable_.size();
+		unsigned vertexCount = (unsigned)baseMesh_.Vertices.size();
+		WriteBinaryElement(fout, CacheMagic);
+		WriteBinaryElement(fout, CacheVersion);
+		WriteBinaryElement(fout, frameCount);
+		WriteBinaryElement(fout, keyframeInterval_);
+		WriteBinaryElement(fout, vertexCount);
+		if (!baseMesh_.saveCache(fout))
+			return false;
+
+		for (const auto& entry : frameTable_) {
+			unsigned keyframe = entry.keyframe ? 1 : 0;
+			WriteBinaryElement(fout, entry.size);
+			WriteBinaryElement(fout, keyframe);
+		}
+
+		std::vector<uint8_t> bytes;
+		for (unsigned f = 0; f < frameCount; f++) {
+			if (!readEncoded(f, bytes))
+				return false;
+			fout.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		}
+		return (bool)fout;
+	}
+
+
+	bool SimpleGeometrySequence::loadCache(const std::string& filename) {
+		clear();
+		std::lock_guard<std::mutex> lock(fileMutex_);
+		file_.open(filename, std::ios::binary);
+		if (!file_)
+			return false;
+
+		unsigned magic = 0;
+		unsigned version = 0;
+		unsigned frameCount = 0;
+		unsigned interval = 0;
+		unsigned vertexCount = 0;
+		ReadBinaryElement(file_, magic);
+		ReadBinaryElement(file_, version);
+		ReadBinaryElement(file_, frameCount);
+		ReadBinaryElement(file_, interval);
+		ReadBinaryElement(file_, vertexCount);
+		if (!file_ || magic != CacheMagic || version != CacheVersion || !frameCount || !interval) {
+			HFLOGWARN("Sequence cache has an unknown format or version");
+			file_.close();
+			return false;
+		}
+		if (!baseMesh_.loadCache(file_) || baseMesh_.Vertices.size() != vertexCount) {
+			file_.close();
+			return false;
+		}
+
+		keyframeInterval_ = interval;
+		frameTable_.resize(frameCount);
+		for (auto& entry : frameTable_) {
+			unsigned keyframe = 0;
+			ReadBinaryElement(file_, entry.size);
+			ReadBinaryElement(file_, keyframe);
+			entry.keyframe = keyframe != 0;
+		}
+
+		uint64_t offset = (uint64_t)file_.tellg();
+		for (auto& entry : frameTable_) {
+			entry.offset = offset;
+			offset += entry.size;
+		}
+		if (!file_) {
+			frameTable_.clear();
+			file_.close();
+			return false;
+		}
+		return true;
+	}
+
+
+	void SimpleGeometrySequence::clear() {
+		stopPrefetch();
+		baseMesh_.clear();
+		frameTable_.clear();
+		encoded_.clear();
+		{
+			std::lock_guard<std::mutex> lock(fileMutex_);
+			file_.close();
+			file_.clear();
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		ready_.clear();
+		lastDecoded_.reset();
+		requested_ = 0;
+	}
+
+
+	SimpleGeometrySequence::FramePtr SimpleGeometrySequence::frame(unsigned frame) {
+		if (frame >= frameCount())
+			return nullptr;
+
+		FramePtr result;
+		FramePtr previous;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			requested_ = frame;
+			auto it = ready_.find(frame);
+			if (it != ready_.end())
+				result = it->second;
+			trimReady(frame);
+			previous = lastDecoded_;
+			if (prefetchFrames_ > 0 && !thread_.joinable())
+				thread_ = std::thread([this]() { run(); });
+		}
+		changed_.notify_all();
+
+		if (!result) {
+			result = decode(frame, previous);
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (result)
+				lastDecoded_ = result;
+		}
+		return result;
+	}
+
+
+	bool SimpleGeometrySequence::applyFrame(unsigned frame, SimpleGeometryMesh& mesh) {
+		FramePtr f = this->frame(frame);
+		if (!f || mesh.Vertices.size() != f->positions.size())
+			return false;
+
+		SimpleGeometryMesh::Vertex* v = mesh.Vertices.data();
+		for (size_t i = 0; i < f->positions.size(); i++) {
+			v[i].position = f->positions[i];
+			v[i].normal = f->normals[i];
+		}
+		mesh.invalidateAttributes(SimpleGeometryMesh::TangentsAttribute | SimpleGeometryMesh::BoundsAttribute);
+		return true;
+	}
+
+
+	void SimpleGeometrySequence::setPrefetchFrames(unsigned count) {
+		if (count == 0)
+			stopPrefetch();
+		std::lock_guard<std::mutex> lock(mutex_);
+		prefetchFrames_ = count;
+		trimReady(requested_);
+		changed_.notify_all();
+	}
+
+
+	size_t SimpleGeometrySequence::encodedSizeInBytes() const {
+		size_t size = 0;
+		for (const auto& entry : frameTable_) {
+			size += entry.size;
+		}
+		return size;
+	}
+
+
+	void SimpleGeometrySequence::stopPrefetch() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!thread_.joinable())
+				return;
+			stopping_ = true;
+		}
+		changed_.notify_all();
+		thread_.join();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = false;
+		ready_.clear();
+	}
+
+
+	void SimpleGeometrySequence::run() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (1) {
+			unsigned target = 0;
+			auto findMissing = [this, &target]() {
+				unsigned count = frameCount();
+				for (unsigned i = 1; i <= prefetchFrames_ && i < count; i++) {
+					target = (requested_ + i) % count;
+					if (!ready_.count(target))
+						return true;
+				}
+				return false;
+			};
+			changed_.wait(lock, [&]() { return stopping_ || findMissing(); });
+			if (stopping_)
+				break;
+
+			FramePtr previous = lastDecoded_;
+			lock.unlock();
+			FramePtr result = decode(target, previous);
+			lock.lock();
+
+			// a failed frame is recorded too so it is not retried, frame() decodes it again
+			ready_[target] = result;
+			if (result)
+				lastDecoded_ = result;
+			trimReady(requested_);
+		}
+	}
+
+
+	void SimpleGeometrySequence::trimReady(unsigned first) {
+		unsigned count = frameCount();
+		for (auto it = ready_.begin(); it != ready_.end();) {
+			unsigned distance = (it->first + count - first) % std::max(count, 1u);
+			if (distance > prefetchFrames_)
+				it = ready_.erase(it);
+			else
+				++it;
+		}
+	}
+
+
+	bool SimpleGeometrySequence::readEncoded(unsigned frame, std::vector<uint8_t>& bytes) const {
+		if (frame < encoded_.size()) {
+			bytes = encoded_[frame];
+			return true;
+		}
+
+		const FrameEntry& entry = frameTable_[frame];
+		std::lock_guard<std::mutex> lock(fileMutex_);
+		bytes.resize(entry.size);
+		file_.clear();
+		file_.seekg((std::streamoff)entry.offset);
+		file_.read(reinterpret_cast<char*>(bytes.data()), entry.size);
+		return (bool)file_;
+	}
+
+
+	SimpleGeometrySequence::FramePtr SimpleGeometrySequence::decode(unsigned frame, FramePtr previous) const {
+		// deltas are decoded from the previous frame or from the last keyframe in the frame
+		// table, which may have been encoded with another interval than keyframeInterval_
+		const bool continues = previous && previous->index + 1 == frame;
+		unsigned first = frame;
+		while (!continues && first > 0 && !frameTable_[first].keyframe) {
+			first--;
+		}
+		if (!continues && !frameTable_[first].keyframe) {
+			HFLOGWARN("'%s' ... frame %u has no keyframe", baseMesh_.name_cstr(), frame);
+			return nullptr;
+		}
+
+		const size_t vertexCount = baseMesh_.Vertices.size();
+		std::vector<uint8_t> bytes;
+		for (unsigned f = first; f <= frame; f++) {
+			auto result = std::make_shared<Frame>();
+			result->index = f;
+			result->positions.resize(vertexCount);
+			result->normals.resize(vertexCount);
+			const Frame* base = frameTable_[f].keyframe ? nullptr : previous.get();
+			if (!readEncoded(f, bytes) || !decodeInto(bytes, base, *result)) {
+				HFLOGWARN("'%s' ... frame %u could not be decoded", baseMesh_.name_cstr(), f);
+				return nullptr;
+			}
+			previous = result;
+		}
+		return previous;
+	}
+
+
+	void SimpleGeometrySequence::encode(const Frame& frame, const Frame* previous, std::vector<uint8_t>& bytes) {
+		const float* streams[2];
+		size_t count = 0;
+		FrameStreams(frame, streams, count);
+		bytes.clear();
+
+		if (!previous) {
+			bytes.resize(2 * count * sizeof(float));
+			memcpy(bytes.data(), streams[0], count * sizeof(float));
+			memcpy(bytes.data() + count * sizeof(float), streams[1], count * sizeof(float));
+			return;
+		}
+
+		// neighbouring frames share most of the high bits of each float, so the difference
+		// of the bit patterns is small and takes one to three bytes
+		const float* previousStreams[2];
+		FrameStreams(*previous, previousStreams, count);
+		bytes.reserve(count * 2 * 2);
+		for (unsigned s = 0; s < 2; s++) {
+			for (size_t i = 0; i < count; i++) {
+				uint32_t a, b;
+				memcpy(&a, &streams[s][i], sizeof(float));
+				memcpy(&b, &previousStreams[s][i], sizeof(float));
+				WriteVarint(bytes, ZigZag((int32_t)(a - b)));
+			}
+		}
+	}
+
+
+	bool SimpleGeometrySequence::decodeInto(const std::vector<uint8_t>& bytes, const Frame* previous, Frame& frame) {
+		float* streams[2] = {
+			reinterpret_cast<float*>(frame.positions.data()),
+			reinterpret_cast<float*>(frame.normals.data())
+		};
+		size_t count = frame.positions.size() * 3;
+
+		if (!previous) {
+			if (bytes.size() != 2 * count * sizeof(float))
+				return false;
+			memcpy(streams[0], bytes.data(), count * sizeof(float));
+			memcpy(streams[1], bytes.data() + count * sizeof(float), count * sizeof(float));
+			return true;
+		}
+
+		if (previous->positions.size() != frame.positions.size())
+			return false;
+		const float* previousStreams[2];
+		FrameStreams(*previous, previousStreams, count);
+		const uint8_t* p = bytes.data();
+		const uint8_t* end = p + bytes.size();
+		for (unsigned s = 0; s < 2; s++) {
+			for (size_t i = 0; i < count; i++) {
+				uint32_t x, b;
+				if (!ReadVarint(p, end, x))
+					return false;
+				memcpy(&b, &previousStreams[s][i], sizeof(float));
+				uint32_t a = b + (uint32_t)UnZigZag(x);
+				memcpy(&streams[s][i], &a, sizeof(float));
+			}
+		}
+		return p == end;
+	}
+} // namespace Fluxions
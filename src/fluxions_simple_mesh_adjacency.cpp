@@ -0,0 +1,281 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_mesh_adjacency.hpp>
+
+namespace Fluxions {
+	namespace {
+		// The vertex pair of a half-edge with the smaller vertex in the upper bits
+		struct EdgeKey {
+			uint64_t key;
+			unsigned halfEdge;
+
+			bool operator<(const EdgeKey& other) const {
+				return key < other.key || (key == other.key && halfEdge < other.halfEdge);
+			}
+		};
+
+		constexpr size_t MinParallelRange = 16384;
+	}
+
+
+	bool SimpleMeshAdjacency::build(const SimpleGeometryMesh& mesh, bool weldPositions) {
+		clear();
+		vertexCount_ = (unsigned)mesh.Vertices.size();
+		topologyRevision_ = mesh.topologyRevision();
+		welded_ = weldPositions;
+		if (weldPositions)
+			weld(mesh);
+
+		const auto& indices = mesh.Indices.vec();
+		for (const auto& surface : mesh.Surfaces) {
+			if (surface.mode != SimpleGeometryMesh::SurfaceType::Triangles)
+				continue;
+			unsigned last = std::min<unsigned>(surface.first + surface.count - surface.count % 3, (unsigned)indices.size());
+			for (unsigned i = surface.first; i + 3 <= last; i += 3) {
+				unsigned v0 = canonicalVertex(indices[i]);
+				unsigned v1 = canonicalVertex(indices[i + 1]);
+				unsigned v2 = canonicalVertex(indices[i + 2]);
+				if (v0 >= vertexCount_ || v1 >= vertexCount_ || v2 >= vertexCount_ ||
+					v0 == v1 || v1 == v2 || v2 == v0) {
+					degenerateCount_++;
+					continue;
+				}
+				corners_.push_back(v0);
+				corners_.push_back(v1);
+				corners_.push_back(v2);
+				meshIndices_.push_back(i);
+				meshIndices_.push_back(i + 1);
+				meshIndices_.push_back(i + 2);
+			}
+		}
+
+		if (corners_.empty()) {
+			HFLOGWARN("'%s' ... has no triangles for adjacency", mesh.name_cstr());
+			return false;
+		}
+
+		matchEdges();
+		buildVertexRows();
+		classifyVertices();
+		return true;
+	}
+
+
+	bool SimpleMeshAdjacency::isCurrent(const SimpleGeometryMesh& mesh) const {
+		return !corners_.empty() &&
+			topologyRevision_ != SimpleGeometryMesh::PendingTopologyRevision &&
+			topologyRevision_ == mesh.topologyRevision() &&
+			vertexCount_ == (unsigned)mesh.Vertices.size();
+	}
+
+
+	void SimpleMeshAdjacency::clear() {
+		vertexCount_ = 0;
+		degenerateCount_ = 0;
+		topologyRevision_ = SimpleGeometryMesh::PendingTopologyRevision;
+		welded_ = false;
+		corners_.clear();
+		meshIndices_.clear();
+		twins_.clear();
+		canonical_.clear();
+		vertexFlags_.clear();
+		ringOffsets_.clear();
+		ring_.clear();
+		cornerOffsets_.clear();
+		vertexCorners_.clear();
+		boundaryEdges_.clear();
+		nonManifoldEdges_.clear();
+		nonManifoldVertices_.clear();
+	}
+
+
+	size_t SimpleMeshAdjacency::sizeInBytes() const {
+		return sizeof(SimpleMeshAdjacency) +
+			sizeof(unsigned) * (corners_.size() + meshIndices_.size() + twins_.size() +
+								canonical_.size() + ringOffsets_.size() + ring_.size() +
+								cornerOffsets_.size() + vertexCorners_.size() +
+								boundaryEdges_.size() + nonManifoldEdges_.size() + nonManifoldVertices_.size()) +
+			vertexFlags_.size();
+	}
+
+
+	void SimpleMeshAdjacency::weld(const SimpleGeometryMesh& mesh) {
+		const auto& vertices = mesh.Vertices.vec();
+		std::vector<unsigned> order(vertexCount_);
+		for (unsigned i = 0; i < vertexCount_; i++) {
+			order[i] = i;
+		}
+
+		// equal positions become neighbours, with the lowest index first
+		ParallelSort(order.begin(), order.end(), [&vertices](unsigned a, unsigned b) {
+			const Vector3f& pa = vertices[a].position;
+			const Vector3f& pb = vertices[b].position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			if (pa.z != pb.z) return pa.z < pb.z;
+			return a < b;
+		}, MinParallelRange);
+
+		canonical_.resize(vertexCount_);
+		unsigned canonical = 0;
+		for (unsigned i = 0; i < vertexCount_; i++) {
+			const Vector3f& p = vertices[order[i]].position;
+			const Vector3f& q = vertices[order[i > 0 ? i - 1 : 0]].position;
+			if (i == 0 || p.x != q.x || p.y != q.y || p.z != q.z)
+				canonical = order[i];
+			canonical_[order[i]] = canonical;
+		}
+	}
+
+
+	void SimpleMeshAdjacency::matchEdges() {
+		const unsigned cornerCount = (unsigned)corners_.size();
+		std::vector<EdgeKey> edges(cornerCount);
+		ParallelFor(cornerCount, MinParallelRange, [this, &edges](size_t first, size_t last) {
+			for (size_t c = first; c < last; c++) {
+				unsigned a = corners_[c];
+				unsigned b = corners_[next((unsigned)c)];
+				if (a > b) std::swap(a, b);
+				edges[c].key = ((uint64_t)a << 32) | b;
+				edges[c].halfEdge = (unsigned)c;
+			}
+		});
+		ParallelSort(edges.begin(), edges.end(), std::less<EdgeKey>(), MinParallelRange);
+
+		// each run of equal keys is one edge
+		twins_.assign(cornerCount, Boundary);
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j].key == edges[i].key) {
+				j++;
+			}
+			unsigned h0 = edges[i].halfEdge;
+			if (j - i == 1) {
+				boundaryEdges_.push_back(h0);
+			}
+			else {
+				unsigned h1 = edges[i + 1].halfEdge;
+				// a manifold edge is traversed once in each direction
+				if (j - i == 2 && corners_[h0] == corners_[next(h1)]) {
+					twins_[h0] = h1;
+					twins_[h1] = h0;
+				}
+				else {
+					for (size_t k = i; k < j; k++) {
+						twins_[edges[k].halfEdge] = NonManifold;
+					}
+					nonManifoldEdges_.push_back(h0);
+				}
+			}
+			i = j;
+		}
+	}
+
+
+	void SimpleMeshAdjacency::buildVertexRows() {
+		const unsigned cornerCount = (unsigned)corners_.size();
+
+		// corners of each vertex with a counting sort, so they stay in corner order
+		cornerOffsets_.assign((size_t)vertexCount_ + 1, 0);
+		for (unsigned c = 0; c < cornerCount; c++) {
+			cornerOffsets_[corners_[c] + 1]++;
+		}
+		for (unsigned v = 0; v < vertexCount_; v++) {
+			cornerOffsets_[v + 1] += cornerOffsets_[v];
+		}
+		vertexCorners_.resize(cornerCount);
+		std::vector<unsigned> cursor(cornerOffsets_.begin(), cornerOffsets_.end() - 1);
+		for (unsigned c = 0; c < cornerCount; c++) {
+			vertexCorners_[cursor[corners_[c]]++] = c;
+		}
+
+		// each corner adds the two other vertices of its triangle, then each row is
+		// sorted and duplicates from the neighbouring faces are removed
+		std::vector<unsigned> rows(2 * (size_t)cornerCount);
+		std::vector<unsigned> rowSizes(vertexCount_, 0);
+		ParallelFor(vertexCount_, 4096, [&](size_t first, size_t last) {
+			for (size_t v = first; v < last; v++) {
+				unsigned* row = rows.data() + 2 * (size_t)cornerOffsets_[v];
+				unsigned count = 0;
+				for (unsigned i = cornerOffsets_[v]; i < cornerOffsets_[v + 1]; i++) {
+					unsigned c = vertexCorners_[i];
+					row[count++] = corners_[next(c)];
+					row[count++] = corners_[prev(c)];
+				}
+				std::sort(row, row + count);
+				rowSizes[v] = (unsigned)(std::unique(row, row + count) - row);
+			}
+		});
+
+		ringOffsets_.assign((size_t)vertexCount_ + 1, 0);
+		for (unsigned v = 0; v < vertexCount_; v++) {
+			ringOffsets_[v + 1] = ringOffsets_[v] + rowSizes[v];
+		}
+		ring_.resize(ringOffsets_[vertexCount_]);
+		ParallelFor(vertexCount_, 4096, [&](size_t first, size_t last) {
+			for (size_t v = first; v < last; v++) {
+				const unsigned* row = rows.data() + 2 * (size_t)cornerOffsets_[v];
+				std::copy(row, row + rowSizes[v], ring_.data() + ringOffsets_[v]);
+			}
+		});
+	}
+
+
+	void SimpleMeshAdjacency::classifyVertices() {
+		vertexFlags_.assign(vertexCount_, 0);
+		ParallelFor(vertexCount_, 4096, [this](size_t first, size_t last) {
+			for (size_t v = first; v < last; v++) {
+				Range corners = range(cornerOffsets_, vertexCorners_, (unsigned)v);
+				if (corners.empty())
+					continue;
+
+				uint8_t flags = 0;
+				for (unsigned c : corners) {
+					// the edges leaving and entering v in this triangle
+					unsigned out = twins_[c];
+					unsigned in = twins_[prev(c)];
+					if (out == Boundary || in == Boundary)
+						flags |= BoundaryVertex;
+					if (out == NonManifold || in == NonManifold)
+						flags |= NonManifoldVertex;
+				}
+
+				if (!(flags & NonManifoldVertex)) {
+					// walk the fan around v in both directions from the first corner,
+					// a manifold vertex reaches every one of its corners
+					size_t reached = 1;
+					unsigned start = corners[0];
+					unsigned c = start;
+					bool closed = false;
+					while (reached <= corners.size()) {
+						unsigned h = twins_[prev(c)];
+						if (h >= NonManifold)
+							break;
+						c = h;
+						if (c == start) {
+							closed = true;
+							break;
+						}
+						reached++;
+					}
+					c = start;
+					while (!closed && reached <= corners.size()) {
+						unsigned h = twins_[c];
+						if (h >= NonManifold)
+							break;
+						c = next(h);
+						reached++;
+					}
+					if (reached != corners.size())
+						flags |= NonManifoldVertex;
+				}
+				vertexFlags_[v] = flags;
+			}
+		});
+
+		for (unsigned v = 0; v < vertexCount_; v++) {
+			if (vertexFlags_[v] & NonManifoldVertex)
+				nonManifoldVertices_.push_back(v);
+		}
+	}
+} // namespace Fluxions
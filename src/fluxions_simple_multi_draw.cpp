@@ -0,0 +1,71 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_simple_multi_draw.hpp>
+
+namespace Fluxions {
+	void SimpleMultiDrawBatch::clear() {
+		batches_.clear();
+		commands_.clear();
+		counts_.clear();
+		offsets_.clear();
+		splitNext_ = true;
+	}
+
+
+	void SimpleMultiDrawBatch::reserve(size_t commandCount) {
+		commands_.reserve(commandCount);
+		counts_.reserve(commandCount);
+		offsets_.reserve(commandCount);
+	}
+
+
+	unsigned SimpleMultiDrawBatch::add(GLuint vao, GLenum mode, GLsizei count, GLsizeiptr offsetInBytes, size_t indexSize) {
+		if (splitNext_ || batches_.empty() || batches_.back().vao != vao || batches_.back().mode != mode) {
+			Batch batch;
+			batch.vao = vao;
+			batch.mode = mode;
+			batch.firstCommand = (unsigned)commands_.size();
+			batches_.push_back(batch);
+			splitNext_ = false;
+		}
+
+		DrawElementsIndirectCommand command;
+		command.count = (GLuint)count;
+		command.firstIndex = (GLuint)(offsetInBytes / (GLsizeiptr)indexSize);
+		commands_.push_back(command);
+		counts_.push_back(count);
+		offsets_.push_back((const GLvoid*)offsetInBytes);
+		batches_.back().commandCount++;
+		return (unsigned)batches_.size() - 1;
+	}
+
+
+	void RadixSort(std::vector<uint64_t>& keys, std::vector<unsigned>& values) {
+		const size_t count = keys.size();
+		if (count < 2)
+			return;
+		std::vector<uint64_t> sortedKeys(count);
+		std::vector<unsigned> sortedValues(count);
+		std::vector<size_t> offsets(65536);
+		for (unsigned shift = 0; shift < 64; shift += 16) {
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (uint64_t key : keys) {
+				offsets[(key >> shift) & 0xffff]++;
+			}
+			if (offsets[(keys[0] >> shift) & 0xffff] == count)
+				continue;
+			size_t sum = 0;
+			for (auto& offset : offsets) {
+				size_t digitCount = offset;
+				offset = sum;
+				sum += digitCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				size_t j = offsets[(keys[i] >> shift) & 0xffff]++;
+				sortedKeys[j] = keys[i];
+				sortedValues[j] = values[i];
+			}
+			keys.swap(sortedKeys);
+			values.swap(sortedValues);
+		}
+	}
+} // namespace Fluxions
@@ -0,0 +1,232 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_occlusion_culler.hpp>
+
+namespace Fluxions {
+	namespace {
+		// points closer to the eye than this are treated as crossing the near plane
+		constexpr float MinW = 1e-5f;
+
+		// the pixel containing v, clamped in float so huge coordinates convert safely
+		inline int PixelOf(float v, int size) {
+			return (int)floorf(std::min(std::max(v, -1.0f), (float)size));
+		}
+
+		// the first pixel whose center is at or after v
+		inline int PixelCenterAfter(float v, int size) {
+			return (int)ceilf(std::min(std::max(v - 0.5f, -1.0f), (float)size));
+		}
+	}
+
+
+	void SimpleOcclusionCuller::setResolution(unsigned width, unsigned height) {
+		tilesX_ = std::max(1u, (width + TileSize - 1) / TileSize);
+		tilesY_ = std::max(1u, (height + TileSize - 1) / TileSize);
+		width_ = tilesX_ * TileSize;
+		height_ = tilesY_ * TileSize;
+
+		levels_.clear();
+		unsigned w = width_;
+		unsigned h = height_;
+		for (;;) {
+			Level level;
+			level.width = w;
+			level.height = h;
+			level.depth.assign((size_t)w * h, 1.0f);
+			levels_.push_back(std::move(level));
+			if (w == 1 && h == 1)
+				break;
+			w = (w + 1) / 2;
+			h = (h + 1) / 2;
+		}
+		bins_.assign((size_t)tilesX_ * tilesY_, std::vector<unsigned>());
+	}
+
+
+	void SimpleOcclusionCuller::beginFrame(const Matrix4f& m) {
+		const float rows[4][4] = {
+			{ m.m11, m.m12, m.m13, m.m14 },
+			{ m.m21, m.m22, m.m23, m.m24 },
+			{ m.m31, m.m32, m.m33, m.m34 },
+			{ m.m41, m.m42, m.m43, m.m44 }
+		};
+		memcpy(rows_, rows, sizeof(rows_));
+		triangles_.clear();
+		for (auto& bin : bins_) {
+			bin.clear();
+		}
+	}
+
+
+	void SimpleOcclusionCuller::addTriangle(const float clip[3][4]) {
+		float x[3], y[3], z[3];
+		for (unsigned k = 0; k < 3; k++) {
+			const float w = clip[k][3];
+			if (w < MinW || clip[k][2] < -w)
+				return;
+			const float invW = 0.5f / w;
+			x[k] = (clip[k][0] * invW + 0.5f) * width_;
+			y[k] = (clip[k][1] * invW + 0.5f) * height_;
+			z[k] = clip[k][2] * invW + 0.5f;
+		}
+
+		const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area == 0.0f || !std::isfinite(area))
+			return;
+
+		// only pixels whose centers are inside the bounds can be covered, so most
+		// triangles smaller than a pixel are dropped here
+		Triangle t;
+		t.minX = std::max(0, PixelCenterAfter(std::min({ x[0], x[1], x[2] }), width_));
+		t.minY = std::max(0, PixelCenterAfter(std::min({ y[0], y[1], y[2] }), height_));
+		t.maxX = std::min((int)width_ - 1, PixelOf(std::max({ x[0], x[1], x[2] }) - 0.5f, width_));
+		t.maxY = std::min((int)height_ - 1, PixelOf(std::max({ y[0], y[1], y[2] }) - 0.5f, height_));
+		if (t.minX > t.maxX || t.minY > t.maxY)
+			return;
+
+		// both windings are kept, so the edges are flipped to be positive inside
+		const float sign = area > 0.0f ? 1.0f : -1.0f;
+		for (unsigned k = 0; k < 3; k++) {
+			const unsigned k1 = (k + 1) % 3;
+			t.edge[k][0] = sign * (y[k] - y[k1]);
+			t.edge[k][1] = sign * (x[k1] - x[k]);
+			t.edge[k][2] = sign * (x[k] * y[k1] - y[k] * x[k1]);
+		}
+
+		// the depth at a pixel center plus its change to the farthest corner
+		const float a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		const float b = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		t.zPlane[0] = a;
+		t.zPlane[1] = b;
+		t.zPlane[2] = z[0] - a * x[0] - b * y[0] + 0.5f * (fabsf(a) + fabsf(b));
+		t.zMax = std::min(1.0f, std::max({ z[0], z[1], z[2] }));
+
+		const unsigned index = (unsigned)triangles_.size();
+		triangles_.push_back(t);
+		for (int ty = t.minY / (int)TileSize; ty <= t.maxY / (int)TileSize; ty++) {
+			for (int tx = t.minX / (int)TileSize; tx <= t.maxX / (int)TileSize; tx++) {
+				bins_[ty * tilesX_ + tx].push_back(index);
+			}
+		}
+	}
+
+
+	void SimpleOcclusionCuller::rasterize(unsigned threadCount) {
+		ParallelFor(bins_.size(), 1, [&](size_t first, size_t last) {
+			for (size_t tile = first; tile < last; tile++) {
+				rasterizeTile((unsigned)tile);
+			}
+		}, threadCount);
+
+		// each texel of a level is the farthest depth of the up to 2x2 texels below it
+		for (size_t l = 1; l < levels_.size(); l++) {
+			const Level& below = levels_[l - 1];
+			Level& level = levels_[l];
+			ParallelFor(level.height, 16, [&](size_t first, size_t last) {
+				for (size_t y = first; y < last; y++) {
+					const size_t y0 = 2 * y;
+					const size_t y1 = std::min<size_t>(y0 + 1, below.height - 1);
+					for (size_t x = 0; x < level.width; x++) {
+						const size_t x0 = 2 * x;
+						const size_t x1 = std::min<size_t>(x0 + 1, below.width - 1);
+						level.depth[y * level.width + x] = std::max(
+							std::max(below.depth[y0 * below.width + x0], below.depth[y0 * below.width + x1]),
+							std::max(below.depth[y1 * below.width + x0], below.depth[y1 * below.width + x1]));
+					}
+				}
+			}, threadCount);
+		}
+	}
+
+
+	void SimpleOcclusionCuller::rasterizeTile(unsigned tile) {
+		Level& level = levels_[0];
+		const int tileX = (int)(tile % tilesX_) * (int)TileSize;
+		const int tileY = (int)(tile / tilesX_) * (int)TileSize;
+		for (int y = tileY; y < tileY + (int)TileSize; y++) {
+			std::fill_n(level.depth.begin() + (size_t)y * width_ + tileX, TileSize, 1.0f);
+		}
+
+		float px[BlockSize];
+		for (unsigned j = 0; j < BlockSize; j++) {
+			px[j] = (float)j + 0.5f;
+		}
+
+		for (unsigned index : bins_[tile]) {
+			const Triangle& t = triangles_[index];
+			const int x0 = std::max(t.minX, tileX);
+			const int x1 = std::min(t.maxX, tileX + (int)TileSize - 1);
+			const int y0 = std::max(t.minY, tileY);
+			const int y1 = std::min(t.maxY, tileY + (int)TileSize - 1);
+			for (int y = y0; y <= y1; y++) {
+				const float cy = (float)y + 0.5f;
+				float* row = level.depth.data() + (size_t)y * width_;
+				for (int x = x0; x <= x1; x += BlockSize) {
+					const float bx = (float)x;
+					const int n = std::min((int)BlockSize, x1 + 1 - x);
+					float depth[BlockSize];
+					for (unsigned j = 0; j < BlockSize; j++) {
+						const float cx = bx + px[j];
+						const float e0 = t.edge[0][0] * cx + t.edge[0][1] * cy + t.edge[0][2];
+						const float e1 = t.edge[1][0] * cx + t.edge[1][1] * cy + t.edge[1][2];
+						const float e2 = t.edge[2][0] * cx + t.edge[2][1] * cy + t.edge[2][2];
+						const float z = std::min(t.zMax, t.zPlane[0] * cx + t.zPlane[1] * cy + t.zPlane[2]);
+						const bool inside = e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f;
+						depth[j] = inside ? z : 1.0f;
+					}
+					for (int j = 0; j < n; j++) {
+						row[x + j] = std::min(row[x + j], depth[j]);
+					}
+				}
+			}
+		}
+	}
+
+
+	bool SimpleOcclusionCuller::isOccluded(const BoundingBoxf& box) const {
+		if (box.minBounds.x > box.maxBounds.x)
+			return false;
+
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		float nearest = FLT_MAX;
+		for (unsigned i = 0; i < 8; i++) {
+			const GLfloat p[3] = {
+				(i & 1) ? box.maxBounds.x : box.minBounds.x,
+				(i & 2) ? box.maxBounds.y : box.minBounds.y,
+				(i & 4) ? box.maxBounds.z : box.minBounds.z
+			};
+			float clip[4];
+			transform(p, clip);
+			if (clip[3] < MinW || clip[2] < -clip[3])
+				return false;
+			const float sx = (clip[0] / clip[3] * 0.5f + 0.5f) * width_;
+			const float sy = (clip[1] / clip[3] * 0.5f + 0.5f) * height_;
+			minX = std::min(minX, sx);
+			minY = std::min(minY, sy);
+			maxX = std::max(maxX, sx);
+			maxY = std::max(maxY, sy);
+			nearest = std::min(nearest, clip[2] / clip[3] * 0.5f + 0.5f);
+		}
+		if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width_ || minY >= (float)height_)
+			return false;
+
+		const int x0 = std::max(0, PixelOf(minX, width_));
+		const int y0 = std::max(0, PixelOf(minY, height_));
+		const int x1 = std::min((int)width_ - 1, PixelOf(maxX, width_));
+		const int y1 = std::min((int)height_ - 1, PixelOf(maxY, height_));
+
+		// the level where the box covers at most 4x4 texels
+		unsigned l = 0;
+		while (l + 1 < levels_.size() && ((x1 >> l) - (x0 >> l) > 3 || (y1 >> l) - (y0 >> l) > 3)) {
+			l++;
+		}
+		const Level& level = levels_[l];
+		for (int y = y0 >> l; y <= (y1 >> l); y++) {
+			for (int x = x0 >> l; x <= (x1 >> l); x++) {
+				if (nearest <= level.depth[(size_t)y * level.width + x])
+					return false;
+			}
+		}
+		return true;
+	}
+} // namespace Fluxions
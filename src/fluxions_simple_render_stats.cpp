@@ -0,0 +1,56 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_simple_render_stats.hpp>
+
+namespace Fluxions {
+	void SimpleStreamMetricsSink::metric(const std::string& name, double value) {
+		out_ << name << " " << value << "\n";
+	}
+
+
+	void SimpleRenderPassStats::add(const SimpleRenderPassStats& other) {
+		calls += other.calls;
+		drawCalls += other.drawCalls;
+		vaoSwitches += other.vaoSwitches;
+		indices += other.indices;
+		bytesUploaded += other.bytesUploaded;
+		surfacesDrawn += other.surfacesDrawn;
+		surfacesCulled += other.surfacesCulled;
+		cpuMilliseconds += other.cpuMilliseconds;
+		gpuMilliseconds += other.gpuMilliseconds;
+		gpuTimerCount += other.gpuTimerCount;
+	}
+
+
+	SimpleRenderPassStats SimpleRenderStats::total() const {
+		SimpleRenderPassStats sum;
+		for (auto& it : passes_) {
+			sum.add(it.second);
+		}
+		return sum;
+	}
+
+
+	void SimpleRenderStats::reset() {
+		for (auto& it : passes_) {
+			it.second = SimpleRenderPassStats();
+		}
+	}
+
+
+	void SimpleRenderStats::exportTo(SimpleMetricsSink& sink, const std::string& prefix) const {
+		for (auto& it : passes_) {
+			const std::string name = prefix + it.first + ".";
+			const SimpleRenderPassStats& stats = it.second;
+			sink.metric(name + "calls", (double)stats.calls);
+			sink.metric(name + "drawCalls", (double)stats.drawCalls);
+			sink.metric(name + "vaoSwitches", (double)stats.vaoSwitches);
+			sink.metric(name + "indices", (double)stats.indices);
+			sink.metric(name + "bytesUploaded", (double)stats.bytesUploaded);
+			sink.metric(name + "surfacesDrawn", (double)stats.surfacesDrawn);
+			sink.metric(name + "surfacesCulled", (double)stats.surfacesCulled);
+			sink.metric(name + "cpuMilliseconds", stats.cpuMilliseconds);
+			if (stats.gpuTimerCount > 0)
+				sink.metric(name + "gpuMilliseconds", stats.gpuMilliseconds);
+		}
+	}
+} // namespace Fluxions
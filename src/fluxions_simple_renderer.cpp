@@ -1,7 +1,97 @@
 #include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
 #include <fluxions_simple_renderer.hpp>
 
 namespace Fluxions {
+	namespace {
+		// Fills the slow vertex attributes 0, 1, and 2 with the position, normal, and texcoord
+		inline void ConvertMeshVertex(const SimpleGeometryMesh::Vertex& v, const Vector3f& offset,
+									  SimpleSlowVertex& slow, SimpleZVertex& z) {
+			GLfloat(*attrib)[4] = slow.attrib;
+			attrib[0][0] = v.position.x + offset.x;
+			attrib[0][1] = v.position.y + offset.y;
+			attrib[0][2] = v.position.z + offset.z;
+			attrib[0][3] = 1.0f;
+			attrib[1][0] = v.normal.x;
+			attrib[1][1] = v.normal.y;
+			attrib[1][2] = v.normal.z;
+			attrib[1][3] = 1.0f;
+			attrib[2][0] = v.texcoord.x;
+			attrib[2][1] = v.texcoord.y;
+			attrib[2][2] = 0.0f;
+			attrib[2][3] = 1.0f;
+			z.position[0] = attrib[0][0];
+			z.position[1] = attrib[0][1];
+			z.position[2] = attrib[0][2];
+		}
+
+		// Buffer sections are sized exactly when first built and grow by half when they overflow
+		GLsizeiptr GrowCapacity(GLsizeiptr capacity, GLsizeiptr bytes) {
+			constexpr GLsizeiptr alignment = 256;
+			if (bytes <= capacity && capacity > 0)
+				return capacity;
+			if (capacity > 0)
+				bytes = std::max(bytes, capacity + capacity / 2);
+			return std::max(alignment, (bytes + alignment - 1) / alignment * alignment);
+		}
+
+		struct BufferMove {
+			GLsizeiptr from;
+			GLsizeiptr to;
+			GLsizeiptr size;
+		};
+
+		// Replaces buffer with one of newSize bytes and copies the moves from the old buffer on the GPU
+		void ReallocateBuffer(GLenum target, GLuint& buffer, GLsizeiptr newSize, std::initializer_list<BufferMove> moves) {
+			GLuint newBuffer = 0;
+			FxCreateBuffer(target, &newBuffer, newSize, nullptr, GL_STATIC_DRAW);
+			glBufferData(target, newSize, nullptr, GL_STATIC_DRAW);
+			if (buffer) {
+				FxBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				FxBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+				for (const BufferMove& move : moves) {
+					if (move.size > 0)
+						glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.from, move.to, move.size);
+				}
+				FxBindBuffer(GL_COPY_READ_BUFFER, 0);
+				FxBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				FxDeleteBuffer(&buffer);
+			}
+			buffer = newBuffer;
+		}
+
+		// Uploads are split into chunks so the driver never stages a whole section at once
+		constexpr GLsizeiptr UploadChunkSize = 16 << 20;
+
+		// Uploads the bytes of a section after the uploaded part into the bound buffer at offset.
+		// data holds the section from byte dataOffset onwards. Chunks are written into the mapped
+		// buffer when glMapBufferRange() is available.
+		void UploadSection(GLenum target, GLsizeiptr offset, GLsizeiptr& uploaded, const void* data, GLsizeiptr dataOffset, GLsizeiptr bytes) {
+			const bool canMap = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+			for (GLsizeiptr first = uploaded; first < bytes; first += UploadChunkSize) {
+				const GLsizeiptr size = std::min(UploadChunkSize, bytes - first);
+				const GLubyte* src = (const GLubyte*)data + (first - dataOffset);
+				void* dst = nullptr;
+				if (canMap)
+					dst = glMapBufferRange(target, offset + first, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+				if (dst) {
+					memcpy(dst, src, size);
+					if (glUnmapBuffer(target) == GL_TRUE)
+						continue;
+				}
+				glBufferSubData(target, offset + first, size, src);
+			}
+			uploaded = std::max(uploaded, bytes);
+		}
+
+		// Frees the memory of an uploaded vector and counts its elements as released
+		template <typename T>
+		void ReleaseVector(std::vector<T>& v, size_t& released) {
+			released += v.size();
+			std::vector<T>().swap(v);
+		}
+	}
+
 	// explicit template instantiation is after the implementation
 
 	template <typename IndexType, GLenum GLIndexType>
@@ -14,6 +104,11 @@ namespace Fluxions {
 	template <typename IndexType, GLenum GLIndexType>
 	SimpleRenderer<IndexType, GLIndexType>::~SimpleRenderer() {
 		reset(false);
+		for (TIMERQUERY& pending : pendingTimerQueries) {
+			freeTimerQueries.push_back(pending.query);
+		}
+		if (!freeTimerQueries.empty())
+			glDeleteQueries((GLsizei)freeTimerQueries.size(), freeTimerQueries.data());
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
@@ -24,6 +119,7 @@ namespace Fluxions {
 		}
 
 		isMakingSurface = true;
+		drawListsDirty = true;
 		if (surfaces.empty() || surfaces[currentSurface].count > 0) {
 			surfaces.push_back(SimpleSurface());
 		}
@@ -39,17 +135,17 @@ namespace Fluxions {
 		surfaces[currentSurface].first = 0;
 		switch (surfaces[currentSurface].vertexType) {
 		case VertexType::FAST_VERTEX:
-			surfaces[currentSurface].first = (int)fastVertices.size();
+			surfaces[currentSurface].first = (int)FastVertexCount();
 			break;
 		case VertexType::SLOW_VERTEX:
-			surfaces[currentSurface].first = (int)slowVertices.size();
+			surfaces[currentSurface].first = (int)SlowVertexCount();
 			break;
 		case VertexType::UNDECIDED:
 		default:
 			break;
 		}
-		surfaces[currentSurface].firstIndex = (int)indices.size();
-		surfaces[currentSurface].firstZIndex = (int)zIndices.size();
+		surfaces[currentSurface].firstIndex = (int)IndexCount();
+		surfaces[currentSurface].firstZIndex = (int)ZIndexCount();
 
 		// OBJECT, GROUP, MTLLIB, MTL
 		surfaces[currentSurface].objectName = currentObjectName;
@@ -69,6 +165,7 @@ namespace Fluxions {
 		if (isMakingSurface) {
 			isMakingSurface = false;
 		}
+		drawListsDirty = true;
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
@@ -79,45 +176,103 @@ namespace Fluxions {
 		if (isMakingSurface)
 			return;
 
-		baseZIndex = (IndexType)zVertices.size();
-		baseFastIndex = (IndexType)fastVertices.size();
-		baseSlowIndex = (IndexType)slowVertices.size();
+		baseZIndex = (IndexType)ZVertexCount();
+		baseFastIndex = (IndexType)FastVertexCount();
+		baseSlowIndex = (IndexType)SlowVertexCount();
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::DrawOBJ(const SimpleGeometryMesh& obj) {
-		int curIndex;
-
-		vertexCount += (int)obj.Vertices.size();
+		const auto& objVertices = obj.Vertices.vec();
+		const auto& objIndices = obj.Indices.vec();
+		vertexCount += (int)objVertices.size();
 
+		// The vertices become slow vertices with the same result as calling VertexAttrib4f()
+		// for the normal, texcoord, and position of each one, but converted in one pass
 		Begin(GL_TRIANGLES, true);
-		curIndex = 0;
-		for (const auto& vertex : obj.Vertices) {
-			VertexAttrib4f(1, vertex.normal.x, vertex.normal.y, vertex.normal.z, 1.0f);
-			VertexAttrib4f(2, vertex.texcoord.x, vertex.texcoord.y, 0.0f, 1.0f);
-			VertexAttrib4f(0, vertex.position.x, vertex.position.y, vertex.position.z, 1.0f);
-			curIndex++;
+		if (!objVertices.empty()) {
+			// switches to slow vertices and resets the index bases exactly as the first
+			// VertexAttrib4f() call would, so callers can keep relying on the running base
+			HandleVertexTypeChange(VertexType::SLOW_VERTEX);
+			const size_t firstSlow = slowVertices.size();
+			const size_t firstZ = zVertices.size();
+			slowVertices.resize(firstSlow + objVertices.size(), currentSlowVertex);
+			zVertices.resize(firstZ + objVertices.size());
+			SimpleSlowVertex* slow = slowVertices.data() + firstSlow;
+			SimpleZVertex* z = zVertices.data() + firstZ;
+			const SimpleGeometryMesh::Vertex* v = objVertices.data();
+			ParallelFor(objVertices.size(), 65536, [=](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++) {
+					ConvertMeshVertex(v[i], Vector3f(), slow[i], z[i]);
+				}
+			});
+			currentSlowVertex = slowVertices.back();
 		}
 		End();
 
-		for (const auto& surface : obj.Surfaces) {
+		// bounds are lazy, so only surfaces of meshes that computed them can be culled
+		const bool hasBounds = obj.hasAttributes(SimpleGeometryMesh::BoundsAttribute);
+
+		// renderer surface for each mesh surface, used to share index ranges
+		std::vector<unsigned> meshSurfaceToSurface(obj.Surfaces.size(), 0);
+		for (size_t s = 0; s < obj.Surfaces.size(); s++) {
+			const auto& surface = obj.Surfaces[s];
 			triangleCount += surface.count / 3;
+			const bool isInstance = surface.instanceOf >= 0 && (size_t)surface.instanceOf < s && surface.count > 0;
+			const Vector3f& offset = surface.instanceOffset;
+			if (isInstance && offset.x == 0.0f && offset.y == 0.0f && offset.z == 0.0f) {
+				// Exact duplicates reuse the indices emitted for the owning surface
+				unsigned owner = meshSurfaceToSurface[surface.instanceOf];
+				SimpleSurface instance = surfaces[owner];
+				instance.mtlName = surface.materialName;
+				instance.mtlId = surface.materialId;
+				instance.drawMtlId = surface.materialId;
+				instance.instanceOf = (GLint)owner;
+				instance.hasBounds = hasBounds;
+				instance.boundingBox = surface.boundingBox;
+				instance.sphereCenter = surface.sphereCenter;
+				instance.sphereRadius = surface.sphereRadius;
+				surfaces.push_back(instance);
+				drawListsDirty = true;
+				currentSurface = (unsigned)surfaces.size() - 1;
+				meshSurfaceToSurface[s] = currentSurface;
+				continue;
+			}
+			if (isInstance) {
+				// Surfaces draw without a transform, so translated duplicates get their own
+				// translated copy of the shared vertices
+				SetCurrentMtlName(surface.materialName);
+				SetCurrentMtlId(surface.materialId);
+				AppendTranslatedSurface(objVertices, objIndices.data() + surface.first, surface.count, offset);
+				surfaces.back().drawMtlId = surface.materialId;
+				surfaces.back().hasBounds = hasBounds;
+				surfaces.back().boundingBox = surface.boundingBox;
+				surfaces.back().sphereCenter = surface.sphereCenter;
+				surfaces.back().sphereRadius = surface.sphereRadius;
+				meshSurfaceToSurface[s] = (unsigned)surfaces.size() - 1;
+				continue;
+			}
 			SetCurrentMtlName(surface.materialName);
 			SetCurrentMtlId(surface.materialId);
 			Begin(GL_TRIANGLES, true);
-			for (unsigned i = surface.first; i < surface.first + surface.count; i++) {
-				Index((IndexType)obj.Indices[i]);
-			}
+			AppendIndices(objIndices.data() + surface.first, surface.count);
 			End();
 			surfaces.back().drawMtlId = surface.materialId;
+			surfaces.back().hasBounds = hasBounds;
+			surfaces.back().boundingBox = surface.boundingBox;
+			surfaces.back().sphereCenter = surface.sphereCenter;
+			surfaces.back().sphereRadius = surface.sphereRadius;
+			meshSurfaceToSurface[s] = (unsigned)surfaces.size() - 1;
 		}
 		SetCurrentMtlName("");
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::ApplyIdToObjectNames(const std::string& objectName, GLuint id) {
+		drawListsDirty = true;
+		Symbol name = Symbol::Find(objectName);
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			if (surface->objectName == objectName) {
+			if (surface->objectName == name) {
 				surface->objectId = id;
 			}
 		}
@@ -125,8 +280,10 @@ namespace Fluxions {
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::ApplyIdToGroupNames(const std::string& groupName, GLuint id) {
+		drawListsDirty = true;
+		Symbol name = Symbol::Find(groupName);
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			if (surface->groupName == groupName) {
+			if (surface->groupName == name) {
 				surface->groupId = id;
 			}
 		}
@@ -134,8 +291,10 @@ namespace Fluxions {
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::ApplyIdToMtlLibNames(const std::string& mtllibName, GLuint id) {
+		drawListsDirty = true;
+		Symbol name = Symbol::Find(mtllibName);
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			if (surface->mtllibName == mtllibName) {
+			if (surface->mtllibName == name) {
 				surface->mtllibId = id;
 			}
 		}
@@ -143,8 +302,10 @@ namespace Fluxions {
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::ApplyIdToMtlNames(const std::string& mtlName, GLuint id) {
+		drawListsDirty = true;
+		Symbol name = Symbol::Find(mtlName);
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			if (surface->mtlName == mtlName) {
+			if (surface->mtlName == name) {
 				surface->mtlId = id;
 			}
 		}
@@ -152,14 +313,15 @@ namespace Fluxions {
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::AssignUniqueGroupIds() {
+		drawListsDirty = true;
 		GLuint groupId = 0;
-		std::map<std::string, GLuint> groups;
+		std::map<std::tuple<unsigned, unsigned, unsigned>, GLuint> groups;
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			std::string autoGenName = surface->objectName + " " + surface->mtllibName + " " + surface->mtlName;
-			auto it = groups.find(autoGenName);
+			auto key = std::make_tuple(surface->objectName.id(), surface->mtllibName.id(), surface->mtlName.id());
+			auto it = groups.find(key);
 			if (it == groups.end()) {
 				groupId++;
-				groups[autoGenName] = groupId;
+				groups[key] = groupId;
 				surface->groupId = groupId;
 			}
 			else {
@@ -182,29 +344,7 @@ namespace Fluxions {
 		if (!isMakingSurface)
 			return;
 
-		size_t maxIndex = 0;
-		switch (GLIndexType) {
-		case GL_BYTE:
-			maxIndex = 127LL;
-			break;
-		case GL_UNSIGNED_BYTE:
-			maxIndex = 255;
-			break;
-		case GL_SHORT:
-			maxIndex = 32767LL;
-			break;
-		case GL_UNSIGNED_SHORT:
-			maxIndex = 65535LL;
-			break;
-		case GL_INT:
-			maxIndex = 2147483647LL;
-			break;
-		case GL_UNSIGNED_INT:
-			maxIndex = 4294967295LL;
-			break;
-		}
-
-		if (index < (IndexType)0 || index >= (IndexType)maxIndex)
+		if (index < (IndexType)0 || index >= MaxIndex)
 			return;
 
 		// Handle the case if this is the first index
@@ -226,6 +366,73 @@ namespace Fluxions {
 		surfaces[currentSurface].zCount++;
 	}
 
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::AppendIndices(const unsigned* meshIndices, size_t count) {
+		// the same as calling Index() for each index, which skips the ones out of range
+		if (!isMakingSurface || count == 0)
+			return;
+		SimpleSurface& surface = surfaces[currentSurface];
+		const bool hasIndices = surface.vertexType == VertexType::FAST_VERTEX || surface.vertexType == VertexType::SLOW_VERTEX;
+		const IndexType base = surface.vertexType == VertexType::FAST_VERTEX ? baseFastIndex : baseSlowIndex;
+		const size_t firstIndex = indices.size();
+		const size_t firstZIndex = zIndices.size();
+		if (hasIndices)
+			indices.resize(firstIndex + count);
+		zIndices.resize(firstZIndex + count);
+		IndexType* out = indices.data() + firstIndex;
+		IndexType* zOut = zIndices.data() + firstZIndex;
+		size_t n = 0;
+		for (size_t i = 0; i < count; i++) {
+			const IndexType index = (IndexType)meshIndices[i];
+			if (index < (IndexType)0 || index >= MaxIndex)
+				continue;
+			if (hasIndices)
+				out[n] = base + index;
+			zOut[n] = baseZIndex + index;
+			n++;
+		}
+		if (hasIndices) {
+			indices.resize(firstIndex + n);
+			surface.count += (GLsizei)n;
+		}
+		zIndices.resize(firstZIndex + n);
+		surface.zCount += (GLsizei)n;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::AppendTranslatedSurface(const std::vector<SimpleGeometryMesh::Vertex>& meshVertices,
+																		 const unsigned* meshIndices, size_t count, const Vector3f& offset) {
+		// each vertex used by the range is copied once, in order of first use
+		std::unordered_map<unsigned, unsigned> remap;
+		std::vector<unsigned> localIndices(count);
+		for (size_t i = 0; i < count; i++) {
+			auto it = remap.emplace(meshIndices[i], (unsigned)remap.size()).first;
+			localIndices[i] = it->second;
+		}
+
+		const size_t firstSlow = slowVertices.size();
+		const size_t firstZ = zVertices.size();
+		slowVertices.resize(firstSlow + remap.size(), currentSlowVertex);
+		zVertices.resize(firstZ + remap.size());
+		for (auto& it : remap) {
+			if (it.first < meshVertices.size())
+				ConvertMeshVertex(meshVertices[it.first], offset, slowVertices[firstSlow + it.second], zVertices[firstZ + it.second]);
+		}
+		vertexCount += (int)remap.size();
+
+		// the copies start a new vertex range, then the running bases are restored
+		const IndexType savedZIndex = baseZIndex;
+		const IndexType savedSlowIndex = baseSlowIndex;
+		baseZIndex = (IndexType)(ZVertexCount() - remap.size());
+		baseSlowIndex = (IndexType)(SlowVertexCount() - remap.size());
+		Begin(GL_TRIANGLES, true);
+		surfaces[currentSurface].vertexType = VertexType::SLOW_VERTEX;
+		AppendIndices(localIndices.data(), count);
+		End();
+		baseZIndex = savedZIndex;
+		baseSlowIndex = savedSlowIndex;
+	}
+
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::Index(std::vector<IndexType> _indices) {
 		// a baseIndex of < 0 means to use the current surface first vertex as 0
@@ -241,9 +448,9 @@ namespace Fluxions {
 		}
 		if (lastVertexType != vertexType) {
 			// reset all the offsets because they're going to be completely different.
-			baseZIndex = (IndexType)zVertices.size();
-			baseFastIndex = (IndexType)fastVertices.size();
-			baseSlowIndex = (IndexType)slowVertices.size();
+			baseZIndex = (IndexType)ZVertexCount();
+			baseFastIndex = (IndexType)FastVertexCount();
+			baseSlowIndex = (IndexType)SlowVertexCount();
 		}
 		if (surfaces[currentSurface].vertexType != vertexType &&
 			surfaces[currentSurface].count == 0) {
@@ -348,59 +555,143 @@ namespace Fluxions {
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
-	void SimpleRenderer<IndexType, GLIndexType>::BuildMemoryBuffers() {
-		// determine size of memory buffers
-		bufferInfo.zVertexOffset = 0;
-		bufferInfo.zVertexSize = (int)zVertices.size() * sizeof(SimpleZVertex);
-		bufferInfo.fastVertexOffset = bufferInfo.zVertexOffset + bufferInfo.zVertexSize;
-		bufferInfo.fastVertexSize = (int)fastVertices.size() * sizeof(SimpleFastVertex);
-		bufferInfo.slowVertexOffset = bufferInfo.fastVertexOffset + bufferInfo.fastVertexSize;
-		bufferInfo.slowVertexSize = (int)slowVertices.size() * sizeof(SimpleSlowVertex);
+	bool SimpleRenderer<IndexType, GLIndexType>::BuildBuffers() {
+		const GLsizeiptr zVertexBytes = ZVertexCount() * sizeof(SimpleZVertex);
+		const GLsizeiptr fastVertexBytes = FastVertexCount() * sizeof(SimpleFastVertex);
+		const GLsizeiptr slowVertexBytes = SlowVertexCount() * sizeof(SimpleSlowVertex);
+		const GLsizeiptr zIndexBytes = ZIndexCount() * sizeof(IndexType);
+		const GLsizeiptr indexBytes = IndexCount() * sizeof(IndexType);
+
+		// Has anything been added since the last upload?
+		if (abo && eabo && fixedSurfaceCount == surfaces.size() &&
+			zVertexBytes == bufferInfo.zVertexSize && fastVertexBytes == bufferInfo.fastVertexSize &&
+			slowVertexBytes == bufferInfo.slowVertexSize && zIndexBytes == bufferInfo.zIndexSize &&
+			indexBytes == bufferInfo.indexSize)
+			return true;
 
-		bufferInfo.zIndexOffset = 0;
-		bufferInfo.zIndexSize = (int)zIndices.size() * sizeof(IndexType);
-		bufferInfo.indexOffset = (int)bufferInfo.zIndexOffset + bufferInfo.zIndexSize;
-		bufferInfo.indexSize = (int)indices.size() * sizeof(IndexType);
+		const bool vertexOverflow = !abo ||
+			zVertexBytes > bufferInfo.zVertexCapacity ||
+			fastVertexBytes > bufferInfo.fastVertexCapacity ||
+			slowVertexBytes > bufferInfo.slowVertexCapacity;
+		const bool indexOverflow = !eabo ||
+			zIndexBytes > bufferInfo.zIndexCapacity ||
+			indexBytes > bufferInfo.indexCapacity;
+		const bool canCopy = GLEW_VERSION_3_1 || GLEW_ARB_copy_buffer;
+
+		// binding the element buffer below must not change a vertex array
+		FxBindVertexArray(0);
+
+		if (vertexOverflow) {
+			BUFFERINFO old = bufferInfo;
+			bufferInfo.zVertexCapacity = GrowCapacity(old.zVertexCapacity, zVertexBytes);
+			bufferInfo.fastVertexCapacity = GrowCapacity(old.fastVertexCapacity, fastVertexBytes);
+			bufferInfo.slowVertexCapacity = GrowCapacity(old.slowVertexCapacity, slowVertexBytes);
+			bufferInfo.zVertexOffset = 0;
+			bufferInfo.fastVertexOffset = bufferInfo.zVertexOffset + bufferInfo.zVertexCapacity;
+			bufferInfo.slowVertexOffset = bufferInfo.fastVertexOffset + bufferInfo.fastVertexCapacity;
+			bufferInfo.vertexBufferSizeInBytes = bufferInfo.slowVertexOffset + bufferInfo.slowVertexCapacity;
+			if (!canCopy) {
+				bufferInfo.zVertexSize = 0;
+				bufferInfo.fastVertexSize = 0;
+				bufferInfo.slowVertexSize = 0;
+			}
+			ReallocateBuffer(GL_ARRAY_BUFFER, abo, bufferInfo.vertexBufferSizeInBytes, {
+				{ old.zVertexOffset, bufferInfo.zVertexOffset, bufferInfo.zVertexSize },
+				{ old.fastVertexOffset, bufferInfo.fastVertexOffset, bufferInfo.fastVertexSize },
+				{ old.slowVertexOffset, bufferInfo.slowVertexOffset, bufferInfo.slowVertexSize } });
+		}
 
-		bufferInfo.vertexBufferSizeInBytes = bufferInfo.zVertexSize + bufferInfo.fastVertexSize + bufferInfo.slowVertexSize;
-		bufferInfo.indexBufferSizeInBytes = bufferInfo.zIndexSize + bufferInfo.indexSize;
+		if (indexOverflow) {
+			BUFFERINFO old = bufferInfo;
+			bufferInfo.zIndexCapacity = GrowCapacity(old.zIndexCapacity, zIndexBytes);
+			bufferInfo.indexCapacity = GrowCapacity(old.indexCapacity, indexBytes);
+			bufferInfo.zIndexOffset = 0;
+			bufferInfo.indexOffset = bufferInfo.zIndexOffset + bufferInfo.zIndexCapacity;
+			bufferInfo.indexBufferSizeInBytes = bufferInfo.indexOffset + bufferInfo.indexCapacity;
+			if (!canCopy) {
+				bufferInfo.zIndexSize = 0;
+				bufferInfo.indexSize = 0;
+			}
+			ReallocateBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo, bufferInfo.indexBufferSizeInBytes, {
+				{ old.zIndexOffset, bufferInfo.zIndexOffset, bufferInfo.zIndexSize },
+				{ old.indexOffset, bufferInfo.indexOffset, bufferInfo.indexSize } });
 
-		vertexMemoryBuffer.resize((size_t)bufferInfo.vertexBufferSizeInBytes + 1);
-		indexMemoryBuffer.resize((size_t)bufferInfo.indexBufferSizeInBytes + 1);
+			// every surface has a new index offset
+			fixedSurfaceCount = 0;
+			drawListsDirty = true;
+		}
 
-		if (!zVertices.empty())
-			memcpy(&vertexMemoryBuffer[bufferInfo.zVertexOffset], &zVertices[0], bufferInfo.zVertexSize);
-		if (!fastVertices.empty())
-			memcpy(&vertexMemoryBuffer[bufferInfo.fastVertexOffset], &fastVertices[0], bufferInfo.fastVertexSize);
-		if (!slowVertices.empty())
-			memcpy(&vertexMemoryBuffer[bufferInfo.slowVertexOffset], &slowVertices[0], bufferInfo.slowVertexSize);
-		if (!zIndices.empty())
-			memcpy(&indexMemoryBuffer[bufferInfo.zIndexOffset], &zIndices[0], bufferInfo.zIndexSize);
-		if (!indices.empty())
-			memcpy(&indexMemoryBuffer[bufferInfo.indexOffset], &indices[0], bufferInfo.indexSize);
-	}
+		const GLsizeiptr uploadedBefore = bufferInfo.zVertexSize + bufferInfo.fastVertexSize +
+			bufferInfo.slowVertexSize + bufferInfo.zIndexSize + bufferInfo.indexSize;
+
+		FxBindBuffer(GL_ARRAY_BUFFER, abo);
+		UploadSection(GL_ARRAY_BUFFER, bufferInfo.zVertexOffset, bufferInfo.zVertexSize,
+					  zVertices.data(), releasedZVertices * sizeof(SimpleZVertex), zVertexBytes);
+		UploadSection(GL_ARRAY_BUFFER, bufferInfo.fastVertexOffset, bufferInfo.fastVertexSize,
+					  fastVertices.data(), releasedFastVertices * sizeof(SimpleFastVertex), fastVertexBytes);
+		UploadSection(GL_ARRAY_BUFFER, bufferInfo.slowVertexOffset, bufferInfo.slowVertexSize,
+					  slowVertices.data(), releasedSlowVertices * sizeof(SimpleSlowVertex), slowVertexBytes);
+
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+		UploadSection(GL_ELEMENT_ARRAY_BUFFER, bufferInfo.zIndexOffset, bufferInfo.zIndexSize,
+					  zIndices.data(), releasedZIndices * sizeof(IndexType), zIndexBytes);
+		UploadSection(GL_ELEMENT_ARRAY_BUFFER, bufferInfo.indexOffset, bufferInfo.indexSize,
+					  indices.data(), releasedIndices * sizeof(IndexType), indexBytes);
+
+		if (passStats) {
+			passStats->bytesUploaded += bufferInfo.zVertexSize + bufferInfo.fastVertexSize +
+				bufferInfo.slowVertexSize + bufferInfo.zIndexSize + bufferInfo.indexSize - uploadedBefore;
+		}
 
-	template <typename IndexType, GLenum GLIndexType>
-	bool SimpleRenderer<IndexType, GLIndexType>::BuildBuffers() {
-		// Have we already built the buffers?
-		if (abo && eabo)
-			return true;
+		// released data can only be moved on the GPU, so it is kept without copy buffers
+		if (releaseAfterUpload && canCopy) {
+			ReleaseVector(zVertices, releasedZVertices);
+			ReleaseVector(fastVertices, releasedFastVertices);
+			ReleaseVector(slowVertices, releasedSlowVertices);
+			ReleaseVector(zIndices, releasedZIndices);
+			ReleaseVector(indices, releasedIndices);
+		}
+
+		if (vertexOverflow || indexOverflow)
+			SetupVertexArrays();
+
+		FxBindBuffer(GL_ARRAY_BUFFER, 0);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-		BuildMemoryBuffers();
+		for (size_t i = fixedSurfaceCount; i < surfaces.size(); i++) {
+			SimpleSurface& surface = surfaces[i];
+			if (surface.vertexType == VertexType::UNDECIDED)
+				continue;
+			if (surface.isIndexed) {
+				surface.baseIndexBufferOffset = bufferInfo.indexOffset + surface.firstIndex * sizeof(IndexType);
+				surface.baseZIndexBufferOffset = bufferInfo.zIndexOffset + surface.firstZIndex * sizeof(IndexType);
+			}
+		}
+		fixedSurfaceCount = (unsigned)surfaces.size();
 
-		FxCreateBuffer(GL_ARRAY_BUFFER, &abo, vertexMemoryBuffer.size(), &vertexMemoryBuffer[0], GL_STATIC_DRAW);
-		FxCreateBuffer(GL_ELEMENT_ARRAY_BUFFER, &eabo, indexMemoryBuffer.size(), &indexMemoryBuffer[0], GL_STATIC_DRAW);
+		return (abo && eabo);
+	}
 
-		FxCreateVertexArray(&zVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, abo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SetupVertexArrays() {
+		// The vertex arrays keep their names so compiled draw lists stay valid
+		auto bindVertexArray = [](GLuint& vao) {
+			if (vao)
+				FxBindVertexArray(vao);
+			else
+				FxCreateVertexArray(&vao);
+		};
+
+		bindVertexArray(zVAO);
+		FxBindBuffer(GL_ARRAY_BUFFER, abo);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
 		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glBindVertexArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid*)(bufferInfo.zVertexOffset));
+		FxBindVertexArray(0);
 
-		FxCreateVertexArray(&fastVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, abo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+		bindVertexArray(fastVAO);
+		FxBindBuffer(GL_ARRAY_BUFFER, abo);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
 		glEnableVertexAttribArray(2);
@@ -412,29 +703,16 @@ namespace Fluxions {
 		glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SimpleFastVertex), (GLvoid*)(bufferInfo.fastVertexOffset + 20));
 		glVertexAttribPointer(4, 4, GL_SHORT, GL_FALSE, sizeof(SimpleFastVertex), (GLvoid*)(bufferInfo.fastVertexOffset + 24));
 
-		FxCreateVertexArray(&slowVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, abo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+		bindVertexArray(slowVAO);
+		FxBindBuffer(GL_ARRAY_BUFFER, abo);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
 		for (int i = 0; i < 8; i++) {
 			glEnableVertexAttribArray(i);
 			GLsizeiptr offset = bufferInfo.slowVertexOffset + i * 16;
 			glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(SimpleSlowVertex), (GLvoid*)offset);
 		}
 
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
-			if (surface->vertexType == VertexType::UNDECIDED)
-				continue;
-			if (surface->isIndexed) {
-				surface->baseIndexBufferOffset = bufferInfo.indexOffset + surface->firstIndex * sizeof(IndexType);
-				surface->baseZIndexBufferOffset = surface->firstZIndex * sizeof(IndexType);
-			}
-		}
-
-		return (abo && eabo);
+		FxBindVertexArray(0);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
@@ -447,20 +725,44 @@ namespace Fluxions {
 			FxDeleteVertexArray(&zVAO);
 			FxDeleteVertexArray(&fastVAO);
 			FxDeleteVertexArray(&slowVAO);
+			FxDeleteBuffer(&drawIndirectBuffer);
 		}
 		slowVertices.clear();
 		fastVertices.clear();
 		zVertices.clear();
 		indices.clear();
 		zIndices.clear();
+		releasedZVertices = 0;
+		releasedFastVertices = 0;
+		releasedSlowVertices = 0;
+		releasedIndices = 0;
+		releasedZIndices = 0;
 		if (softReset) {
 			slowVertices.reserve(1000000);
 			indices.reserve(1000000);
 		}
 
-		vertexMemoryBuffer.clear();
-		indexMemoryBuffer.clear();
+		// the buffers keep their capacity after a soft reset and are refilled from the start
+		if (softReset) {
+			bufferInfo.zVertexSize = 0;
+			bufferInfo.fastVertexSize = 0;
+			bufferInfo.slowVertexSize = 0;
+			bufferInfo.zIndexSize = 0;
+			bufferInfo.indexSize = 0;
+		}
+		else {
+			memset(&bufferInfo, 0, sizeof(BUFFERINFO));
+		}
+		fixedSurfaceCount = 0;
 		surfaces.clear();
+		drawCalls.clear();
+		zDrawCalls.clear();
+		drawRanges.clear();
+		multiDraw.clear();
+		drawOrder.clear();
+		zDrawOrder.clear();
+		culler.clear();
+		drawListsDirty = true;
 		object_set.clear();
 		currentSurface = 0;
 
@@ -483,58 +785,77 @@ namespace Fluxions {
 		if (!BuildBuffers())
 			return;
 
-		glBindBuffer(GL_ARRAY_BUFFER, abo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
+		FxBindBuffer(GL_ARRAY_BUFFER, abo);
+		FxBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eabo);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::Render() {
+		STATSSCOPE scope(*this);
 		RenderFast();
 		RenderSlow();
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::RenderFast() {
+		STATSSCOPE scope(*this);
 		if (!BuildBuffers())
 			return;
 
-		glBindVertexArray(fastVAO);
+		BindVertexArray(fastVAO);
 
+		size_t drawn = 0;
+		size_t culled = 0;
 		for (auto& surface : surfaces) {
 			if (surface.vertexType != VertexType::FAST_VERTEX)
 				continue;
+			if (!IsSurfaceVisible(&surface - surfaces.data())) {
+				culled++;
+				continue;
+			}
 
 			if (surface.isIndexed) {
-				glDrawElements(surface.mode, surface.count, GLIndexType, (GLvoid*)(surface.baseIndexBufferOffset));
+				DrawElements(surface.mode, surface.count, surface.baseIndexBufferOffset);
 			}
 			else {
-				glDrawArrays(surface.mode, surface.first, surface.count);
+				DrawArrays(surface.mode, surface.first, surface.count);
 			}
+			drawn++;
 		}
+		CountSurfaces(drawn, culled);
 
-		glBindVertexArray(0);
+		FxBindVertexArray(0);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::RenderSlow() {
+		STATSSCOPE scope(*this);
 		if (!BuildBuffers())
 			return;
 
-		glBindVertexArray(slowVAO);
+		BindVertexArray(slowVAO);
 
+		size_t drawn = 0;
+		size_t culled = 0;
 		for (auto& surface : surfaces) {
 			if (surface.vertexType != VertexType::SLOW_VERTEX)
 				continue;
+			if (!IsSurfaceVisible(&surface - surfaces.data())) {
+				culled++;
+				continue;
+			}
 
 			if (surface.isIndexed) {
-				glDrawElements(surface.mode, surface.count, GLIndexType, (GLvoid*)(surface.baseIndexBufferOffset));
+				DrawElements(surface.mode, surface.count, surface.baseIndexBufferOffset);
 			}
 			else {
-				glDrawArrays(surface.mode, surface.first, surface.count);
+				DrawArrays(surface.mode, surface.first, surface.count);
 			}
+			drawn++;
 		}
+		CountSurfaces(drawn, culled);
 
-		glBindVertexArray(0);
+		FxBindVertexArray(0);
 	}
 
 	//template <typename IndexType, GLenum GLIndexType>
@@ -605,49 +926,74 @@ namespace Fluxions {
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::RenderZOnly() {
+		STATSSCOPE scope(*this);
 
 		// Render all surfaces as Z only with appropriate transformation matrices.
 		if (!zVAO || !abo || !eabo) {
 			BuildBuffers();
 		}
 
-		glBindVertexArray(zVAO);
+		BindVertexArray(zVAO);
 
+		size_t drawn = 0;
+		size_t culled = 0;
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
 			if (surface->vertexType == VertexType::UNDECIDED)
 				continue;
+			if (!IsSurfaceVisible(surface - surfaces.begin())) {
+				culled++;
+				continue;
+			}
 			if (surface->isIndexed) {
-				glDrawElements(surface->mode, surface->count, GLIndexType, (GLvoid*)(long long)(surface->baseZIndexBufferOffset));
+				DrawElements(surface->mode, surface->count, surface->baseZIndexBufferOffset);
 			}
 			else {
-				glDrawArrays(surface->mode, surface->first, surface->count);
+				DrawArrays(surface->mode, surface->first, surface->count);
 			}
+			drawn++;
 		}
+		CountSurfaces(drawn, culled);
 
-		glBindVertexArray(0);
+		FxBindVertexArray(0);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::RenderIf(const std::string& objectName, const std::string& groupName, const std::string& mtllibName, const std::string& mtlName, bool onlyRenderZ) {
+		STATSSCOPE scope(*this);
 		BuildBuffers();
 
-		GLuint lastUsedVAO = 0;
+		// names are looked up once so the loop only compares ids, and a name that was
+		// never interned cannot match any surface
+		Symbol objectSymbol = Symbol::Find(objectName);
+		Symbol groupSymbol = Symbol::Find(groupName);
+		Symbol mtllibSymbol = Symbol::Find(mtllibName);
+		Symbol mtlSymbol = Symbol::Find(mtlName);
+		if ((objectSymbol.empty() && !objectName.empty()) ||
+			(groupSymbol.empty() && !groupName.empty()) ||
+			(mtllibSymbol.empty() && !mtllibName.empty()) ||
+			(mtlSymbol.empty() && !mtlName.empty()))
+			return;
 
-		if (onlyRenderZ) {
-			glBindVertexArray(zVAO);
-		}
+		GLuint lastUsedVAO = 0;
+		size_t drawn = 0;
+		size_t culled = 0;
 
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
 			if (surface->vertexType == VertexType::UNDECIDED)
 				continue;
-			if (objectName.empty() != true && objectName != surface->objectName)
+			const bool isVisible = IsSurfaceVisible(surface - surfaces.begin());
+			if (!objectSymbol.empty() && objectSymbol != surface->objectName)
+				continue;
+			if (!groupSymbol.empty() && groupSymbol != surface->groupName)
 				continue;
-			if (groupName.empty() != true && groupName != surface->groupName)
+			if (!mtllibSymbol.empty() && mtllibSymbol != surface->mtllibName)
 				continue;
-			if (mtllibName.empty() != true && mtllibName != surface->mtllibName)
+			if (!mtlSymbol.empty() && mtlSymbol != surface->mtlName)
 				continue;
-			if (mtlName.empty() != true && mtlName != surface->mtlName)
+			if (!isVisible) {
+				culled++;
 				continue;
+			}
 
 			GLintptr offset = 0;
 
@@ -656,48 +1002,50 @@ namespace Fluxions {
 				offset = surface->baseZIndexBufferOffset;
 				if (lastUsedVAO != zVAO) {
 					lastUsedVAO = zVAO;
-					glBindVertexArray(zVAO);
+					BindVertexArray(zVAO);
 				}
 			}
 			else if (surface->vertexType == VertexType::FAST_VERTEX) {
 				offset = surface->baseIndexBufferOffset;
 				if (lastUsedVAO != fastVAO) {
 					lastUsedVAO = fastVAO;
-					glBindVertexArray(fastVAO);
+					BindVertexArray(fastVAO);
 				}
 			}
 			else if (surface->vertexType == VertexType::SLOW_VERTEX) {
 				offset = surface->baseIndexBufferOffset;
 				if (lastUsedVAO != slowVAO) {
 					lastUsedVAO = slowVAO;
-					glBindVertexArray(slowVAO);
+					BindVertexArray(slowVAO);
 				}
 			}
 
 			if (surface->isIndexed) {
-				glDrawElements(surface->mode, surface->count, GLIndexType, (GLvoid*)(long long)(surface->baseZIndexBufferOffset));
+				DrawElements(surface->mode, surface->count, offset);
 			}
 			else {
-				glDrawArrays(surface->mode, surface->first, surface->count);
+				DrawArrays(surface->mode, surface->first, surface->count);
 			}
+			drawn++;
 		}
+		CountSurfaces(drawn, culled);
 
-		glBindVertexArray(0);
+		FxBindVertexArray(0);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	void SimpleRenderer<IndexType, GLIndexType>::RenderIf(GLuint objectId, GLuint groupId, GLuint mtllibId, GLuint mtlId, bool onlyRenderZ) {
+		STATSSCOPE scope(*this);
 		BuildBuffers();
 
 		GLuint lastUsedVAO = 0;
-
-		if (onlyRenderZ) {
-			glBindVertexArray(zVAO);
-		}
+		size_t drawn = 0;
+		size_t culled = 0;
 
 		for (auto surface = surfaces.begin(); surface != surfaces.end(); surface++) {
 			if (surface->vertexType == VertexType::UNDECIDED)
 				continue;
+			const bool isVisible = IsSurfaceVisible(surface - surfaces.begin());
 			if (objectId != 0 && objectId != surface->objectId)
 				continue;
 			if (groupId != 0 && groupId != surface->groupId)
@@ -706,6 +1054,10 @@ namespace Fluxions {
 				continue;
 			if (mtlId != 0 && mtlId != surface->mtlId)
 				continue;
+			if (!isVisible) {
+				culled++;
+				continue;
+			}
 
 			GLintptr offset = 0;
 
@@ -714,93 +1066,557 @@ namespace Fluxions {
 				offset = surface->baseZIndexBufferOffset;
 				if (lastUsedVAO != zVAO) {
 					lastUsedVAO = zVAO;
-					glBindVertexArray(zVAO);
+					BindVertexArray(zVAO);
 				}
 			}
 			else if (surface->vertexType == VertexType::SLOW_VERTEX) {
 				offset = surface->baseIndexBufferOffset;
 				if (lastUsedVAO != slowVAO) {
 					lastUsedVAO = slowVAO;
-					glBindVertexArray(slowVAO);
+					BindVertexArray(slowVAO);
 				}
 			}
 			else if (surface->vertexType == VertexType::FAST_VERTEX) {
 				offset = surface->baseIndexBufferOffset;
 				if (lastUsedVAO != fastVAO) {
 					lastUsedVAO = fastVAO;
-					glBindVertexArray(fastVAO);
+					BindVertexArray(fastVAO);
 				}
 			}
 
 			if (surface->isIndexed) {
-				glDrawElements(surface->mode, surface->count, GLIndexType, (GLvoid*)offset);
+				DrawElements(surface->mode, surface->count, offset);
 			}
 			else {
-				glDrawArrays(surface->mode, surface->first, surface->count);
+				DrawArrays(surface->mode, surface->first, surface->count);
 			}
+			drawn++;
 		}
+		CountSurfaces(drawn, culled);
 
-		glBindVertexArray(0);
+		FxBindVertexArray(0);
 	}
 
 	template <typename IndexType, GLenum GLIndexType>
 	int SimpleRenderer<IndexType, GLIndexType>::RenderIf(GLuint objectId, int mtlId, bool onlyRenderZ) {
+		STATSSCOPE scope(*this);
 		if (objectId == 0)
 			return 0;
 		if (!BuildBuffers())
 			return 0;
+		if (drawListsDirty)
+			CompileDrawLists();
 
-		GLuint lastUsedVAO = 0;
+		auto it = drawRanges.find(DrawRangeKey(objectId, mtlId));
+		if (it == drawRanges.end())
+			return 0;
 
-		if (onlyRenderZ) {
-			glBindVertexArray(zVAO);
+		const DRAWRANGE& range = it->second;
+		if (cullingEnabled) {
+			// a bucket with culled surfaces is drawn from the draws of its visible ones
+			const unsigned* order = (onlyRenderZ ? zDrawOrder.data() : drawOrder.data()) +
+				(onlyRenderZ ? range.zSurfaceFirst : range.surfaceFirst);
+			int visibleCount = 0;
+			for (int i = 0; i < range.surfaceCount; i++) {
+				visibleCount += culler.visible(order[i]) ? 1 : 0;
+			}
+			CountSurfaces(visibleCount, range.surfaceCount - visibleCount);
+			if (visibleCount == 0)
+				return 0;
+			if (visibleCount < range.surfaceCount) {
+				culledDrawCalls.clear();
+				for (int i = 0; i < range.surfaceCount; i++) {
+					if (culler.visible(order[i]))
+						AppendDrawCall(culledDrawCalls, 0, surfaces[order[i]], onlyRenderZ);
+				}
+				SubmitDrawCalls(culledDrawCalls.data(), (unsigned)culledDrawCalls.size());
+				FxBindVertexArray(0);
+				return visibleCount;
+			}
+		}
+		else {
+			CountSurfaces(range.surfaceCount, 0);
 		}
 
-		int count = 0;
-		for (auto& surface : surfaces) {
+		if (useMultiDraw && onlyRenderZ)
+			SubmitBatches(range.zBatchFirst, range.zBatchCount, zDrawCalls.data() + range.zFirst, range.zCount, range.zDrawArrays);
+		else if (useMultiDraw)
+			SubmitBatches(range.batchFirst, range.batchCount, drawCalls.data() + range.first, range.count, range.drawArrays);
+		else if (onlyRenderZ)
+			SubmitDrawCalls(zDrawCalls.data() + range.zFirst, range.zCount);
+		else
+			SubmitDrawCalls(drawCalls.data() + range.first, range.count);
+		FxBindVertexArray(0);
+		return range.surfaceCount;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CompileDrawLists() {
+		drawCalls.clear();
+		zDrawCalls.clear();
+		drawRanges.clear();
+		drawListsDirty = false;
+		if (!BuildBuffers())
+			return;
+
+		// Each bucket gets a dense id for the top bits of the sort key, see MakeDrawSortKey()
+		std::unordered_map<uint64_t, unsigned> bucketIds;
+		std::vector<uint64_t> bucketKeys;
+		std::vector<uint64_t> keys;
+		std::vector<uint64_t> zKeys;
+		std::vector<unsigned> order;
+		keys.reserve(surfaces.size());
+		zKeys.reserve(surfaces.size());
+		order.reserve(surfaces.size());
+		for (unsigned i = 0; i < (unsigned)surfaces.size(); i++) {
+			const SimpleSurface& surface = surfaces[i];
 			if (surface.vertexType == VertexType::UNDECIDED)
 				continue;
-			if (objectId != 0 && objectId != surface.objectId)
+			uint64_t bucketKey = DrawRangeKey(surface.objectId, surface.drawMtlId);
+			auto bucket = bucketIds.emplace(bucketKey, (unsigned)bucketKeys.size());
+			if (bucket.second) {
+				bucketKeys.push_back(bucketKey);
+				drawRanges[bucketKey].surfaceCount = 0;
+			}
+			drawRanges[bucketKey].surfaceCount++;
+
+			const unsigned bucketId = bucket.first->second;
+			const bool isSlowVertex = surface.vertexType == VertexType::SLOW_VERTEX;
+			keys.push_back(MakeDrawSortKey(bucketId, isSlowVertex, surface.mode, surface.isIndexed,
+										   (uint32_t)(surface.isIndexed ? surface.firstIndex : surface.first)));
+			zKeys.push_back(MakeDrawSortKey(bucketId, false, surface.mode, surface.isIndexed,
+											(uint32_t)(surface.isIndexed ? surface.firstZIndex : surface.first)));
+			order.push_back(i);
+		}
+
+		std::vector<unsigned> zOrder = order;
+		RadixSort(keys, order);
+		RadixSort(zKeys, zOrder);
+
+		auto compile = [this, &bucketKeys](const std::vector<uint64_t>& sortedKeys,
+										   const std::vector<unsigned>& sortedOrder,
+										   bool onlyRenderZ,
+										   std::vector<DRAWCALL>& calls) {
+			calls.reserve(sortedOrder.size());
+			for (size_t i = 0; i < sortedOrder.size(); i++) {
+				DRAWRANGE& range = drawRanges[bucketKeys[DrawSortKeyBucket(sortedKeys[i])]];
+				unsigned& first = onlyRenderZ ? range.zFirst : range.first;
+				unsigned& count = onlyRenderZ ? range.zCount : range.count;
+				if (count == 0) {
+					first = (unsigned)calls.size();
+					(onlyRenderZ ? range.zSurfaceFirst : range.surfaceFirst) = (unsigned)i;
+				}
+				AppendDrawCall(calls, first, surfaces[sortedOrder[i]], onlyRenderZ);
+				count = (unsigned)calls.size() - first;
+			}
+		};
+		compile(keys, order, false, drawCalls);
+		compile(zKeys, zOrder, true, zDrawCalls);
+		drawOrder.swap(order);
+		zDrawOrder.swap(zOrder);
+
+		// the indexed draws of each bucket become batches of one VAO and mode each
+		multiDraw.clear();
+		multiDraw.reserve(drawCalls.size() + zDrawCalls.size());
+		auto batch = [this](const DRAWCALL* calls, unsigned count, unsigned& batchFirst, unsigned& batchCount, unsigned& drawArrays) {
+			batchFirst = (unsigned)multiDraw.batches().size();
+			drawArrays = multiDraw.addDraws(calls, count, sizeof(IndexType));
+			batchCount = (unsigned)multiDraw.batches().size() - batchFirst;
+		};
+		for (auto& it : drawRanges) {
+			DRAWRANGE& range = it.second;
+			batch(drawCalls.data() + range.first, range.count, range.batchFirst, range.batchCount, range.drawArrays);
+			batch(zDrawCalls.data() + range.zFirst, range.zCount, range.zBatchFirst, range.zBatchCount, range.zDrawArrays);
+		}
+
+		useMultiDrawIndirect = (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) && !multiDraw.commands().empty();
+		if (useMultiDrawIndirect) {
+			FxCreateBuffer(GL_DRAW_INDIRECT_BUFFER, &drawIndirectBuffer, multiDraw.commandsSizeInBytes(), multiDraw.commands().data(), GL_STATIC_DRAW);
+			if (passStats)
+				passStats->bytesUploaded += multiDraw.commandsSizeInBytes();
+			FxBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	typename SimpleRenderer<IndexType, GLIndexType>::DRAWCALL SimpleRenderer<IndexType, GLIndexType>::MakeDrawCall(const SimpleSurface& surface, bool onlyRenderZ) const {
+		DRAWCALL call;
+		call.vao = onlyRenderZ ? zVAO : surface.vertexType == VertexType::SLOW_VERTEX ? slowVAO : fastVAO;
+		call.mode = surface.mode;
+		call.isIndexed = surface.isIndexed;
+		call.count = surface.count;
+		call.first = surface.first;
+		call.offset = onlyRenderZ ? surface.baseZIndexBufferOffset : surface.baseIndexBufferOffset;
+		return call;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::AppendDrawCall(std::vector<DRAWCALL>& calls, size_t bucketFirst, const SimpleSurface& surface, bool onlyRenderZ) {
+		// join with the previous draw of this bucket if the ranges are adjacent
+		DRAWCALL call = MakeDrawCall(surface, onlyRenderZ);
+		if (calls.size() > bucketFirst && JoinDrawCall(calls.back(), call, sizeof(IndexType)))
+			return;
+		calls.push_back(call);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::RecordDrawCall(SimpleCommandList& list, size_t listFirst, const DRAWCALL& call) const {
+		if (list.size() > listFirst) {
+			SimpleCommandList::Command& last = list.back();
+			if (last.sortKey == list.sortKey() && last.drawData == list.drawData() &&
+				JoinDrawCall(last, call, sizeof(IndexType)))
+				return;
+		}
+		if (call.isIndexed)
+			list.drawElements(call.vao, call.mode, call.count, call.offset);
+		else
+			list.drawArrays(call.vao, call.mode, call.first, call.count);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CullSurfaces(const Matrix4f& viewProjection, unsigned threadCount) {
+		// the bounds are only gathered again when surfaces were added or reset
+		if (culler.size() != surfaces.size()) {
+			culler.clear();
+			culler.reserve(surfaces.size());
+			for (const SimpleSurface& surface : surfaces) {
+				if (surface.hasBounds)
+					culler.add(surface.boundingBox);
+				else
+					culler.addAlwaysVisible();
+			}
+		}
+		culler.setViewProjection(viewProjection);
+		culler.cull(threadCount);
+		cullingEnabled = true;
+
+		if (!occluderObjectIds.empty()) {
+			occlusionCuller.beginFrame(viewProjection);
+			CullOccludedSurfaces(threadCount);
+		}
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SetOccluder(GLuint objectId, bool isOccluder) {
+		if (isOccluder)
+			occluderObjectIds.insert(objectId);
+		else
+			occluderObjectIds.erase(objectId);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CullOccludedSurfaces(unsigned threadCount) {
+		// visible occluders are rasterized from the Z only indices that are still in memory,
+		// and instances are skipped because they cover the same pixels as their owner
+		std::vector<char> isOccluder(surfaces.size(), 0);
+		for (size_t i = 0; i < surfaces.size(); i++) {
+			const SimpleSurface& surface = surfaces[i];
+			if (!occluderObjectIds.count(surface.objectId) || !culler.visible(i))
+				continue;
+			isOccluder[i] = 1;
+			if (!surface.isIndexed || surface.mode != GL_TRIANGLES || surface.instanceOf >= 0 ||
+				(size_t)surface.firstZIndex < releasedZIndices)
 				continue;
-			if (mtlId != surface.drawMtlId)
+			occlusionCuller.addOccluder(zVertices.data(), releasedZVertices, zVertices.size(),
+										zIndices.data() + (surface.firstZIndex - releasedZIndices), (size_t)surface.zCount);
+		}
+		if (occlusionCuller.triangleCount() == 0)
+			return;
+		occlusionCuller.rasterize(threadCount);
+
+		// threads own whole words of the visibility bits
+		const size_t wordCount = (surfaces.size() + 63) / 64;
+		ParallelFor(wordCount, 16, [&](size_t firstWord, size_t lastWord) {
+			const size_t last = std::min(surfaces.size(), lastWord * 64);
+			for (size_t i = firstWord * 64; i < last; i++) {
+				const SimpleSurface& surface = surfaces[i];
+				if (isOccluder[i] || !surface.hasBounds || !culler.visible(i))
+					continue;
+				if (occlusionCuller.isOccluded(surface.boundingBox))
+					culler.hide(i);
+			}
+		}, threadCount);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SubmitBatches(unsigned firstBatch, unsigned batchCount, const DRAWCALL* calls, unsigned count, unsigned drawArrays) {
+		if (useMultiDrawIndirect && batchCount > 0)
+			FxBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawIndirectBuffer);
+
+		GLuint lastUsedVAO = 0;
+		for (unsigned i = firstBatch; i < firstBatch + batchCount; i++) {
+			const auto& batch = multiDraw.batches()[i];
+			if (lastUsedVAO != batch.vao) {
+				lastUsedVAO = batch.vao;
+				BindVertexArray(batch.vao);
+			}
+			CountMultiDraw(multiDraw.counts().data() + batch.firstCommand, (GLsizei)batch.commandCount);
+			if (useMultiDrawIndirect) {
+				const GLvoid* indirect = (const GLvoid*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand));
+				glMultiDrawElementsIndirect(batch.mode, GLIndexType, indirect, (GLsizei)batch.commandCount, 0);
+			}
+			else {
+				glMultiDrawElements(batch.mode, multiDraw.counts().data() + batch.firstCommand, GLIndexType,
+									multiDraw.offsets().data() + batch.firstCommand, (GLsizei)batch.commandCount);
+			}
+		}
+
+		if (useMultiDrawIndirect && batchCount > 0)
+			FxBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		// draws without indices are rare, so they are still submitted one at a time
+		for (unsigned i = 0; drawArrays > 0 && i < count; i++) {
+			if (calls[i].isIndexed)
 				continue;
+			if (lastUsedVAO != calls[i].vao) {
+				lastUsedVAO = calls[i].vao;
+				BindVertexArray(calls[i].vao);
+			}
+			DrawArrays(calls[i].mode, calls[i].first, calls[i].count);
+			drawArrays--;
+		}
+	}
 
-			GLintptr offset = 0;
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SubmitDrawCalls(const DRAWCALL* calls, unsigned count) {
+		GLuint lastUsedVAO = 0;
+		for (unsigned i = 0; i < count; i++) {
+			const DRAWCALL& call = calls[i];
+			if (lastUsedVAO != call.vao) {
+				lastUsedVAO = call.vao;
+				BindVertexArray(call.vao);
+			}
+			if (call.isIndexed) {
+				DrawElements(call.mode, call.count, call.offset);
+			}
+			else {
+				DrawArrays(call.mode, call.first, call.count);
+			}
+		}
+	}
 
-			// TODO: Check if it is faster to move these out of the loop and render one VAO at a time...
-			if (onlyRenderZ) {
-				offset = surface.baseZIndexBufferOffset;
-				if (lastUsedVAO != zVAO) {
-					lastUsedVAO = zVAO;
-					glBindVertexArray(zVAO);
-				}
+	template <typename IndexType, GLenum GLIndexType>
+	bool SimpleRenderer<IndexType, GLIndexType>::PrepareRecording() {
+		if (!BuildBuffers())
+			return false;
+		if (drawListsDirty)
+			CompileDrawLists();
+		return true;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	int SimpleRenderer<IndexType, GLIndexType>::RecordIf(SimpleCommandList& list, GLuint objectId, int mtlId, bool onlyRenderZ) const {
+		// this only reads state, so it must not build or compile anything itself
+		if (objectId == 0 || drawListsDirty)
+			return 0;
+
+		auto it = drawRanges.find(DrawRangeKey(objectId, mtlId));
+		if (it == drawRanges.end())
+			return 0;
+
+		const DRAWRANGE& range = it->second;
+		const size_t listFirst = list.size();
+		if (cullingEnabled) {
+			const unsigned* order = (onlyRenderZ ? zDrawOrder.data() : drawOrder.data()) +
+				(onlyRenderZ ? range.zSurfaceFirst : range.surfaceFirst);
+			int visibleCount = 0;
+			for (int i = 0; i < range.surfaceCount; i++) {
+				visibleCount += culler.visible(order[i]) ? 1 : 0;
 			}
-			else if (surface.vertexType == VertexType::SLOW_VERTEX) {
-				offset = surface.baseIndexBufferOffset;
-				if (lastUsedVAO != slowVAO) {
-					lastUsedVAO = slowVAO;
-					glBindVertexArray(slowVAO);
+			if (visibleCount < range.surfaceCount) {
+				for (int i = 0; i < range.surfaceCount; i++) {
+					if (culler.visible(order[i]))
+						RecordDrawCall(list, listFirst, MakeDrawCall(surfaces[order[i]], onlyRenderZ));
 				}
+				return visibleCount;
 			}
-			else if (surface.vertexType == VertexType::FAST_VERTEX) {
-				offset = surface.baseIndexBufferOffset;
-				if (lastUsedVAO != fastVAO) {
-					lastUsedVAO = fastVAO;
-					glBindVertexArray(fastVAO);
-				}
+		}
+
+		const DRAWCALL* calls = onlyRenderZ ? zDrawCalls.data() + range.zFirst : drawCalls.data() + range.first;
+		const unsigned count = onlyRenderZ ? range.zCount : range.count;
+		for (unsigned i = 0; i < count; i++) {
+			RecordDrawCall(list, listFirst, calls[i]);
+		}
+		return range.surfaceCount;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::RecordSurfaces(SimpleCommandList& list, size_t first, size_t last, bool onlyRenderZ) const {
+		// surfaces after fixedSurfaceCount have no buffer offsets yet
+		last = std::min<size_t>(last, fixedSurfaceCount);
+		const size_t listFirst = list.size();
+		for (size_t i = first; i < last; i++) {
+			const SimpleSurface& surface = surfaces[i];
+			if (surface.vertexType == VertexType::UNDECIDED || !IsSurfaceVisible(i))
+				continue;
+			RecordDrawCall(list, listFirst, MakeDrawCall(surface, onlyRenderZ));
+		}
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SubmitCommandLists(const SimpleCommandList* lists, size_t listCount, const std::function<void(uint32_t)>& setDrawData) {
+		STATSSCOPE scope(*this);
+		mergedCommands.clear();
+		size_t total = 0;
+		for (size_t i = 0; i < listCount; i++) {
+			total += lists[i].size();
+		}
+		mergedCommands.reserve(total);
+		for (size_t i = 0; i < listCount; i++) {
+			mergedCommands.append(lists[i]);
+		}
+		mergedCommands.sort();
+
+		const auto& commands = mergedCommands.commands();
+		const size_t count = commands.size();
+		GLuint lastUsedVAO = 0;
+		size_t i = 0;
+		while (i < count) {
+			const SimpleCommandList::Command& command = commands[i];
+			if (setDrawData && (i == 0 || commands[i - 1].drawData != command.drawData))
+				setDrawData(command.drawData);
+			if (lastUsedVAO != command.vao) {
+				lastUsedVAO = command.vao;
+				BindVertexArray(command.vao);
+			}
+			if (!command.isIndexed) {
+				DrawArrays(command.mode, command.first, command.count);
+				i++;
+				continue;
 			}
 
-			if (surface.isIndexed) {
-				glDrawElements(surface.mode, surface.count, GLIndexType, (GLvoid*)offset);
+			// indexed draws with the same state up to the next change are one multi draw
+			size_t end = i + 1;
+			while (useMultiDraw && end < count && commands[end].isIndexed &&
+				   commands[end].vao == command.vao && commands[end].mode == command.mode &&
+				   (!setDrawData || commands[end].drawData == command.drawData)) {
+				end++;
+			}
+			if (end - i == 1) {
+				DrawElements(command.mode, command.count, command.offset);
 			}
 			else {
-				glDrawArrays(surface.mode, surface.first, surface.count);
+				commandCounts.clear();
+				commandOffsets.clear();
+				for (size_t j = i; j < end; j++) {
+					commandCounts.push_back(commands[j].count);
+					commandOffsets.push_back((const GLvoid*)commands[j].offset);
+				}
+				CountMultiDraw(commandCounts.data(), (GLsizei)(end - i));
+				glMultiDrawElements(command.mode, commandCounts.data(), GLIndexType, commandOffsets.data(), (GLsizei)(end - i));
+			}
+			i = end;
+		}
+		FxBindVertexArray(0);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::EnableStats(bool enabled, bool gpuTimers) {
+		useGpuTimers = enabled && gpuTimers && (GLEW_VERSION_3_3 || GLEW_ARB_timer_query);
+		passStats = enabled ? &stats.pass(statsPassName) : nullptr;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::SetStatsPass(const std::string& name) {
+		statsPassName = name;
+		if (passStats)
+			passStats = &stats.pass(name);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	bool SimpleRenderer<IndexType, GLIndexType>::BeginStatsScope() {
+		if (!passStats || statsScopeActive)
+			return false;
+		statsScopeActive = true;
+		scopeStats = passStats;
+		scopeStats->calls++;
+		if (useGpuTimers) {
+			if (freeTimerQueries.empty()) {
+				GLuint query = 0;
+				glGenQueries(1, &query);
+				freeTimerQueries.push_back(query);
 			}
-			count++;
+			scopeTimerQuery = freeTimerQueries.back();
+			freeTimerQueries.pop_back();
+			glBeginQuery(GL_TIME_ELAPSED, scopeTimerQuery);
+		}
+		scopeStart = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::EndStatsScope() {
+		auto elapsed = std::chrono::steady_clock::now() - scopeStart;
+		scopeStats->cpuMilliseconds += std::chrono::duration<double, std::milli>(elapsed).count();
+		if (scopeTimerQuery) {
+			glEndQuery(GL_TIME_ELAPSED);
+			pendingTimerQueries.push_back({ scopeTimerQuery, scopeStats });
+			scopeTimerQuery = 0;
 		}
+		statsScopeActive = false;
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CollectGpuTimes(bool wait) {
+		// queries finish in the order they were issued, so the first unfinished one ends the search
+		size_t finished = 0;
+		for (; finished < pendingTimerQueries.size(); finished++) {
+			TIMERQUERY& pending = pendingTimerQueries[finished];
+			GLint available = 0;
+			if (!wait)
+				glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!wait && !available)
+				break;
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+			pending.pass->gpuMilliseconds += nanoseconds * 1e-6;
+			pending.pass->gpuTimerCount++;
+			freeTimerQueries.push_back(pending.query);
+		}
+		pendingTimerQueries.erase(pendingTimerQueries.begin(), pendingTimerQueries.begin() + finished);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::BindVertexArray(GLuint vao) {
+		if (passStats)
+			passStats->vaoSwitches++;
+		FxBindVertexArray(vao);
+	}
 
-		glBindVertexArray(0);
-		return count;
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::DrawElements(GLenum mode, GLsizei count, GLsizeiptr offset) {
+		if (passStats) {
+			passStats->drawCalls++;
+			passStats->indices += count;
+		}
+		glDrawElements(mode, count, GLIndexType, (GLvoid*)offset);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+		if (passStats) {
+			passStats->drawCalls++;
+			passStats->indices += count;
+		}
+		glDrawArrays(mode, first, count);
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CountMultiDraw(const GLsizei* counts, GLsizei drawCount) {
+		if (!passStats)
+			return;
+		passStats->drawCalls++;
+		for (GLsizei i = 0; i < drawCount; i++) {
+			passStats->indices += counts[i];
+		}
+	}
+
+	template <typename IndexType, GLenum GLIndexType>
+	void SimpleRenderer<IndexType, GLIndexType>::CountSurfaces(size_t drawn, size_t culled) {
+		if (!passStats)
+			return;
+		passStats->surfacesDrawn += drawn;
+		passStats->surfacesCulled += culled;
 	}
 
 	// explicit template instantiation is after the implementation
@@ -0,0 +1,91 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_sh_relighter.hpp>
+
+namespace Fluxions {
+	void SimpleSHRelighter::setEnvironment(const SphericalHarmonicf& r, const SphericalHarmonicf& g, const SphericalHarmonicf& b) {
+		const SphericalHarmonicf* channels[3] = { &r, &g, &b };
+		for (unsigned c = 0; c < 3; c++) {
+			unsigned count = std::min(NumCoefficients, channels[c]->getMaxCoefficients());
+			for (unsigned k = 0; k < NumCoefficients; k++) {
+				env_[c][k] = k < count ? (*channels[c])[k] : 0.0f;
+			}
+		}
+	}
+
+	void SimpleSHRelighter::setEnvironment(const SphericalHarmonicf& sph, const Color3f& color) {
+		const float tint[3] = { color.r, color.g, color.b };
+		unsigned count = std::min(NumCoefficients, sph.getMaxCoefficients());
+		for (unsigned c = 0; c < 3; c++) {
+			for (unsigned k = 0; k < NumCoefficients; k++) {
+				env_[c][k] = k < count ? sph[k] * tint[c] : 0.0f;
+			}
+		}
+	}
+
+	void SimpleSHRelighter::setEnvironment(const Vector4f& sh4, const Color3f& color) {
+		const float tint[3] = { color.r, color.g, color.b };
+		for (unsigned c = 0; c < 3; c++) {
+			env_[c][0] = sh4.x * tint[c];
+			env_[c][1] = sh4.y * tint[c];
+			env_[c][2] = sh4.z * tint[c];
+			env_[c][3] = sh4.w * tint[c];
+			for (unsigned k = 4; k < NumCoefficients; k++) {
+				env_[c][k] = 0.0f;
+			}
+		}
+	}
+
+	void SimpleSHRelighter::relight(const SimpleGeometryMesh& mesh, std::vector<Color4f>& colors) const {
+		colors.resize(mesh.Vertices.size());
+		if (mesh.Vertices.empty())
+			return;
+		relight(mesh.Vertices[0].sh, sizeof(SimpleGeometryMesh::Vertex), mesh.Vertices.size(), colors.data());
+	}
+
+	void SimpleSHRelighter::relight(const float* sh, size_t strideInBytes, size_t count, Color4f* colors) const {
+		if (!sh || !colors || count == 0)
+			return;
+		ParallelFor(count, 4096, [&](size_t first, size_t last) {
+			relightRange(sh, strideInBytes, first, last, colors);
+		}, threadCount_);
+	}
+
+	void SimpleSHRelighter::relightRange(const float* sh, size_t strideInBytes, size_t first, size_t last, Color4f* colors) const {
+		const char* base = reinterpret_cast<const char*>(sh);
+		float transfer[NumCoefficients][BlockSize];
+		float result[3][BlockSize];
+
+		for (size_t i = first; i < last; i += BlockSize) {
+			size_t n = std::min<size_t>(BlockSize, last - i);
+
+			// transpose the transfer vectors of this block into SoA form
+			for (size_t j = 0; j < BlockSize; j++) {
+				const float* v = reinterpret_cast<const float*>(base + (i + std::min(j, n - 1)) * strideInBytes);
+				for (unsigned k = 0; k < NumCoefficients; k++) {
+					transfer[k][j] = v[k];
+				}
+			}
+
+			// the inner loops run over the block so they vectorize
+			for (unsigned c = 0; c < 3; c++) {
+				for (unsigned j = 0; j < BlockSize; j++) {
+					result[c][j] = 0.0f;
+				}
+				for (unsigned k = 0; k < NumCoefficients; k++) {
+					const float e = env_[c][k];
+					for (unsigned j = 0; j < BlockSize; j++) {
+						result[c][j] += e * transfer[k][j];
+					}
+				}
+				for (unsigned j = 0; j < BlockSize; j++) {
+					result[c][j] = std::max(result[c][j], 0.0f);
+				}
+			}
+
+			for (size_t j = 0; j < n; j++) {
+				colors[i + j].reset(result[0][j], result[1][j], result[2][j], 1.0f);
+			}
+		}
+	}
+} // namespace Fluxions
@@ -0,0 +1,134 @@
+#include "fluxions_base_pch.hpp"
+#include <fluxions_parallel.hpp>
+#include <fluxions_simple_skinning_engine.hpp>
+
+namespace Fluxions {
+	namespace {
+		// transforms the vectors of a block by the blended matrices, adding the
+		// translation for points and renormalizing directions
+		inline void TransformBlock(const float m[12][SimpleSkinningEngine::BlockSize],
+								   const float in[3][SimpleSkinningEngine::BlockSize],
+								   float out[3][SimpleSkinningEngine::BlockSize],
+								   bool point) {
+			constexpr unsigned N = SimpleSkinningEngine::BlockSize;
+			for (unsigned r = 0; r < 3; r++) {
+				for (unsigned j = 0; j < N; j++) {
+					out[r][j] = m[r * 4][j] * in[0][j] + m[r * 4 + 1][j] * in[1][j] + m[r * 4 + 2][j] * in[2][j];
+				}
+				if (point) {
+					const float* t = m[r * 4 + 3];
+					for (unsigned j = 0; j < N; j++) {
+						out[r][j] += t[j];
+					}
+				}
+			}
+			if (point)
+				return;
+			for (unsigned j = 0; j < N; j++) {
+				float lengthSquared = out[0][j] * out[0][j] + out[1][j] * out[1][j] + out[2][j] * out[2][j];
+				float scale = lengthSquared > 0.0f ? 1.0f / sqrtf(lengthSquared) : 0.0f;
+				out[0][j] *= scale;
+				out[1][j] *= scale;
+				out[2][j] *= scale;
+			}
+		}
+	}
+
+
+	void SimpleSkinningEngine::setPalette(const Matrix4f* palette, size_t count) {
+		palette_.resize(count * 12);
+		for (size_t i = 0; i < count; i++) {
+			const Matrix4f& m = palette[i];
+			float* p = palette_.data() + i * 12;
+			p[0] = m.m11; p[1] = m.m12; p[2] = m.m13; p[3] = m.m14;
+			p[4] = m.m21; p[5] = m.m22; p[6] = m.m23; p[7] = m.m24;
+			p[8] = m.m31; p[9] = m.m32; p[10] = m.m33; p[11] = m.m34;
+		}
+	}
+
+
+	void SimpleSkinningEngine::skin(const SimpleGeometryMesh& mesh, Output& output) const {
+		const auto& vertices = mesh.Vertices.vec();
+		const bool skinTangents = mesh.hasAttributes(SimpleGeometryMesh::TangentsAttribute);
+		output.positions.resize(vertices.size());
+		output.normals.resize(vertices.size());
+		output.tangents.resize(skinTangents ? vertices.size() : 0);
+		if (vertices.empty())
+			return;
+		skin(vertices.data(), vertices.size(), output.positions.data(), output.normals.data(),
+			 skinTangents ? output.tangents.data() : nullptr);
+	}
+
+
+	void SimpleSkinningEngine::skin(const SimpleGeometryMesh::Vertex* vertices, size_t count,
+									Vector3f* positions, Vector3f* normals, Vector3f* tangents) const {
+		if (!vertices || count == 0)
+			return;
+		ParallelFor(count, 4096, [&](size_t first, size_t last) {
+			skinRange(vertices, first, last, positions, normals, tangents);
+		}, threadCount_);
+	}
+
+
+	void SimpleSkinningEngine::skinRange(const SimpleGeometryMesh::Vertex* vertices, size_t first, size_t last,
+										 Vector3f* positions, Vector3f* normals, Vector3f* tangents) const {
+		const float* palette = palette_.data();
+		const unsigned boneCount = (unsigned)paletteSize();
+		float m[12][BlockSize];
+		float in[3][BlockSize];
+		float out[3][BlockSize];
+
+		for (size_t i = first; i < last; i += BlockSize) {
+			size_t n = std::min<size_t>(BlockSize, last - i);
+
+			// blend the bone matrices of each vertex, the short tail repeats its last vertex
+			for (unsigned j = 0; j < BlockSize; j++) {
+				const SimpleGeometryMesh::Vertex& v = vertices[i + std::min<size_t>(j, n - 1)];
+				const unsigned bones[MaxInfluences] = { v.boneIndex.x, v.boneIndex.y, v.boneIndex.z, v.boneIndex.w };
+				const float weights[MaxInfluences] = { v.boneWeights.x, v.boneWeights.y, v.boneWeights.z, v.boneWeights.w };
+				float blended[12] = { 0.0f };
+				float totalWeight = 0.0f;
+				for (unsigned k = 0; k < MaxInfluences; k++) {
+					if (weights[k] == 0.0f || bones[k] >= boneCount)
+						continue;
+					const float* bone = palette + bones[k] * 12;
+					for (unsigned e = 0; e < 12; e++) {
+						blended[e] += weights[k] * bone[e];
+					}
+					totalWeight += weights[k];
+				}
+				if (totalWeight == 0.0f) {
+					blended[0] = blended[5] = blended[10] = 1.0f;
+				}
+				else if (totalWeight != 1.0f) {
+					// the weights of skipped influences are given to the remaining bones
+					const float invWeight = 1.0f / totalWeight;
+					for (unsigned e = 0; e < 12; e++) {
+						blended[e] *= invWeight;
+					}
+				}
+				for (unsigned e = 0; e < 12; e++) {
+					m[e][j] = blended[e];
+				}
+			}
+
+			// the same blended matrices transform each attribute, which is gathered into SoA form
+			Vector3f* streams[3] = { positions, normals, tangents };
+			for (unsigned s = 0; s < 3; s++) {
+				if (!streams[s])
+					continue;
+				for (unsigned j = 0; j < BlockSize; j++) {
+					const SimpleGeometryMesh::Vertex& v = vertices[i + std::min<size_t>(j, n - 1)];
+					const Vector3f& a = s == 0 ? v.position : s == 1 ? v.normal : v.tangent;
+					in[0][j] = a.x;
+					in[1][j] = a.y;
+					in[2][j] = a.z;
+				}
+				TransformBlock(m, in, out, s == 0);
+				for (size_t j = 0; j < n; j++) {
+					streams[s][i + j].reset(out[0][j], out[1][j], out[2][j]);
+				}
+			}
+		}
+	}
+} // namespace Fluxions
@@ -0,0 +1,98 @@
+#include "fluxions_base_pch.hpp"
+#include <shared_mutex>
+#include <fluxions_symbol.hpp>
+
+namespace Fluxions {
+	namespace {
+		// SymbolTable stores each string once in fixed size blocks that never move,
+		// so str() can read without locking while other threads add symbols
+		class SymbolTable {
+		public:
+			static constexpr unsigned BlockBits = 12;
+			static constexpr unsigned BlockSize = 1 << BlockBits;
+			static constexpr unsigned MaxBlocks = 4096;
+
+			SymbolTable() {
+				blocks_[0].reset(new std::string[BlockSize]);
+				count_ = 1;
+			}
+
+			unsigned find(std::string_view s) const {
+				if (s.empty())
+					return 0;
+				std::shared_lock<std::shared_mutex> lock(mutex_);
+				auto it = ids_.find(s);
+				return it != ids_.end() ? it->second : 0;
+			}
+
+			unsigned intern(std::string_view s) {
+				unsigned id = find(s);
+				if (id || s.empty())
+					return id;
+
+				std::unique_lock<std::shared_mutex> lock(mutex_);
+				// another thread may have added it before we took the lock
+				auto it = ids_.find(s);
+				if (it != ids_.end())
+					return it->second;
+
+				unsigned block = count_ >> BlockBits;
+				if (block >= MaxBlocks) {
+					HFLOGERROR("symbol table is full, '%s' is not interned", std::string(s).c_str());
+					return 0;
+				}
+				if (!blocks_[block])
+					blocks_[block].reset(new std::string[BlockSize]);
+
+				id = count_++;
+				std::string& stored = blocks_[block][id & (BlockSize - 1)];
+				stored = s;
+				ids_.emplace(std::string_view(stored), id);
+				return id;
+			}
+
+			const std::string& str(unsigned id) const {
+				return blocks_[id >> BlockBits][id & (BlockSize - 1)];
+			}
+
+			unsigned size() const {
+				std::shared_lock<std::shared_mutex> lock(mutex_);
+				return count_;
+			}
+
+		private:
+			mutable std::shared_mutex mutex_;
+			std::unordered_map<std::string_view, unsigned> ids_;
+			std::unique_ptr<std::string[]> blocks_[MaxBlocks];
+			unsigned count_{ 0 };
+		};
+
+
+		SymbolTable& GetSymbolTable() {
+			static SymbolTable table;
+			return table;
+		}
+	} // namespace
+
+
+	Symbol Symbol::Find(std::string_view s) {
+		Symbol symbol;
+		symbol.id_ = GetSymbolTable().find(s);
+		return symbol;
+	}
+
+
+	unsigned Symbol::TableSize() {
+		return GetSymbolTable().size();
+	}
+
+
+	const std::string& Symbol::str() const {
+		return GetSymbolTable().str(id_);
+	}
+
+
+	unsigned Symbol::Intern(std::string_view s) {
+		return GetSymbolTable().intern(s);
+	}
+} // namespace Fluxions